@@ -0,0 +1,88 @@
+#ifndef ASYNCDATABASE_H
+#define ASYNCDATABASE_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QHash>
+#include <QFuture>
+#include <QPromise>
+#include <memory>
+#include <functional>
+
+#include "downloaddatabase.h"
+
+// Front for DownloadDatabase, which lives on its own thread. Writes are
+// queued and coalesced per URL, so only the latest state of a download is
+// written, and each drain is one transaction. Reads run after the writes
+// queued before them and resolve a QFuture.
+class AsyncDatabase : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AsyncDatabase(const QString &dbPath = QString(), QObject *parent = nullptr);
+    ~AsyncDatabase();
+
+    void save(const DownloadRecord &record);
+    void save(const QVector<DownloadRecord> &records);
+    void remove(const QString &url);
+    void archive(const DownloadTypes::HistoryEntry &entry);
+    void removeHistory(const QUuid &id);
+    int pendingCount() const;
+
+    QFuture<QVector<DownloadRecord>> loadDownloads();
+    QFuture<QVector<DownloadRecord>> loadActiveDownloads();
+    QFuture<QVector<DownloadTypes::HistoryEntry>> loadHistory(int offset, int limit);
+    QFuture<QVector<DownloadTypes::HistoryEntry>> searchHistory(const DownloadTypes::HistoryQuery &query);
+    // True once everything queued so far is committed; false when the write
+    // still fails after MAX_FLUSH_ATTEMPTS tries.
+    QFuture<bool> flush();
+signals:
+    void saved(int count);
+private:
+    struct Command {
+        enum Kind { Save, Remove, Archive };
+        Kind kind = Save;
+        DownloadRecord record;
+        DownloadTypes::HistoryEntry entry;
+    };
+
+    QThread *m_thread;
+    QObject *m_context;
+    DownloadDatabase *m_database{nullptr};
+
+    mutable QMutex m_mutex;
+    QHash<QString, Command> m_pending;
+    bool m_drainScheduled{false};
+
+    // A failed batch stays queued and is retried after a growing delay;
+    // both live on the database thread.
+    QTimer *m_retryTimer;
+    int m_retryDelayMs;
+    const int FIRST_RETRY_MS{250};
+    const int MAX_RETRY_MS{30000};
+    const int MAX_FLUSH_ATTEMPTS{5};
+
+    void enqueue(const QString &url, const Command &command);
+    bool drain();
+    void flushAttempt(std::shared_ptr<QPromise<bool>> promise, int attempt);
+    template<typename T>
+    QFuture<T> read(std::function<T(DownloadDatabase*)> query);
+};
+
+template<typename T>
+QFuture<T> AsyncDatabase::read(std::function<T(DownloadDatabase*)> query){
+    auto promise = std::make_shared<QPromise<T>>();
+    promise->start();
+
+    QMetaObject::invokeMethod(m_context, [this, promise, query](){
+        drain();
+        promise->addResult(m_database ? query(m_database) : T());
+        promise->finish();
+    }, Qt::QueuedConnection);
+
+    return promise->future();
+}
+
+#endif // ASYNCDATABASE_H
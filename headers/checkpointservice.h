@@ -0,0 +1,58 @@
+#ifndef CHECKPOINTSERVICE_H
+#define CHECKPOINTSERVICE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <memory>
+
+#include "asyncdatabase.h"
+#include "downloadtask.h"
+#include "downloadregistry.h"
+
+// Saves downloads whose progress or status changed in DownloadRegistry, every
+// few seconds or after enough data arrived, so a crash loses at most one
+// interval. Registry fields are read here, the task's own state on the task's
+// thread, and the rows are queued to the database as one batch.
+class CheckpointService : public QObject
+{
+    Q_OBJECT
+public:
+    CheckpointService(AsyncDatabase *database, DownloadRegistry *registry, QObject *parent = nullptr);
+
+    void track(const QUuid &id, std::shared_ptr<DownloadTask> task);
+    void forget(const QUuid &id);
+    void stop();
+
+    void setInterval(int milliseconds);
+    void setByteThreshold(qint64 bytes);
+    void setRoundTimeout(int milliseconds);
+public slots:
+    void flush();
+private:
+    AsyncDatabase *m_database;
+    DownloadRegistry *m_registry;
+    QTimer *m_timer;
+    bool m_stopped{false};
+
+    QHash<QUuid, std::weak_ptr<DownloadTask>> m_tasks;
+    QHash<QUuid, qint64> m_lastBytes;
+    QSet<QUuid> m_dirty;
+    qint64 m_bytesSinceFlush{0};
+    qint64 m_byteThreshold{64LL * 1024 * 1024};
+
+    // One round collects a snapshot from every dirty task before writing.
+    quint64 m_round{0};
+    QSet<QUuid> m_unanswered;
+    QVector<DownloadRecord> m_batch;
+    QElapsedTimer m_roundTimer;
+    int m_roundTimeoutMs{30000};
+
+    void markDirty(const QUuid &id);
+    void onProgress(const QUuid &id, qint64 bytesReceived);
+    void collect(quint64 round, const QUuid &id, const DownloadRecord &record);
+};
+
+#endif // CHECKPOINTSERVICE_H
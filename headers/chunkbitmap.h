@@ -0,0 +1,38 @@
+#ifndef CHUNKBITMAP_H
+#define CHUNKBITMAP_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QPair>
+#include <QVector>
+
+// Which chunks of a download are durably on disk. Stored in the database
+// run-length encoded, so a mostly sequential download takes a few bytes.
+class ChunkBitmap
+{
+public:
+    explicit ChunkBitmap(int count = 0);
+
+    int size() const { return m_bits.size(); };
+    bool isEmpty() const { return m_bits.isEmpty(); };
+    void resize(int count);
+    void clear();
+
+    void set(int index);
+    bool test(int index) const;
+    int completedCount() const;
+    bool isComplete() const;
+
+    int firstMissing(int from = 0) const;
+    QVector<QPair<int, int>> missingRuns(int from = 0) const;
+    qint64 completedBytes(qint64 chunkSize, qint64 totalBytes) const;
+
+    QByteArray toRle() const;
+    static ChunkBitmap fromRle(const QByteArray &data);
+
+    bool operator==(const ChunkBitmap &other) const { return m_bits == other.m_bits; };
+private:
+    QBitArray m_bits;
+};
+
+#endif // CHUNKBITMAP_H
@@ -4,7 +4,12 @@
 #include <QObject>
 #include <QByteArray>
 #include <QCryptographicHash>
+#include <QIODevice>
+#include <QVector>
 #include <QDebug>
+#include <memory>
+
+#include "streamdecoder.h"
 
 class ChunkProcessor : public QObject
 {
@@ -15,16 +20,41 @@ public:
     void reset(int startChunkIndex = 0);
     qint64 getCurrentIndex() {return m_currentChunkIndex;};
     void setCryptographicAlgorithm(QCryptographicHash::Algorithm algoritm);
+    qint64 readFrom(QIODevice *device);
+    qint64 getBytesReceived() const { return m_bytesReceived; };
+    qint64 getPooledBytes() const { return m_pooledBytes; };
+    void setDecoder(std::unique_ptr<StreamDecoder> decoder);
+    StreamDecoder* decoder() const { return m_decoder.get(); };
 public slots:
     void processData(const QByteArray &data);
     void finalize();
 signals:
     void chunkReady(int index, const QByteArray &data, const QByteArray &hash);
+    void decodeFailed();
 private:
     QCryptographicHash::Algorithm m_activeAlgorithm = QCryptographicHash::Sha256;
     QByteArray m_buffer;
+    qint64 m_filled{0};
     qint64 m_chunkSize{1024 * 1024};
     int m_currentChunkIndex{0};
+
+    // Chunks handed to StorageManager share their storage with these entries;
+    // once the writer drops its copy the buffer is detached and reused. The
+    // cap is in bytes, since chunks range from 256 KiB to 16 MiB.
+    QVector<QByteArray> m_pool;
+    qint64 m_pooledBytes{0};
+    const qint64 MAX_POOLED_BYTES{32 * 1024 * 1024};
+
+    qint64 m_bytesReceived{0};
+
+    // With a decoder, network bytes are inflated into m_decoded and chunked
+    // from there; chunk indexes then refer to the decoded file.
+    std::unique_ptr<StreamDecoder> m_decoder;
+    QByteArray m_decoded;
+
+    qint64 decodeFrom(QIODevice *device);
+    void ensureBuffer();
+    void emitChunk();
 };
 
 #endif // CHUNKPROCESSOR_H
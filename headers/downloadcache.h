@@ -0,0 +1,55 @@
+#ifndef DOWNLOADCACHE_H
+#define DOWNLOADCACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QDir>
+
+// Content-addressed store of finished downloads. Objects are named by their
+// SHA-256 and can also be found by URL + ETag; the least recently used ones
+// are evicted once the cache grows past its budget. Thread-safe.
+class DownloadCache
+{
+public:
+    struct Entry {
+        QString hash;
+        QString path;
+        qint64 size = 0;
+    };
+
+    explicit DownloadCache(const QString &directory, qint64 budgetBytes = 10LL * 1024 * 1024 * 1024);
+
+    Entry lookup(const QString &expectedHash, const QString &url, const QString &etag, qint64 expectedSize = -1);
+    bool store(const QString &filePath, const QString &hash, const QString &url, const QString &etag);
+
+    void setBudget(qint64 budgetBytes);
+    qint64 size() const;
+
+    static bool materialize(const QString &source, const QString &target);
+private:
+    struct Object {
+        qint64 size = 0;
+        qint64 lastUsed = 0;
+    };
+
+    mutable QMutex m_mutex;
+    QDir m_dir;
+    qint64 m_budget;
+    qint64 m_size{0};
+    qint64 m_lastUse{0};
+    QHash<QString, Object> m_objects;
+    QHash<QString, QString> m_urls;
+
+    static QString urlKey(const QString &url, const QString &etag);
+    QString objectPath(const QString &hash) const;
+    QString copyIn(const QString &filePath, const QString &hash);
+    QString adopt(const QString &temporaryPath, const QString &hash);
+    void touch(const QString &hash);
+    void evict(const QString &keep);
+    void removeObject(const QString &hash);
+    void load();
+    void save() const;
+};
+
+#endif // DOWNLOADCACHE_H
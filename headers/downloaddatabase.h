@@ -9,17 +9,25 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QMap>
+#include <QHash>
+#include <QUuid>
+#include <QUrl>
+#include <QTimeZone>
 #include <QList>
 #include <QVariant>
 #include <QRegularExpression>
 
 #include "downloadrecord.h"
+#include "downloadtypes.h"
+#include "streamdecoder.h"
 
 class DownloadDatabase : public QObject
 {
     Q_OBJECT
 public:
-    explicit DownloadDatabase(const QString& dbPath = "", QObject *parent = nullptr);
+    // Each thread that touches the database needs its own connection name.
+    explicit DownloadDatabase(const QString& dbPath = "", QObject *parent = nullptr,
+                              const QString& connectionName = QLatin1String(QSqlDatabase::defaultConnection));
     ~DownloadDatabase();
     bool initDatabase(const QString& dbPath = "");
     //int addDownload(const QString&, const QString&);
@@ -27,14 +35,42 @@ public:
     //void updateDownloadStatus(int, const QString&);
     void saveDownloads(QVector<DownloadRecord> records);
     void deleteDownload(DownloadRecord record);
+    bool writeBatch(const QVector<DownloadRecord>& saves, const QStringList& deletedUrls,
+                    const QVector<DownloadTypes::HistoryEntry>& archived = {});
     QVector<DownloadRecord> getDownloads();
+    QVector<DownloadRecord> getActiveDownloads();
+    QVector<DownloadTypes::HistoryEntry> getHistory(int offset, int limit);
+    void deleteHistoryEntry(const QUuid& id);
+    QVector<DownloadTypes::HistoryEntry> searchHistory(const DownloadTypes::HistoryQuery& search);
+
+    static constexpr int SCHEMA_VERSION = 12;
+    int schemaVersion();
 signals:
     void saveSuccesed();
 private:
     QSqlDatabase m_db;
+    QString m_connectionName;
+    QHash<QString, QSqlQuery> m_statements;
+    QSqlQuery& statement(const QString& sql);
+    void configureConnection();
     bool createTables();
+    bool createSchema();
+    bool createIndexes();
+    bool migrate(int fromVersion);
+    bool applyMigration(int version);
+    bool migrateStatusColumn();
+    bool assignUuids();
+    bool assignDecodeFormats();
+    bool archiveFinishedRows();
+    bool archiveLeftoverRows();
+    bool createSearchIndex();
+    bool hasSearchIndex();
+    int m_searchIndex{-1};
+    QVector<DownloadTypes::HistoryEntry> readHistory(QSqlQuery& query);
+    bool ensureColumn(const QString& table, const QString& column, const QString& definition);
     bool isValidRecord(const DownloadRecord& record);
     void bindRecord(QSqlQuery& query, const DownloadRecord& record);
+    QVector<DownloadRecord> readRecords(QSqlQuery& query);
     bool isValidPath(const QString& pathToDataBase);
 protected:
     QString getSystemDatabasePath();
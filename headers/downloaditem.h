@@ -2,29 +2,24 @@
 #define DOWNLOADITEM_H
 
 #include <QObject>
-#include <QWidget>
-#include <QLayout>
-#include <QLabel>
-#include <QPushButton>
-#include <QProgressBar>
 #include <QFileInfo>
-#include <QApplication>
-#include <QListWidget>
-#include <QTimer>
-#include <QToolButton>
+#include <QElapsedTimer>
 #include <QProcess>
 
-#include "toogle.h"
 #include "downloadtask.h"
 #include "downloadrecord.h"
 
 class DownloadItemAdapter;
 
-class DownloadItem : public QWidget
+// State of one row in the download list. Rows are painted by
+// DownloadItemDelegate, so an item owns no widgets; the delegate calls the
+// slots below when its checkbox, switch or buttons are clicked. Progress is
+// only recorded here; texts are formatted when a visible row is painted.
+class DownloadItem : public QObject
 {
     Q_OBJECT
 public:
-    DownloadItem(const QString&, const QString&, const QString&, QWidget* parent = nullptr);
+    DownloadItem(const QString&, const QString&, const QString&, QObject* parent = nullptr);
     ~DownloadItem();
     QString getName() const;
     QString getUrl() const;
@@ -34,74 +29,74 @@ public:
     void setFileName(const QString&);
     qint64 getResumePos() const;
     void updateFromDb(const DownloadRecord &record);
+    // Key of the download in DownloadRegistry.
+    void setId(const QUuid &id) { m_id = id; }
+    QUuid getId() const { return m_id; }
+
+    QString getStatusText() const { return m_statusStr; }
+    QString getSizeText() const;
+    static QString sizeText(qint64 bytesReceived, qint64 bytesTotal);
+    static void revealFile(const QString &filePath);
+    QString getSpeedText() const;
+    QString getTimeToCompleteText() const;
+    int getPercentages() const { return m_percentages; }
+    bool isTransferring() const { return m_transferring; }
+
+    // Called about once a second by the list's refresh tick while transferring.
+    void sampleSpeed();
+    bool isChecked() const { return m_checked; }
+    bool isRunning() const { return m_running; }
+    bool isPauseVisible() const { return m_pauseVisible; }
+    bool isCancelVisible() const { return m_cancelVisible; }
 public slots:
     void onProgressChanged(qint64 bytesReceived, qint64 bytesTotal);
     void deleteItem();
     void onFinished();
     void chackWhatStatus(DownloadTask::Status);
-private slots:
-    void calculateSpeed();
-    void calculateTimeToComplete();
-    void onPauseCheckBox();
-    void updateProgressChange();
-    void onOpenFileInFolder();
+    void setChecked(bool checked);
+    void setRunning(bool running);
+    void cancel();
+    void remove();
+    void openInFolder();
 signals:
     void statusChanged(DownloadTask::Status);
-    void updateProgress();
+    void changed();
     void deleteDownload(DownloadItem*);
     void ChangedBt(DownloadItem*, bool);
     void finishedDownload();
     void deleteFromDb(DownloadItem*);
 private:
+    QUuid m_id;
     QList<qint64> m_speedHistory;
     QString m_nameFileStr;
     QString m_filePath;
     QString m_url;
-    QString m_sizeFileStr;
-    QString m_timeToCompleteStr;
+    QString m_statusStr{"Preparing"};
     qint64 m_lastBytesReceived;
-    qint64 m_totalBytesReceived;
+    qint64 m_totalBytesReceived{0};
     qint64 m_currentSpeed;
-    qint64 m_bytesTotal;
-    qint64 m_timeToComplete;
+    qint64 m_bytesTotal{0};
+    qint64 m_timeToComplete{0};
+    bool m_progressReported{false};
+    bool m_speedSampled{false};
 
     qint64 m_resumePosPercentages = 0;
 
     int m_percentages = 0;
     bool m_fromDB = false;
 
-    QVBoxLayout *m_vLayout;
-    QHBoxLayout *m_upperLayout;
-    QHBoxLayout *m_lowerLayout;
-    QHBoxLayout *m_mainLayout;
-
-    QCheckBox *m_checkBox;
-    Toogle *m_pauseCheckBox;
-    QPushButton *m_deleteButton;
-    QPushButton *m_openInFolderButton;
-    QPushButton *m_cancellButton;
-    QLabel *m_nameFile;
-    QLabel *m_progresSize;
-    QLabel *m_speedDownload;
-    QLabel *m_statusDownload;
-    QLabel *m_sizeFile;
-    QLabel *m_timeToCompleteLabel;
-    QProgressBar *m_progressBar;
+    bool m_checked{false};
+    bool m_running{true};
+    bool m_pauseVisible{false};
+    bool m_cancelVisible{true};
+    bool m_transferring{false};
+    bool m_finished{false};
 
-    QProcess *m_process;
-    QTimer *m_timer;
+    QElapsedTimer m_sampleTimer;
 
-    void setUpUI();
-    void setUpConnections();
-    void setUpSpeedTimer();
-
-    void updateSpeedString();
-    void updateTimeToComplete();
-
-    auto createSpacer(int) -> QWidget*;
-    auto createExpandingSpacer() ->QWidget*;
-
-    friend class DownloadAdapter;
+    void onPauseSwitched();
+    void calculateSpeed();
+    void calculateTimeToComplete();
 };
 
 #endif // DOWNLOADITEM_H
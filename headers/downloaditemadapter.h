@@ -11,8 +11,16 @@ class DownloadAdapter
 public:
     DownloadAdapter(){};
     ~DownloadAdapter(){};
-    QVector<DownloadRecord> toRecords(const QVector<QPair<DownloadItem*, std::shared_ptr<DownloadTask>>>& pairs);
-    DownloadRecord toRecord(const DownloadItem* item, std::shared_ptr<DownloadTask> task);
+    QVector<DownloadRecord> toRecords(const QVector<QPair<DownloadTypes::DownloadRecord, std::shared_ptr<DownloadTask>>>& pairs);
+    DownloadRecord toRecord(const DownloadTypes::DownloadRecord &fields, std::shared_ptr<DownloadTask> task);
+
+    // The two halves of toRecord: what DownloadRegistry knows about the
+    // download, and what only the task knows, read on the task's thread.
+    static void fillFromRegistry(DownloadRecord &record, const DownloadTypes::DownloadRecord &fields);
+    static void fillFromTask(DownloadRecord &record, std::shared_ptr<DownloadTask> task);
+
+    static void fillHistoryFromRegistry(DownloadTypes::HistoryEntry &entry, const DownloadTypes::DownloadRecord &fields);
+    static void fillHistoryFromTask(DownloadTypes::HistoryEntry &entry, std::shared_ptr<DownloadTask> task);
 };
 
 #endif // DOWNLOADITEMADAPTER_H
@@ -0,0 +1,51 @@
+#ifndef DOWNLOADITEMDELEGATE_H
+#define DOWNLOADITEMDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QPainter>
+#include <QMouseEvent>
+#include <QApplication>
+
+#include "downloadlistmodel.h"
+#include "toogle.h"
+
+// Paints a download row in the layout the per-row widgets used to have and
+// turns clicks on its checkbox, switch and buttons into calls on the model.
+// Everything it shows comes from the model's roles, so active and history
+// rows are painted alike.
+class DownloadItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit DownloadItemDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    bool editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                     const QModelIndex &index) override;
+private:
+    struct Layout {
+        QRect checkBox;
+        QRect name;
+        QRect openInFolder;
+        QRect cancel;
+        QRect remove;
+        QRect progress;
+        QRect pauseSwitch;
+        QRect status;
+        QRect speed;
+        QRect size;
+        QRect percentages;
+        QRect timeToComplete;
+    };
+
+    Layout layout(const QRect &rect, bool cancellable) const;
+    void paintButton(QPainter *painter, const QStyleOptionViewItem &option, const QRect &rect, const QString &text) const;
+
+    const int ROW_HEIGHT{72};
+    const int MARGIN{6};
+    const int LINE_HEIGHT{24};
+    const int BUTTON_WIDTH{110};
+};
+
+#endif // DOWNLOADITEMDELEGATE_H
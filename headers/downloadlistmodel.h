@@ -0,0 +1,94 @@
+#ifndef DOWNLOADLISTMODEL_H
+#define DOWNLOADLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "downloaditem.h"
+#include "downloadtypes.h"
+
+// Rows of the download list. An active download is backed by its
+// DownloadItem; a finished one is only its HistoryEntry value, so a long
+// history costs no QObjects. Item changes are collected in a dirty set and
+// published on one refresh tick, so the repaint rate does not follow the
+// rate of progress reports.
+class DownloadListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles {
+        ItemRole = Qt::UserRole + 1,
+        StatusRole,
+        ProgressRole,
+        SizeRole,
+        SpeedRole,
+        TimeToCompleteRole,
+        RunningRole,
+        PausableRole,
+        CancellableRole
+    };
+
+    explicit DownloadListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    void addItem(DownloadItem *item);
+    void addItems(const QVector<DownloadItem*> &items);
+    void removeItem(DownloadItem *item);
+    // Null for history rows.
+    DownloadItem* itemAt(int row) const;
+    int rowOf(DownloadItem *item) const;
+
+    void addHistory(const QVector<DownloadTypes::HistoryEntry> &entries);
+    // The row of a finished item keeps its place and check state; the item
+    // may be deleted afterwards.
+    void replaceWithHistory(DownloadItem *item, const DownloadTypes::HistoryEntry &entry);
+    void removeHistory(const QUuid &id);
+    void setHistoryChecked(const QUuid &id, bool checked);
+    int rowOfHistory(const QUuid &id) const;
+
+    // Row buttons, forwarded to the item or, for history rows, to the manager.
+    void openInFolder(int row);
+    void cancel(int row);
+    void remove(int row);
+
+    void setRefreshInterval(int milliseconds);
+public slots:
+    void refresh();
+signals:
+    void historyCheckChanged(const QUuid &id, bool checked);
+    void historyRemovalRequested(const QUuid &id);
+private:
+    struct Row {
+        DownloadItem *item{nullptr};
+        DownloadTypes::HistoryEntry history;
+        bool checked{false};
+    };
+
+    QVector<Row> m_rows;
+    QHash<DownloadItem*, int> m_itemRows;
+    QHash<QUuid, int> m_historyRows;
+
+    QTimer *m_refreshTimer;
+    QSet<DownloadItem*> m_dirty;
+    QSet<DownloadItem*> m_transferring;
+    QElapsedTimer m_sinceSpeedSample;
+    const int REFRESH_INTERVAL_MS{100};
+    const int SPEED_SAMPLE_MS{1000};
+
+    void onItemChanged();
+    void markDirty(DownloadItem *item);
+    void eraseRow(int row);
+    void reindex(int from);
+    QVariant historyData(const Row &row, int role) const;
+};
+
+#endif // DOWNLOADLISTMODEL_H
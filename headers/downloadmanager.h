@@ -10,15 +10,22 @@
 #include <QMessageBox>
 #include <QDir>
 #include <QMap>
+#include <QSet>
+#include <QPointer>
+#include <QStandardPaths>
 
 #include "downloaditem.h"
 #include "threadpool.h"
-#include "downloaddatabase.h"
+#include "asyncdatabase.h"
 #include "downloaditemadapter.h"
 
 #include "downloadtypes.h"
 #include "networkmanager.h"
 #include "storagemanager.h"
+#include "metalinkparser.h"
+#include "downloadcache.h"
+#include "checkpointservice.h"
+#include "downloadregistry.h"
 
 class DownloadManager : public QObject
 {
@@ -27,25 +34,55 @@ public:
     DownloadManager(QObject *parent = nullptr);
     ~DownloadManager();
     void processDownloadRequest(const QString &url, const QString &saveDir, const DownloadTypes::UserChoice& userChoice);
+    void importMetalink(const QString &metalinkPath, const QString &saveDir);
     void setItemsFromDB();
     void prepareToExit();
+    QFuture<QVector<DownloadTypes::HistoryEntry>> searchHistory(const DownloadTypes::HistoryQuery &query);
 private:
     ThreadPool *m_threadPool;
-    DownloadDatabase *m_db;
+    AsyncDatabase *m_db;
+    CheckpointService *m_checkpoints;
     QVector<DownloadItem*> m_selectedItems;
     QVector<DownloadItem*> m_items;
-    QVector<QString> m_urlsDownloading;
-    QHash<DownloadItem*, std::shared_ptr<DownloadTask>> m_itemTask;
 
-    void createAndStartDownload(const QString &url, const QString &filePath, const QString& fileName, qint64 fileSize);
+    // Progress and status of the active downloads live in the registry only;
+    // the tasks report into it and the list, the scheduler and the
+    // checkpoints follow its signals.
+    DownloadRegistry *m_registry;
+    QHash<QUuid, std::shared_ptr<DownloadTask>> m_tasks;
+    QHash<QUuid, DownloadItem*> m_activeItems;
+    // fileOpen connections of downloads whose file is not open yet.
+    QHash<QUuid, QMetaObject::Connection> m_pendingOpens;
+
+    void createAndStartDownload(const RemoteFileInfo &info, const QString &filePath, const QString& fileName,
+                                const QStringList &mirrors = {}, const QString &expectedHash = QString(),
+                                bool decompress = false, int decodeFormat = StreamDecoder::None, qint64 chunkSize = 0, const QVector<QByteArray> &pieceHashes = {});
+    void startTask(const RemoteFileInfo &info, DownloadTypes::DownloadRecord fileInfo, const DownloadCache::Entry &cached,
+                   const QVector<QByteArray> &pieceHashes);
     DownloadTypes::ConflictResult checkForConflicts(const QString &url, const QString &filePuth);
+    void connectTask(DownloadItem *item, std::shared_ptr<DownloadTask> task);
+    void startWhenFileOpen(DownloadItem *item, std::shared_ptr<DownloadTask> task, bool restored);
 
-    NetworkManager *m_networkManager;
     StorageManager *m_storageManager;
     QThread *m_storageThread;
+    std::shared_ptr<DownloadCache> m_cache;
 
     int numOfSavedTask{0};
+    qint64 m_nextQueuePosition{0};
+
+    // History rows are plain values in the list model; the manager keeps
+    // only their ids to skip duplicates and to act on the checked ones.
+    QSet<QUuid> m_historyIds;
+    QSet<QUuid> m_selectedHistory;
+    int m_historyLoaded{0};
+    bool m_historyLoading{false};
+    bool m_historyExhausted{false};
+    const int HISTORY_PAGE_SIZE{100};
 
+    void restoreItems(const QVector<DownloadRecord> &records);
+    void restoreHistory(const QVector<DownloadTypes::HistoryEntry> &entries);
+    void archive(DownloadItem *item);
+    void updateSelectionButtons();
     void checkPoolStatus();
     void saveAllAndQuit();
 public slots:
@@ -54,13 +91,23 @@ public slots:
     void pauseAll();
     void deleteAll();
     void deleteDownload(DownloadItem *item);
+    void changeHistoryBt(const QUuid &id, bool checked);
+    void deleteHistoryEntry(const QUuid &id);
+    void loadMoreHistory();
 private slots:
     void finished();
+    void onProgressChanged(QUuid id, qint64 bytesReceived, qint64 bytesTotal);
+    void onStatusChanged(QUuid id, DownloadTypes::DownloadStatus status);
 signals:
     void showButtons();
     void hideButtons();
     void setDownloadItemFromDB(DownloadItem*);
     void downloadReadyToAdd(DownloadItem*);
+    void historyReadyToAdd(const QVector<DownloadTypes::HistoryEntry> &entries);
+    // The item is no longer used by the manager once this is emitted.
+    void downloadArchived(DownloadItem *item, const DownloadTypes::HistoryEntry &entry);
+    void historyEntryRemoved(const QUuid &id);
+    void historyUnchecked(const QUuid &id);
     void conflictsDetected(const QString &url, const DownloadTypes::ConflictResult &result);
     void deleteDownloadItem(DownloadItem *item);
     void readyToQuit();
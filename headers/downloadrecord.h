@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QVariantMap>
 #include <QDateTime>
+#include <QUuid>
 
 class DownloadRecord : public QObject
 {
@@ -14,20 +15,41 @@ public:
 
     DownloadRecord& operator=(const DownloadRecord&);
 
+    QUuid m_uuid;
     QString m_name;
     QString m_url;
     QString m_filePath;
-    QString m_status = "pending";
+    // Status code, see statusCode().
+    int m_status;
     QString m_expectedHash;
     QString m_actualHash;
     QString m_hashAlgorithm;
+    QString m_etag;
+    QString m_lastModified;
+    QStringList m_mirrors;
+    bool m_decompress = false;
+    int m_decodeFormat = 0;
     QByteArray m_chunkHashes;
+    // Reference hashes of the pieces, from a metalink.
+    QByteArray m_pieceHashes;
+    QByteArray m_chunkBitmap;
 
     qint64 m_totalBytes = 0;
     qint64 m_downloadedBytes = 0;
+    qint64 m_chunkSize = 1024 * 1024;
+    qint64 m_queuePosition = 0;
+    qint64 m_quantityOfChunks = 8;
 
     QDateTime m_createdAt;
 
+    // The database stores statuses as codes numbered in queue order, so
+    // ordering by the code restores the queue.
+    static int statusCode(const QString& status);
+    static QString statusName(int code);
+    static int statusCount();
+    // The code itself when it is known, otherwise the code of "pending".
+    static int validStatusCode(int code);
+
     QVariantMap toVariantMap() const;
     static DownloadRecord fromVariantMap(const QVariantMap& data)
     {
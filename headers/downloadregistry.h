@@ -4,18 +4,39 @@
 #include <QObject>
 #include <QUuid>
 #include <QHash>
-#include <QMutex>
+#include <QVector>
+#include <QReadWriteLock>
+#include <array>
+#include <atomic>
+#include <memory>
 
 #include "downloadtypes.h"
 
+// Records are spread over shards by id, each behind its own read-write lock
+// that only guards the id -> entry map. Progress and status live in atomics
+// of the entry, so updates from many task threads only share a read lock,
+// and signals are emitted after every lock is released.
 class DownloadRegistry : public QObject
 {
     Q_OBJECT
 public:
+    struct Progress {
+        QUuid id;
+        qint64 received{0};
+        qint64 total{0};
+        DownloadTypes::DownloadStatus status{DownloadTypes::DownloadStatus::Preparing};
+    };
+
     explicit DownloadRegistry(QObject *parent = nullptr);
+    // Keeps the record's id when it has one, so a restored download is
+    // registered under the id it was saved with.
     QUuid addRecord(DownloadTypes::DownloadRecord&& record);
+    bool removeRecord(QUuid id);
     DownloadTypes::DownloadRecord getRecord(QUuid id) const;
+    QUuid findByUrl(const QString &url) const;
     QList<DownloadTypes::DownloadRecord> getAllRecords() const;
+    // Counters of every download without copying the records themselves.
+    QVector<Progress> snapshot() const;
 public slots:
     void updateProgress(QUuid id, qint64 received, qint64 total);
     void updateStatus(QUuid id, DownloadTypes::DownloadStatus status);
@@ -23,8 +44,29 @@ signals:
     void progressChanged(QUuid id, qint64 received, qint64 total);
     void statusChanged(QUuid id, DownloadTypes::DownloadStatus status);
 private:
-    mutable QMutex m_mutex;
-    QHash<QUuid, DownloadTypes::DownloadRecord> m_records;
+    struct Entry {
+        explicit Entry(DownloadTypes::DownloadRecord&& fields);
+
+        // Never changed in place; replaced as a whole under the shard's write lock.
+        std::shared_ptr<const DownloadTypes::DownloadRecord> record;
+        std::atomic<qint64> received;
+        std::atomic<qint64> total;
+        std::atomic<int> status;
+
+        DownloadTypes::DownloadRecord toRecord(const DownloadTypes::DownloadRecord &fields) const;
+    };
+
+    struct Shard {
+        mutable QReadWriteLock lock;
+        QHash<QUuid, std::shared_ptr<Entry>> entries;
+    };
+
+    static constexpr int SHARD_COUNT = 16;
+    std::array<Shard, SHARD_COUNT> m_shards;
+
+    Shard& shardFor(const QUuid &id);
+    const Shard& shardFor(const QUuid &id) const;
+    std::shared_ptr<Entry> find(const QUuid &id) const;
 };
 
 #endif // DOWNLOADREGISTRY_H
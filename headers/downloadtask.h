@@ -17,6 +17,10 @@
 #include "chunkprocessor.h"
 #include "networkmanager.h"
 #include "storagemanager.h"
+#include "mirrorscheduler.h"
+#include "segmentdownloader.h"
+#include "chunkbitmap.h"
+#include "progressthrottle.h"
 
 class DownloadTask :  public QObject
 {
@@ -45,7 +49,21 @@ public:
     ~DownloadTask();
     Status getStatus(){ return m_status; };
     DownloadTypes::DownloadRecord getFileInfo() const { return m_fileInfo; };
+    QString getOrigin() const;
     void updateFromDb(const DownloadRecord &record);
+    void setMirrors(const QStringList &mirrors);
+    void setExpectedChunkHashes(const QVector<QByteArray> &hashes);
+    void setPrefetchedData(const QByteArray &data, bool complete);
+    void setCachedSource(const QString &path);
+    // Progress reports sent on and held back by the throttle so far.
+    qint64 publishedProgressCount() const { return m_progressThrottle.publishedCount(); };
+    qint64 suppressedProgressCount() const { return m_progressThrottle.suppressedCount(); };
+
+    // Decoded by array index; the codes are those of DownloadRecord.
+    static Status statusFromCode(int code, Status fallback = Pending);
+    static int statusCode(Status status);
+    static DownloadTypes::DownloadStatus toDownloadStatus(Status status);
+    static Status fromDownloadStatus(DownloadTypes::DownloadStatus status);
 signals:
     void progressChanged(qint64, qint64);
     void statusChanged(DownloadTask::Status);
@@ -58,6 +76,9 @@ signals:
     void stopWrite(const DownloadTypes::DownloadRecord &fileInfo);
     void checkFinished(bool isCorrupted);
     void writeChunk(const DownloadTypes::DownloadRecord &fileInfo, int index, const QByteArray &data);
+    void finishWrite(const DownloadTypes::DownloadRecord &fileInfo, qint64 finalSize);
+    void materializeFromCache(const DownloadTypes::DownloadRecord &fileInfo, const QString &sourcePath);
+    void cacheFile(const DownloadTypes::DownloadRecord &fileInfo, const QString &url, const QString &etag, const QString &hash);
 public slots:
     void startDownload();
     void pauseDownload();
@@ -66,16 +87,27 @@ public slots:
     void stopDownload();
     void setStatus(Status);
     void saveAndWriteChunckHash(int index, const QByteArray &data, const QByteArray &hash);
-    void changeQuantityOfChunks(const DownloadTypes::DownloadRecord &fileInfo, qint64 valueOfChange);
+    void onMaterializeFailed(const DownloadTypes::DownloadRecord &fileInfo);
+    void onChunksSaved(const DownloadTypes::DownloadRecord &fileInfo, const QVector<int> &indices);
 private slots:
     void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
     void onNetworkError(QNetworkReply::NetworkError);
+    void onValidatorsReceived(const QString &etag, const QString &lastModified);
+    void onRangeIgnored();
+    void onTransferFinished();
+    void onEncodingReceived(const QString &contentEncoding);
+    void onDecodeFailed();
+    void checkSegments();
 private:
     QString m_url;
     QString m_remoteExpectedHash;
     QString m_actualHash;
     qint64 m_resumeDownloadPos;
 
+    QString m_etag;
+    QString m_lastModified;
+    QString ifRangeValidator() const;
+
     DownloadTypes::DownloadRecord m_fileInfo;
 
     QStringList m_hashCandidates;
@@ -121,8 +153,62 @@ private:
     ChunkProcessor *m_chunkProcessor;
     NetworkManager *m_networkManager;
 
+    // NetworkManager, ChunkProcessor and the task share a thread, so the data
+    // path runs as direct calls; only writes and UI updates are posted.
     void setUpConnections();
 
+    // The network reports progress for every read; the UI and the checkpoints
+    // get about ten updates a second, and always the last one.
+    ProgressThrottle m_progressThrottle;
+    void publishProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void flushProgress();
+
+    // Start of the body received while probing the URL.
+    QByteArray m_prefetched;
+    bool m_prefetchComplete{false};
+    void consumePrefetched();
+
+    bool m_decodingTransport{false};
+
+    // Chunks the storage thread has confirmed on disk; resume continues from these.
+    ChunkBitmap m_savedChunks;
+    qint64 savedPrefixBytes() const;
+
+    // Copy of the same content in the download cache, used instead of the network.
+    QString m_cachedSource;
+    void beginTransfer();
+    void offerToCache(const QString &verifiedHash);
+
+    // Multi-source mode: the remaining chunks are split across mirrors in
+    // proportion to their measured throughput.
+    QStringList m_mirrors;
+    MirrorScheduler m_mirrorScheduler;
+    QVector<SegmentDownloader*> m_segments;
+    QHash<SegmentDownloader*, int> m_stalledTicks;
+    ChunkBitmap m_receivedChunks;
+    QVector<QByteArray> m_expectedChunkHashes;
+    QTimer *m_segmentWatchdog;
+    int m_segmentsFirstChunk{0};
+    qint64 m_segmentBytes{0};
+    qint64 m_segmentBaseBytes{0};
+    bool m_multiSource{false};
+    const int WATCHDOG_INTERVAL_MS{5000};
+    const int MAX_STALLED_TICKS{2};
+
+    bool useMirrors() const;
+    int lastChunkIndex() const;
+    void startSegments(int firstChunk);
+    void startSegment(int mirror, int firstChunk, int lastChunk);
+    void stopSegments();
+    void onSegmentChunk(SegmentDownloader *segment, int index, const QByteArray &data, const QByteArray &hash);
+    void onSegmentProgress(qint64 bytes);
+    void onSegmentFinished(SegmentDownloader *segment);
+    void onSegmentFailed(SegmentDownloader *segment);
+    void continueSegments(int mirror);
+    void storeChunkHash(int index, const QByteArray &hash);
+    bool matchesReference(int index, const QByteArray &hash) const;
+    void restartFromChunk(int index);
+
     friend class DownloadAdapter;
 };
 
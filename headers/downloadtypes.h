@@ -2,8 +2,10 @@
 #define DOWNLOADTYPES_H
 
 #include <QString>
+#include <QStringList>
 #include <QVector>
 #include <QUuid>
+#include <QDateTime>
 
 class DownloadItem;
 
@@ -26,6 +28,7 @@ enum Action {
 struct UserChoice {
     Action action = Undetermined;
     QString newFileName;
+    bool decompress = false;
 };
 
 
@@ -35,7 +38,50 @@ struct ConflictResult {
     bool existingDownloads;
 };
 
-enum class DownloadStatus { Preparing, Ready, Pending, Downloading, Paused, Error, Completed, Cancelled };
+// Small files use small chunks so a bad chunk is cheap to fetch again; big
+// ones use large chunks to cut per-chunk hashing and write overhead.
+constexpr qint64 DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+inline qint64 chunkSizeFor(qint64 totalBytes) {
+    const qint64 MiB = 1024 * 1024;
+    if (totalBytes <= 0) return DEFAULT_CHUNK_SIZE;
+    if (totalBytes < 16 * MiB) return 256 * 1024;
+    if (totalBytes < 512 * MiB) return MiB;
+    if (totalBytes < 2048 * MiB) return 4 * MiB;
+    if (totalBytes < 8192 * MiB) return 8 * MiB;
+    return 16 * MiB;
+}
+
+// The first eight values are stored in the history and must keep their
+// numbers; the rest carry the finer task states through DownloadRegistry.
+enum class DownloadStatus { Preparing, Ready, Pending, Downloading, Paused, Error, Completed, Cancelled,
+                            FileIntegrityCheck, Resumed, StartNewTask, ResumedInPending, ResumedInDownloading,
+                            PausedNew, PausedResume, Deleted };
+
+// A finished download as kept in the history: no task, no widget state.
+struct HistoryEntry {
+    QUuid id;
+    QString name;
+    QString url;
+    QString filePath;
+    QString hash;
+    QString hashAlgorithm;
+    DownloadStatus status = DownloadStatus::Completed;
+    qint64 totalBytes = 0;
+    QDateTime finishedAt;
+};
+
+// Filters for DownloadDatabase::searchHistory; unset members do not filter.
+struct HistoryQuery {
+    QString text;
+    QVector<DownloadStatus> statuses;
+    QDateTime finishedFrom;
+    QDateTime finishedTo;
+    qint64 minBytes = -1;
+    qint64 maxBytes = -1;
+    int offset = 0;
+    int limit = 50;
+};
 
 struct DownloadRecord {
     QUuid id;
@@ -45,11 +91,19 @@ struct DownloadRecord {
     QString expectedHash;
     QString actualHash;
     QString hashAlgorithm;
+    QString etag;
+    QString lastModified;
+    QStringList mirrors;
     QVector<QByteArray> chunkHashes;
     DownloadStatus status = DownloadStatus::Preparing;
     qint64 totalBytes = 0;
     qint64 downloadedBytes = 0;
     qint64 quantityOfChunks = 8;
+    qint64 chunkSize = DEFAULT_CHUNK_SIZE;
+    bool decompress = false;
+    // StreamDecoder::Format picked from the name the suffix was stripped from.
+    int decodeFormat = 0;
+    qint64 queuePosition = 0;
 
     bool operator==(const DownloadRecord& other) const {
         return id == other.id &&
@@ -59,11 +113,18 @@ struct DownloadRecord {
                expectedHash == other.expectedHash &&
                actualHash == other.actualHash &&
                hashAlgorithm == other.hashAlgorithm &&
+               etag == other.etag &&
+               lastModified == other.lastModified &&
+               mirrors == other.mirrors &&
                chunkHashes == other.chunkHashes &&
                status == other.status &&
                totalBytes == other.totalBytes &&
                downloadedBytes == other.downloadedBytes &&
-               quantityOfChunks == other.quantityOfChunks;
+               quantityOfChunks == other.quantityOfChunks &&
+               chunkSize == other.chunkSize &&
+               decompress == other.decompress &&
+               decodeFormat == other.decodeFormat &&
+               queuePosition == other.queuePosition;
     }
 
     bool operator!=(const DownloadRecord& other) const {
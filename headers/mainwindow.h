@@ -15,9 +15,15 @@
 #include <QTableWidget>
 #include <QList>
 #include <QListWidget>
+#include <QListView>
 #include <QInputDialog>
+#include <QCheckBox>
+#include <QScrollBar>
+#include <QTimer>
 
 #include "downloadmanager.h"
+#include "downloadlistmodel.h"
+#include "downloaditemdelegate.h"
 #include "downloadtypes.h"
 
 class MainWindow : public QMainWindow
@@ -44,7 +50,9 @@ private:
     QLabel *m_nameApp;
     QLineEdit *m_urlInput;
     QPushButton *m_downloadButton;
+    QCheckBox *m_decompressCheckBox;
     QPushButton *m_browseButton;
+    QPushButton *m_metalinkButton;
     QPushButton *m_downloadAllItemsBt;
     QPushButton *m_pauseAllItemsBt;
     QPushButton *m_deleteAllItemsBt;
@@ -55,7 +63,15 @@ private:
     // File path directory
     QString m_dir;
 
-    QListWidget *m_listWidget;
+    // Rows are painted by the delegate, so only the visible ones cost anything.
+    QListView *m_listView;
+    DownloadListModel *m_listModel;
+
+    // History search results replace the list while a query is entered.
+    QLineEdit *m_searchInput;
+    QListWidget *m_searchResults;
+    QTimer *m_searchTimer;
+    void runSearch();
 
     void setLayoutForSelectedItemsBtVisible(bool);
 
@@ -64,9 +80,14 @@ protected:
 private slots:
     void onClickDownloadButton();
     void onClickBrowseButton();
+    void onClickMetalinkButton();
     void deleteDownloadItem(DownloadItem*);
+    void onListScrolled();
+    void onSearchChanged(const QString &text);
 public slots:
     void addDownloadItem(DownloadItem*);
+    void addHistoryEntries(const QVector<DownloadTypes::HistoryEntry> &entries);
+    void archiveDownloadItem(DownloadItem *item, const DownloadTypes::HistoryEntry &entry);
     void handleDownloadConflicts(const QString &url, const DownloadTypes::ConflictResult &conflict);
 };
 #endif // MAINWINDOW_H
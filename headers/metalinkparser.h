@@ -0,0 +1,33 @@
+#ifndef METALINKPARSER_H
+#define METALINKPARSER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QXmlStreamReader>
+
+struct MetalinkFile {
+    QString name;
+    qint64 size = -1;
+    QStringList urls;               // ordered by priority, best first
+    QMap<QString, QString> hashes;  // "sha-256" -> lowercase hex
+    QString pieceType;
+    qint64 pieceLength = 0;
+    QVector<QByteArray> pieceHashes;
+};
+
+// Reads Metalink 4 (RFC 5854) documents.
+class MetalinkParser
+{
+public:
+    static QVector<MetalinkFile> parse(const QByteArray &document, QString *error = nullptr);
+    static QVector<MetalinkFile> parseFile(const QString &path, QString *error = nullptr);
+private:
+    MetalinkParser() = default;
+
+    static MetalinkFile readFile(QXmlStreamReader &reader);
+    static void readPieces(QXmlStreamReader &reader, MetalinkFile &file);
+};
+
+#endif // METALINKPARSER_H
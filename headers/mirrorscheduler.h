@@ -0,0 +1,44 @@
+#ifndef MIRRORSCHEDULER_H
+#define MIRRORSCHEDULER_H
+
+#include <QStringList>
+#include <QVector>
+#include <QUrl>
+
+class MirrorScheduler
+{
+public:
+    struct Mirror {
+        QUrl url;
+        double throughput = 0;
+        int failures = 0;
+        bool enabled = true;
+    };
+
+    struct Segment {
+        int mirror = -1;
+        int firstChunk = 0;
+        int lastChunk = -1;
+    };
+
+    void setMirrors(const QStringList &urls);
+    int count() const { return m_mirrors.size(); };
+    int activeCount() const;
+    QUrl url(int mirror) const { return m_mirrors.value(mirror).url; };
+    const Mirror& mirror(int mirror) const { return m_mirrors[mirror]; };
+
+    void reportThroughput(int mirror, double bytesPerSecond);
+    void reportFailure(int mirror);
+    int bestMirror(int exclude = -1) const;
+
+    QVector<Segment> assign(int firstChunk, int lastChunk) const;
+private:
+    QVector<Mirror> m_mirrors;
+
+    const int MAX_FAILURES{3};
+    const double SMOOTHING{0.3};
+
+    double weight(int mirror) const;
+};
+
+#endif // MIRRORSCHEDULER_H
@@ -6,6 +6,11 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QFileInfo>
+#include <QPointer>
+#include <utility>
+
+#include "networksession.h"
+#include "chunkprocessor.h"
 
 struct RemoteFileInfo {
     QUrl url;
@@ -16,6 +21,10 @@ struct RemoteFileInfo {
     bool isValid = false;
     QString errorString;
     QString suffix;
+    QString etag;
+    QString lastModified;
+    QByteArray prefetched;
+    bool complete = false;
 };
 
 
@@ -25,11 +34,14 @@ class NetworkManager : public QObject
 public:
     explicit NetworkManager(QObject *parent = nullptr);
     void getRemoteFileInfo(const QUrl &url);
+    void probeRemoteFile(const QUrl &url);
+    void setChunkProcessor(ChunkProcessor *processor);
+    void setAcceptEncoding(const QByteArray &encodings);
     void abort();
 public slots:
-    void startDownload(const QUrl &url, qint64 startByte = 0);
+    void startDownload(const QUrl &url, qint64 startByte = 0, const QString &ifRange = QString(), qint64 endByte = -1);
 private:
-    QNetworkRequest prepareRequest(const QUrl &url, qint64 startByte = 0);
+    QNetworkRequest prepareRequest(const QUrl &url, qint64 startByte = 0, const QString &ifRange = QString(), qint64 endByte = -1);
     QString parseFileName(QNetworkReply *reply);
 signals:
     void fileInfoReady(RemoteFileInfo fileInfo);
@@ -37,14 +49,29 @@ signals:
     void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
     void errorOccurred(QNetworkReply::NetworkError error);
     void finished();
+    void validatorsReceived(const QString &etag, const QString &lastModified);
+    void rangeIgnored();
+    void remoteSizeReceived(qint64 totalSize);
+    void encodingReceived(const QString &contentEncoding);
 private slots:
     void onReadyRead();
+    void onMetaDataChanged();
     void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
     void onFinished();
     void onError(QNetworkReply::NetworkError);
+    void onProbeMetaDataChanged();
+    void onProbeReadyRead();
+    void onProbeFinished();
 private:
-    QNetworkAccessManager *m_manager;
-    QNetworkReply *m_reply;
+    QPointer<QNetworkReply> m_reply;
+    QPointer<QNetworkReply> m_probeReply;
+    RemoteFileInfo m_probeInfo;
+    const qint64 PREFETCH_LIMIT{1024 * 1024};
+    void finishProbe();
+    ChunkProcessor *m_chunkProcessor{nullptr};
+    qint64 m_startByte{0};
+    bool m_ranged{false};
+    QByteArray m_acceptEncoding{"identity"};
 };
 
 
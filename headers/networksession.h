@@ -0,0 +1,20 @@
+#ifndef NETWORKSESSION_H
+#define NETWORKSESSION_H
+
+#include <QNetworkAccessManager>
+#include <QThreadStorage>
+
+// One QNetworkAccessManager per thread. Every NetworkManager and hash probe
+// running on the same thread goes through it, so keep-alive connections,
+// HTTP/2 sessions, TLS sessions and DNS results are reused per host.
+class NetworkSession
+{
+public:
+    static QNetworkAccessManager* manager();
+private:
+    NetworkSession() = default;
+
+    static QThreadStorage<QNetworkAccessManager*> s_managers;
+};
+
+#endif // NETWORKSESSION_H
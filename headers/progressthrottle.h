@@ -0,0 +1,44 @@
+#ifndef PROGRESSTHROTTLE_H
+#define PROGRESSTHROTTLE_H
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+
+// Decides which progress reports of a transfer are worth publishing. A report
+// goes out once both the interval and the byte step have passed since the
+// last published one, or after MAX_SILENCE_MS with any change at all. The
+// first report, the one reaching the total and a step backwards always go
+// out; a suppressed report is kept so it can be flushed when the transfer stops.
+class ProgressThrottle
+{
+public:
+    explicit ProgressThrottle(qint64 intervalMs = 100, qint64 byteStep = 64 * 1024);
+
+    void setInterval(qint64 milliseconds) { m_intervalMs = milliseconds; };
+    void setByteStep(qint64 bytes) { m_byteStep = bytes; };
+
+    bool shouldPublish(qint64 received, qint64 total);
+    bool takePending(qint64 &received, qint64 &total);
+    void reset();
+
+    qint64 publishedCount() const { return m_published; };
+    qint64 suppressedCount() const { return m_suppressed; };
+private:
+    qint64 m_intervalMs;
+    qint64 m_byteStep;
+    const qint64 MAX_SILENCE_MS{1000};
+
+    QElapsedTimer m_sincePublished;
+    qint64 m_lastReceived{0};
+
+    bool m_hasPending{false};
+    qint64 m_pendingReceived{0};
+    qint64 m_pendingTotal{0};
+
+    qint64 m_published{0};
+    qint64 m_suppressed{0};
+
+    void markPublished(qint64 received);
+};
+
+#endif // PROGRESSTHROTTLE_H
@@ -0,0 +1,63 @@
+#ifndef SEGMENTDOWNLOADER_H
+#define SEGMENTDOWNLOADER_H
+
+#include <QObject>
+#include <QUrl>
+#include <QCryptographicHash>
+
+#include "networkmanager.h"
+#include "chunkprocessor.h"
+
+// Downloads one chunk-aligned byte range of a file from one mirror.
+class SegmentDownloader : public QObject
+{
+    Q_OBJECT
+public:
+    SegmentDownloader(int mirror, const QUrl &url, int firstChunk, int lastChunk,
+                      qint64 chunkSize, qint64 totalBytes, QCryptographicHash::Algorithm algorithm,
+                      QObject *parent = nullptr);
+    void start();
+    void abort();
+    void shrinkTo(int lastChunk);
+
+    int mirror() const { return m_mirror; };
+    int nextChunk() const { return m_nextChunk; };
+    int lastChunk() const { return m_lastChunk; };
+    int remainingChunks() const { return m_lastChunk - m_nextChunk + 1; };
+    bool isFinished() const { return m_finished; };
+    qint64 takeBytesSinceSample();
+    void rejectChunk(int index);
+signals:
+    void chunkReady(int index, const QByteArray &data, const QByteArray &hash);
+    void progress(qint64 bytes);
+    void finished();
+    void failed();
+private slots:
+    void onChunkReady(int index, const QByteArray &data, const QByteArray &hash);
+    void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void onNetworkFinished();
+    void onRemoteSize(qint64 totalSize);
+    void onRangeIgnored();
+    void reportFailure();
+public slots:
+    void fail();
+private:
+    int m_mirror;
+    QUrl m_url;
+    int m_nextChunk;
+    int m_lastChunk;
+    qint64 m_chunkSize;
+    qint64 m_totalBytes;
+
+    qint64 m_lastProgress{0};
+    qint64 m_bytesSinceSample{0};
+    bool m_finished{false};
+    bool m_failed{false};
+
+    NetworkManager *m_networkManager;
+    ChunkProcessor *m_chunkProcessor;
+
+    void complete();
+};
+
+#endif // SEGMENTDOWNLOADER_H
@@ -8,6 +8,7 @@
 #include <QElapsedTimer>
 
 #include "downloadtypes.h"
+#include "downloadcache.h"
 
 
 class StorageManager : public QObject
@@ -16,30 +17,36 @@ class StorageManager : public QObject
 public:
     StorageManager(QObject *parent = nullptr);
     ~StorageManager();
+    void setCache(std::shared_ptr<DownloadCache> cache);
 public slots:
     void openFile(const DownloadTypes::DownloadRecord &fileInfo);
     void writeChunk(const DownloadTypes::DownloadRecord &fileInfo, int index, const QByteArray &data);
     void clearFile(const DownloadTypes::DownloadRecord &fileInfo);
     void closeFile(const DownloadTypes::DownloadRecord &ileInfo);
+    void finishFile(const DownloadTypes::DownloadRecord &fileInfo, qint64 finalSize = -1);
     void deleteAllInfo(const DownloadTypes::DownloadRecord &fileInfo);
+    void materializeFile(const DownloadTypes::DownloadRecord &fileInfo, const QString &sourcePath);
+    void cacheFile(const DownloadTypes::DownloadRecord &fileInfo, const QString &url, const QString &etag, const QString &hash);
 signals:
-    void chunkSaved(int index);
+    void chunksSaved(const DownloadTypes::DownloadRecord &fileInfo, const QVector<int> &indices);
     void savedLastChunk(const DownloadTypes::DownloadRecord &fileInfo);
     void errorOccurred(const QString &message);
     void fileOpen(const DownloadTypes::DownloadRecord &fileInfo);
-    void changeQuantityOfChunks(const DownloadTypes::DownloadRecord &fileInfo, qint64 valueOfChange);
+    void materializeFailed(const DownloadTypes::DownloadRecord &fileInfo);
 private:
-    qint64 m_chunkSize{1024 * 1024};
     qint64 position{0};
 
-    QMap<DownloadTypes::DownloadRecord, QVector<QByteArray>> m_data;
+    QMap<DownloadTypes::DownloadRecord, QVector<QPair<int, QByteArray>>> m_data;
 
     QMap<DownloadTypes::DownloadRecord, std::shared_ptr<QFile>> m_files;
 
-    void writeToDisk(const DownloadTypes::DownloadRecord &fileInfo, qint64 index);
-    void flushAllData(const DownloadTypes::DownloadRecord &fileInfo);
+    QMap<DownloadTypes::DownloadRecord, qint64> m_quantityOfChunks;
 
-    void updateQuantityOfChunks(const DownloadTypes::DownloadRecord &fileInfo, qint64 writeTime, qint64 dataSize);
+    std::shared_ptr<DownloadCache> m_cache;
+
+    void writeToDisk(const DownloadTypes::DownloadRecord &fileInfo);
+
+    void updateQuantityOfChunks(const DownloadTypes::DownloadRecord &fileInfo, qint64 writeTime, qint64 dataMiB);
 };
 
 #endif // STORAGEMANAGER_H
@@ -0,0 +1,58 @@
+#ifndef STREAMDECODER_H
+#define STREAMDECODER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QCryptographicHash>
+#include <memory>
+
+// Incremental gzip/zstd/xz decoder sitting between the network and the chunk
+// pipeline. Both the compressed and the decoded stream are hashed on the fly,
+// so the result can be verified without reading the file back.
+class StreamDecoder
+{
+public:
+    enum Format {
+        None,
+        Gzip,
+        Zstd,
+        Xz
+    };
+
+    explicit StreamDecoder(Format format, QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha256);
+    ~StreamDecoder();
+
+    static Format formatForEncoding(const QString &contentEncoding);
+    static Format formatForFileName(const QString &fileName);
+    static bool isSupported(Format format);
+    static QByteArray acceptEncoding();
+    static QString decodedFileName(const QString &fileName);
+
+    Format format() const { return m_format; };
+    bool decode(const char *data, qint64 size, QByteArray &out);
+    bool finish(QByteArray &out);
+    bool hasError() const { return m_error; };
+
+    qint64 compressedBytes() const { return m_compressedBytes; };
+    qint64 decodedBytes() const { return m_decodedBytes; };
+    QByteArray compressedHash() const { return m_compressedHash.result().toHex(); };
+    QByteArray decodedHash() const { return m_decodedHash.result().toHex(); };
+private:
+    struct State;
+    std::unique_ptr<State> m_state;
+
+    Format m_format;
+    bool m_error{false};
+    bool m_streamEnded{false};
+
+    qint64 m_compressedBytes{0};
+    qint64 m_decodedBytes{0};
+    QCryptographicHash m_compressedHash;
+    QCryptographicHash m_decodedHash;
+
+    const qint64 OUTPUT_STEP{256 * 1024};
+
+    bool run(const char *data, qint64 size, QByteArray &out, bool finishing);
+};
+
+#endif // STREAMDECODER_H
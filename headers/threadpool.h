@@ -7,6 +7,7 @@
 #include <QThread>
 #include <QQueue>
 #include <QMutex>
+#include <algorithm>
 
 #include "downloaditem.h"
 #include "downloadtask.h"
@@ -20,6 +21,7 @@ public:
     void addTaskFromDB(std::shared_ptr<DownloadTask> task);
     void stopAllDownloads(QVector<std::shared_ptr<DownloadTask>>& tasks);
     void removeTask(std::shared_ptr<DownloadTask>);
+    void setBatchMode(bool enabled);
     ~ThreadPool();
 signals:
     void allDownloadsStoped();
@@ -27,17 +29,25 @@ public slots:
     void onTaskFinished(std::shared_ptr<DownloadTask> task);
     void resumeDownload(std::shared_ptr<DownloadTask> task);
     void onTaskPaused(std::shared_ptr<DownloadTask> task);
-    void chackWhatStatus(DownloadTask::Status status);
+    void chackWhatStatus(DownloadTask *rawTask, DownloadTask::Status status);
 private:
     mutable QRecursiveMutex m_mutex;
     int m_maxThread;
     QVector<QThread*> m_idleThreads;
-    QHash<QThread*, std::shared_ptr<DownloadTask>> m_busyThreads;
+    QMultiHash<QThread*, std::shared_ptr<DownloadTask>> m_busyThreads;
+
+    bool m_batchMode{true};
+    const qint64 BATCH_FILE_LIMIT{8 * 1024 * 1024};
+    const int MAX_STREAMS_PER_BATCH{32};
 
     QQueue<std::shared_ptr<DownloadTask>> m_pendingQueue;
 
     void startNewTask(std::shared_ptr<DownloadTask> task);
     void returnThreadToPool(QThread*);
+    void releaseTask(QThread*, std::shared_ptr<DownloadTask> task);
+    QThread* acquireThread(std::shared_ptr<DownloadTask> task);
+    QThread* findBatchThread(std::shared_ptr<DownloadTask> task) const;
+    bool isBatchable(std::shared_ptr<DownloadTask> task) const;
     void startNextTask();
 
     void calculateMaxThreads();
@@ -18,6 +18,10 @@ private:
 public:
     Toogle(int width, const QColor& bg_color, const QColor& circle_color, const QColor& active_color, QWidget* parent = nullptr);
     void paintEvent(QPaintEvent*) override;
+
+    // Shared with the download list delegate, which paints switches without a widget.
+    static void paintSwitch(QPainter *painter, const QRect &rect, bool checked,
+                            const QColor& bgColor, const QColor& circleColor, const QColor& activeColor);
 };
 
 #endif // TOOGLE_H
@@ -0,0 +1,173 @@
+#include "../headers/asyncdatabase.h"
+
+AsyncDatabase::AsyncDatabase(const QString &dbPath, QObject *parent) : QObject(parent){
+    m_thread = new QThread(this);
+    m_thread->setObjectName("DatabaseThread");
+
+    // Commands run as functors on this object, so m_database is only ever
+    // touched from the database thread.
+    m_context = new QObject();
+    m_retryTimer = new QTimer(m_context);
+    m_retryTimer->setSingleShot(true);
+    m_retryDelayMs = FIRST_RETRY_MS;
+    connect(m_retryTimer, &QTimer::timeout, m_context, [this](){ drain(); });
+    m_context->moveToThread(m_thread);
+    m_thread->start();
+
+    QString connectionName = QString("async-%1").arg(reinterpret_cast<quintptr>(this));
+    QMetaObject::invokeMethod(m_context, [this, dbPath, connectionName](){
+        m_database = new DownloadDatabase(dbPath, nullptr, connectionName);
+    }, Qt::QueuedConnection);
+}
+
+AsyncDatabase::~AsyncDatabase(){
+    // A failed last drain would start the retry timer again.
+    QMetaObject::invokeMethod(m_context, [this](){
+        drain();
+        m_retryTimer->stop();
+        delete m_database;
+        m_database = nullptr;
+    }, Qt::BlockingQueuedConnection);
+
+    m_thread->quit();
+    m_thread->wait();
+    delete m_context;
+}
+
+void AsyncDatabase::save(const DownloadRecord &record){
+    Command command;
+    command.record = record;
+    enqueue(record.m_url, command);
+}
+
+void AsyncDatabase::save(const QVector<DownloadRecord> &records){
+    for(const DownloadRecord &record : records){
+        save(record);
+    }
+}
+
+// Also drops a save still queued for the same URL.
+void AsyncDatabase::remove(const QString &url){
+    Command command;
+    command.kind = Command::Remove;
+    enqueue(url, command);
+}
+
+// Moves the download out of the queue table; replaces a save still queued
+// for the same URL.
+void AsyncDatabase::archive(const DownloadTypes::HistoryEntry &entry){
+    Command command;
+    command.kind = Command::Archive;
+    command.entry = entry;
+    enqueue(entry.url, command);
+}
+
+void AsyncDatabase::removeHistory(const QUuid &id){
+    QMetaObject::invokeMethod(m_context, [this, id](){
+        drain();
+        if(m_database) m_database->deleteHistoryEntry(id);
+    }, Qt::QueuedConnection);
+}
+
+int AsyncDatabase::pendingCount() const{
+    QMutexLocker locker(&m_mutex);
+    return m_pending.size();
+}
+
+void AsyncDatabase::enqueue(const QString &url, const Command &command){
+    QMutexLocker locker(&m_mutex);
+    m_pending.insert(url, command);
+    if(m_drainScheduled) return;
+
+    m_drainScheduled = true;
+    QMetaObject::invokeMethod(m_context, [this](){ drain(); }, Qt::QueuedConnection);
+}
+
+bool AsyncDatabase::drain(){
+    QHash<QString, Command> batch;
+    {
+        QMutexLocker locker(&m_mutex);
+        batch.swap(m_pending);
+        m_drainScheduled = false;
+    }
+    if(batch.isEmpty()) return true;
+    if(!m_database) return false;
+
+    QVector<DownloadRecord> saves;
+    QStringList removals;
+    QVector<DownloadTypes::HistoryEntry> archived;
+    for(auto it = batch.cbegin(); it != batch.cend(); ++it){
+        switch(it->kind){
+        case Command::Save: saves.append(it->record); break;
+        case Command::Remove: removals.append(it.key()); break;
+        case Command::Archive: archived.append(it->entry); break;
+        }
+    }
+
+    if(m_database->writeBatch(saves, removals, archived)){
+        m_retryDelayMs = FIRST_RETRY_MS;
+        emit saved(saves.size());
+        return true;
+    }
+
+    // Keep the failed commands for the next drain unless newer ones replaced
+    // them. Commands queued meanwhile wait for the retry too.
+    QMutexLocker locker(&m_mutex);
+    for(auto it = batch.cbegin(); it != batch.cend(); ++it){
+        if(!m_pending.contains(it.key())) m_pending.insert(it.key(), it.value());
+    }
+    qDebug() << "Retrying" << m_pending.size() << "database commands in" << m_retryDelayMs << "ms";
+    m_drainScheduled = true;
+    m_retryTimer->start(m_retryDelayMs);
+    m_retryDelayMs = qMin(m_retryDelayMs * 2, MAX_RETRY_MS);
+    return false;
+}
+
+QFuture<QVector<DownloadRecord>> AsyncDatabase::loadDownloads(){
+    return read<QVector<DownloadRecord>>([](DownloadDatabase *database){ return database->getDownloads(); });
+}
+
+QFuture<QVector<DownloadRecord>> AsyncDatabase::loadActiveDownloads(){
+    return read<QVector<DownloadRecord>>([](DownloadDatabase *database){ return database->getActiveDownloads(); });
+}
+
+QFuture<QVector<DownloadTypes::HistoryEntry>> AsyncDatabase::loadHistory(int offset, int limit){
+    return read<QVector<DownloadTypes::HistoryEntry>>([offset, limit](DownloadDatabase *database){
+        return database->getHistory(offset, limit);
+    });
+}
+
+QFuture<QVector<DownloadTypes::HistoryEntry>> AsyncDatabase::searchHistory(const DownloadTypes::HistoryQuery &query){
+    return read<QVector<DownloadTypes::HistoryEntry>>([query](DownloadDatabase *database){
+        return database->searchHistory(query);
+    });
+}
+
+QFuture<bool> AsyncDatabase::flush(){
+    auto promise = std::make_shared<QPromise<bool>>();
+    promise->start();
+
+    QMetaObject::invokeMethod(m_context, [this, promise](){
+        flushAttempt(promise, 1);
+    }, Qt::QueuedConnection);
+
+    return promise->future();
+}
+
+// A failed drain has put its commands back; they are tried again after the
+// same growing delay as the background retries.
+void AsyncDatabase::flushAttempt(std::shared_ptr<QPromise<bool>> promise, int attempt){
+    bool committed = drain();
+    if(!committed && attempt < MAX_FLUSH_ATTEMPTS){
+        QTimer::singleShot(m_retryDelayMs, m_context, [this, promise, attempt](){
+            flushAttempt(promise, attempt + 1);
+        });
+        return;
+    }
+
+    if(!committed){
+        qDebug() << "Flush gave up after" << attempt << "attempts," << pendingCount() << "database commands unsaved";
+    }
+    promise->addResult(committed);
+    promise->finish();
+}
@@ -0,0 +1,117 @@
+#include "../headers/checkpointservice.h"
+#include "../headers/downloaditemadapter.h"
+
+CheckpointService::CheckpointService(AsyncDatabase *database, DownloadRegistry *registry, QObject *parent) :
+    QObject(parent),
+    m_database(database),
+    m_registry(registry)
+{
+    m_timer = new QTimer(this);
+    m_timer->setInterval(5000);
+    connect(m_timer, &QTimer::timeout, this, &CheckpointService::flush);
+    m_timer->start();
+
+    // The registry emits on the task threads.
+    connect(m_registry, &DownloadRegistry::progressChanged, this, [this](QUuid id, qint64 bytesReceived, qint64){
+        onProgress(id, bytesReceived);
+    }, Qt::QueuedConnection);
+    connect(m_registry, &DownloadRegistry::statusChanged, this, [this](QUuid id){
+        markDirty(id);
+    }, Qt::QueuedConnection);
+}
+
+void CheckpointService::setInterval(int milliseconds){
+    m_timer->setInterval(milliseconds);
+}
+
+void CheckpointService::setByteThreshold(qint64 bytes){
+    m_byteThreshold = bytes;
+}
+
+void CheckpointService::setRoundTimeout(int milliseconds){
+    m_roundTimeoutMs = milliseconds;
+}
+
+void CheckpointService::track(const QUuid &id, std::shared_ptr<DownloadTask> task){
+    if(id.isNull() || !task) return;
+
+    m_tasks[id] = task;
+    m_lastBytes[id] = 0;
+}
+
+// A deleted download must not be written back by a later checkpoint.
+void CheckpointService::forget(const QUuid &id){
+    m_tasks.remove(id);
+    m_lastBytes.remove(id);
+    m_dirty.remove(id);
+}
+
+// Pending changes are left to the final save on exit.
+void CheckpointService::stop(){
+    m_timer->stop();
+    m_stopped = true;
+}
+
+void CheckpointService::markDirty(const QUuid &id){
+    if(m_tasks.contains(id)) m_dirty.insert(id);
+}
+
+void CheckpointService::onProgress(const QUuid &id, qint64 bytesReceived){
+    if(!m_tasks.contains(id)) return;
+
+    qint64 &last = m_lastBytes[id];
+    if(bytesReceived > last) m_bytesSinceFlush += bytesReceived - last;
+    last = bytesReceived;
+    m_dirty.insert(id);
+
+    if(m_bytesSinceFlush >= m_byteThreshold) flush();
+}
+
+void CheckpointService::flush(){
+    if(m_stopped) return;
+
+    // A task whose thread has gone away never answers; give up on that round,
+    // keep what did arrive and ask the silent tasks again next time.
+    if(!m_unanswered.isEmpty()){
+        if(m_roundTimer.elapsed() < m_roundTimeoutMs) return;
+
+        for(const QUuid &id : std::exchange(m_unanswered, {})) markDirty(id);
+        if(!m_batch.isEmpty()) m_database->save(std::exchange(m_batch, {}));
+    }
+    if(m_dirty.isEmpty()) return;
+
+    ++m_round;
+    m_batch.clear();
+    m_bytesSinceFlush = 0;
+    m_roundTimer.start();
+
+    const QSet<QUuid> dirty = std::exchange(m_dirty, {});
+    for(const QUuid &id : dirty){
+        std::shared_ptr<DownloadTask> task = m_tasks.value(id).lock();
+        if(!task) continue;
+
+        DownloadTypes::DownloadRecord fields = m_registry->getRecord(id);
+        if(fields.id.isNull()) continue;
+
+        DownloadRecord record;
+        DownloadAdapter::fillFromRegistry(record, fields);
+
+        m_unanswered.insert(id);
+        quint64 round = m_round;
+        QMetaObject::invokeMethod(task.get(), [this, task, id, record, round]() mutable {
+            DownloadAdapter::fillFromTask(record, task);
+            QMetaObject::invokeMethod(this, [this, id, record, round](){
+                collect(round, id, record);
+            }, Qt::QueuedConnection);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void CheckpointService::collect(quint64 round, const QUuid &id, const DownloadRecord &record){
+    if(round != m_round || !m_unanswered.remove(id)) return;
+
+    if(m_tasks.contains(id)) m_batch.append(record);
+    if(!m_unanswered.isEmpty() || m_batch.isEmpty() || m_stopped) return;
+
+    m_database->save(std::exchange(m_batch, {}));
+}
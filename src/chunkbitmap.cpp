@@ -0,0 +1,128 @@
+#include "../headers/chunkbitmap.h"
+
+#include <limits>
+
+namespace {
+
+void appendVarint(QByteArray &out, quint64 value){
+    while(value >= 0x80){
+        out.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+bool readVarint(const QByteArray &data, int &position, quint64 &value){
+    value = 0;
+    for(int shift = 0; shift < 64 && position < data.size(); shift += 7){
+        quint8 byte = static_cast<quint8>(data[position++]);
+        value |= quint64(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+}
+
+ChunkBitmap::ChunkBitmap(int count) : m_bits(count) {}
+
+void ChunkBitmap::resize(int count){
+    m_bits.resize(count);
+}
+
+void ChunkBitmap::clear(){
+    m_bits.fill(false);
+}
+
+// Grows on demand, for downloads whose size was not known up front.
+void ChunkBitmap::set(int index){
+    if(index < 0) return;
+    if(index >= m_bits.size()) m_bits.resize(index + 1);
+    m_bits.setBit(index);
+}
+
+bool ChunkBitmap::test(int index) const{
+    return index >= 0 && index < m_bits.size() && m_bits.testBit(index);
+}
+
+int ChunkBitmap::completedCount() const{
+    return static_cast<int>(m_bits.count(true));
+}
+
+bool ChunkBitmap::isComplete() const{
+    return !m_bits.isEmpty() && completedCount() == m_bits.size();
+}
+
+int ChunkBitmap::firstMissing(int from) const{
+    int index = qMax(0, from);
+    while(index < m_bits.size() && m_bits.testBit(index)){
+        ++index;
+    }
+    return index;
+}
+
+QVector<QPair<int, int>> ChunkBitmap::missingRuns(int from) const{
+    QVector<QPair<int, int>> runs;
+    int index = firstMissing(from);
+    while(index < m_bits.size()){
+        int end = index;
+        while(end + 1 < m_bits.size() && !m_bits.testBit(end + 1)){
+            ++end;
+        }
+        runs.append(qMakePair(index, end));
+        index = firstMissing(end + 1);
+    }
+    return runs;
+}
+
+// The last chunk may be short, so it counts only up to the end of the file.
+qint64 ChunkBitmap::completedBytes(qint64 chunkSize, qint64 totalBytes) const{
+    qint64 bytes = static_cast<qint64>(completedCount()) * chunkSize;
+    if(totalBytes > 0 && test(m_bits.size() - 1)){
+        bytes -= static_cast<qint64>(m_bits.size()) * chunkSize - totalBytes;
+    }
+    return qMax<qint64>(0, bytes);
+}
+
+// Chunk count followed by alternating run lengths, starting with a run of
+// missing chunks (which may be empty), all as LEB128 varints.
+QByteArray ChunkBitmap::toRle() const{
+    QByteArray out;
+    if(m_bits.isEmpty()) return out;
+
+    appendVarint(out, m_bits.size());
+
+    bool value = false;
+    int runStart = 0;
+    for(int i = 0; i <= m_bits.size(); ++i){
+        if(i == m_bits.size() || m_bits.testBit(i) != value){
+            appendVarint(out, i - runStart);
+            runStart = i;
+            value = !value;
+        }
+    }
+    return out;
+}
+
+ChunkBitmap ChunkBitmap::fromRle(const QByteArray &data){
+    int position = 0;
+    quint64 count = 0;
+    if(data.isEmpty() || !readVarint(data, position, count) || count > quint64(std::numeric_limits<int>::max())){
+        return ChunkBitmap();
+    }
+
+    ChunkBitmap bitmap(static_cast<int>(count));
+    quint64 index = 0;
+    bool value = false;
+    while(position < data.size()){
+        quint64 run = 0;
+        if(!readVarint(data, position, run) || run > count - index) return ChunkBitmap();
+
+        if(value) bitmap.m_bits.fill(true, static_cast<int>(index), static_cast<int>(index + run));
+        index += run;
+        value = !value;
+    }
+
+    if(index != count) return ChunkBitmap();
+    return bitmap;
+}
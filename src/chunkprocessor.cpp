@@ -1,5 +1,7 @@
 #include "../headers/chunkprocessor.h"
 
+#include <cstring>
+
 ChunkProcessor::ChunkProcessor(QObject *parent) : QObject(parent) {}
 
 void ChunkProcessor::setChunkSize(qint64 size)
@@ -13,28 +15,124 @@ void ChunkProcessor::setCryptographicAlgorithm(QCryptographicHash::Algorithm alg
 
 void ChunkProcessor::reset(int startChunkIndex)
 {
-    m_buffer.clear();
+    m_filled = 0;
     m_currentChunkIndex = startChunkIndex;
 }
 
+void ChunkProcessor::ensureBuffer()
+{
+    if (m_buffer.size() == m_chunkSize && m_buffer.isDetached()) return;
+
+    for (int i = 0; i < m_pool.size(); ++i) {
+        if (m_pool[i].size() == m_chunkSize && m_pool[i].isDetached()) {
+            m_pooledBytes -= m_pool[i].size();
+            m_buffer = std::move(m_pool[i]);
+            m_pool.removeAt(i);
+            return;
+        }
+    }
+
+    m_buffer = QByteArray(m_chunkSize, Qt::Uninitialized);
+}
+
+void ChunkProcessor::setDecoder(std::unique_ptr<StreamDecoder> decoder)
+{
+    m_decoder = std::move(decoder);
+}
+
+qint64 ChunkProcessor::readFrom(QIODevice *device)
+{
+    if (m_decoder) return decodeFrom(device);
+
+    qint64 total = 0;
+    qint64 available = device->bytesAvailable();
+
+    while (available > 0) {
+        if (m_filled == 0) ensureBuffer();
+
+        qint64 read = device->read(m_buffer.data() + m_filled, qMin(available, m_chunkSize - m_filled));
+        if (read <= 0) break;
+
+        m_filled += read;
+        available -= read;
+        total += read;
+
+        if (m_filled == m_chunkSize) emitChunk();
+    }
+
+    m_bytesReceived += total;
+    return total;
+}
+
+qint64 ChunkProcessor::decodeFrom(QIODevice *device)
+{
+    QByteArray raw = device->readAll();
+    if (raw.isEmpty()) return 0;
+
+    m_decoded.resize(0);
+    if (!m_decoder->decode(raw.constData(), raw.size(), m_decoded)) {
+        emit decodeFailed();
+        return raw.size();
+    }
+
+    processData(m_decoded);
+    return raw.size();
+}
+
 void ChunkProcessor::processData(const QByteArray &data)
 {
-    m_buffer.append(data);
-    while (m_buffer.size() >= m_chunkSize) {
-        QByteArray chunkData = m_buffer.left(m_chunkSize);
-        m_buffer.remove(0, m_chunkSize);
+    const char *source = data.constData();
+    qint64 remaining = data.size();
+
+    while (remaining > 0) {
+        if (m_filled == 0) ensureBuffer();
 
-        QByteArray hash = QCryptographicHash::hash(chunkData, m_activeAlgorithm).toHex();
+        qint64 toCopy = qMin(remaining, m_chunkSize - m_filled);
+        std::memcpy(m_buffer.data() + m_filled, source, toCopy);
 
-        emit chunkReady(m_currentChunkIndex, chunkData, hash);
-        m_currentChunkIndex++;
+        m_filled += toCopy;
+        source += toCopy;
+        remaining -= toCopy;
+
+        if (m_filled == m_chunkSize) emitChunk();
     }
+
+    m_bytesReceived += data.size();
+}
+
+void ChunkProcessor::emitChunk()
+{
+    if (m_filled < m_buffer.size()) m_buffer.truncate(m_filled);
+
+    QByteArray hash = QCryptographicHash::hash(m_buffer, m_activeAlgorithm).toHex();
+
+    emit chunkReady(m_currentChunkIndex, m_buffer, hash);
+    m_currentChunkIndex++;
+    m_filled = 0;
+
+    // A short final chunk is never filled again.
+    if (m_buffer.size() == m_chunkSize) {
+        m_pooledBytes += m_buffer.size();
+        m_pool.append(std::move(m_buffer));
+        while (m_pooledBytes > MAX_POOLED_BYTES) {
+            m_pooledBytes -= m_pool.first().size();
+            m_pool.removeFirst();
+        }
+    }
+    m_buffer = QByteArray();
 }
 
 void ChunkProcessor::finalize() {
-    if (!m_buffer.isEmpty()) {
-        QByteArray hash = QCryptographicHash::hash(m_buffer, m_activeAlgorithm).toHex();
-        emit chunkReady(m_currentChunkIndex, m_buffer, hash);
-        m_buffer.clear();
+    if (m_decoder) {
+        m_decoded.resize(0);
+        if (m_decoder->finish(m_decoded)) {
+            processData(m_decoded);
+        } else {
+            emit decodeFailed();
+        }
+    }
+
+    if (m_filled > 0) {
+        emitChunk();
     }
 }
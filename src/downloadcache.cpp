@@ -0,0 +1,278 @@
+#include "../headers/downloadcache.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <limits>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#endif
+
+DownloadCache::DownloadCache(const QString &directory, qint64 budgetBytes) :
+    m_dir(directory),
+    m_budget(budgetBytes)
+{
+    m_dir.mkpath("objects");
+    load();
+}
+
+DownloadCache::Entry DownloadCache::lookup(const QString &expectedHash, const QString &url, const QString &etag, qint64 expectedSize){
+    QMutexLocker locker(&m_mutex);
+
+    QString hash = expectedHash.toLower();
+    if(hash.isEmpty() || !m_objects.contains(hash)){
+        // Without a strong ETag the URL says nothing about the content.
+        QString key = urlKey(url, etag);
+        if(key.isEmpty()) return Entry();
+        hash = m_urls.value(key);
+    }
+    if(hash.isEmpty() || !m_objects.contains(hash)) return Entry();
+
+    const Object object = m_objects.value(hash);
+    if(expectedSize > 0 && object.size != expectedSize) return Entry();
+
+    if(!QFile::exists(objectPath(hash))){
+        removeObject(hash);
+        save();
+        return Entry();
+    }
+
+    touch(hash);
+    save();
+
+    Entry entry;
+    entry.hash = hash;
+    entry.path = objectPath(hash);
+    entry.size = object.size;
+    return entry;
+}
+
+bool DownloadCache::store(const QString &filePath, const QString &hash, const QString &url, const QString &etag){
+    QMutexLocker locker(&m_mutex);
+
+    qint64 fileSize = QFileInfo(filePath).size();
+    if(fileSize <= 0 || fileSize > m_budget) return false;
+
+    QString key = hash.toLower();
+    if(key.isEmpty() || !m_objects.contains(key)){
+        key = copyIn(filePath, key);
+        if(key.isEmpty()) return false;
+    }
+
+    QString urlEntry = urlKey(url, etag);
+    if(!urlEntry.isEmpty()){
+        m_urls[urlEntry] = key;
+    }
+
+    touch(key);
+    evict(key);
+    save();
+    return true;
+}
+
+void DownloadCache::setBudget(qint64 budgetBytes){
+    QMutexLocker locker(&m_mutex);
+
+    m_budget = budgetBytes;
+    evict(QString());
+    save();
+}
+
+qint64 DownloadCache::size() const{
+    QMutexLocker locker(&m_mutex);
+    return m_size;
+}
+
+// Weak validators (W/"...") do not promise byte-identical content.
+QString DownloadCache::urlKey(const QString &url, const QString &etag){
+    if(etag.isEmpty() || etag.startsWith("W/")) return QString();
+    return url + '\n' + etag;
+}
+
+QString DownloadCache::objectPath(const QString &hash) const{
+    return m_dir.filePath("objects/" + hash);
+}
+
+// A verified hash lets the file be cloned in; otherwise it is copied while
+// being hashed, so it is read only once. Returns the object hash, or an
+// empty string on failure.
+QString DownloadCache::copyIn(const QString &filePath, const QString &expectedHash){
+    QString temporaryPath = m_dir.filePath("objects/incoming");
+
+    if(!expectedHash.isEmpty()){
+        if(!materialize(filePath, temporaryPath)) return QString();
+        return adopt(temporaryPath, expectedHash);
+    }
+
+    QFile source(filePath);
+    if(!source.open(QIODevice::ReadOnly)) return QString();
+
+    QFile target(temporaryPath);
+    if(!target.open(QIODevice::WriteOnly | QIODevice::Truncate)) return QString();
+
+    QCryptographicHash hasher(QCryptographicHash::Sha256);
+    while(!source.atEnd()){
+        QByteArray block = source.read(1024 * 1024);
+        hasher.addData(block);
+        if(target.write(block) != block.size()){
+            target.remove();
+            return QString();
+        }
+    }
+    target.close();
+
+    return adopt(temporaryPath, hasher.result().toHex());
+}
+
+QString DownloadCache::adopt(const QString &temporaryPath, const QString &hash){
+    if(m_objects.contains(hash)){
+        QFile::remove(temporaryPath);
+        return hash;
+    }
+
+    QFile::remove(objectPath(hash));
+    if(!QFile::rename(temporaryPath, objectPath(hash))){
+        QFile::remove(temporaryPath);
+        return QString();
+    }
+
+    Object object;
+    object.size = QFileInfo(objectPath(hash)).size();
+    m_objects.insert(hash, object);
+    m_size += object.size;
+    return hash;
+}
+
+void DownloadCache::touch(const QString &hash){
+    // Strictly increasing, so uses within the same millisecond keep their order.
+    m_lastUse = qMax(QDateTime::currentMSecsSinceEpoch(), m_lastUse + 1);
+    m_objects[hash].lastUsed = m_lastUse;
+}
+
+void DownloadCache::evict(const QString &keep){
+    while(m_size > m_budget){
+        QString oldest;
+        qint64 oldestUse = std::numeric_limits<qint64>::max();
+        for(auto it = m_objects.cbegin(); it != m_objects.cend(); ++it){
+            if(it.key() != keep && it.value().lastUsed < oldestUse){
+                oldest = it.key();
+                oldestUse = it.value().lastUsed;
+            }
+        }
+        if(oldest.isEmpty()) break;
+
+        removeObject(oldest);
+    }
+}
+
+void DownloadCache::removeObject(const QString &hash){
+    m_size -= m_objects.value(hash).size;
+    m_objects.remove(hash);
+    QFile::remove(objectPath(hash));
+
+    for(auto it = m_urls.begin(); it != m_urls.end();){
+        if(it.value() == hash){
+            it = m_urls.erase(it);
+        }else{
+            ++it;
+        }
+    }
+}
+
+void DownloadCache::load(){
+    QFile file(m_dir.filePath("index.json"));
+    if(!file.open(QIODevice::ReadOnly)) return;
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+
+    QJsonObject objects = root.value("objects").toObject();
+    for(auto it = objects.begin(); it != objects.end(); ++it){
+        QJsonObject value = it.value().toObject();
+        Object object;
+        object.size = value.value("size").toInteger();
+        object.lastUsed = value.value("lastUsed").toInteger();
+        m_objects.insert(it.key(), object);
+        m_size += object.size;
+        m_lastUse = qMax(m_lastUse, object.lastUsed);
+    }
+
+    // Indexes written before weak ETags were skipped may hold an empty key.
+    QJsonObject urls = root.value("urls").toObject();
+    for(auto it = urls.begin(); it != urls.end(); ++it){
+        if(!it.key().isEmpty() && m_objects.contains(it.value().toString())){
+            m_urls.insert(it.key(), it.value().toString());
+        }
+    }
+}
+
+void DownloadCache::save() const{
+    QJsonObject objects;
+    for(auto it = m_objects.cbegin(); it != m_objects.cend(); ++it){
+        QJsonObject value;
+        value.insert("size", it.value().size);
+        value.insert("lastUsed", it.value().lastUsed);
+        objects.insert(it.key(), value);
+    }
+
+    QJsonObject urls;
+    for(auto it = m_urls.cbegin(); it != m_urls.cend(); ++it){
+        urls.insert(it.key(), it.value());
+    }
+
+    QJsonObject root;
+    root.insert("objects", objects);
+    root.insert("urls", urls);
+
+    QSaveFile file(m_dir.filePath("index.json"));
+    if(file.open(QIODevice::WriteOnly)){
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+// Reflink first: the copy shares extents with the cache object and costs no
+// I/O. Then copy_file_range, which stays in the kernel, then a plain copy.
+// Hard links are not used, because editing the downloaded file would then
+// change the cached object as well.
+bool DownloadCache::materialize(const QString &source, const QString &target){
+#ifdef Q_OS_LINUX
+    int in = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if(in >= 0){
+        int out = ::open(QFile::encodeName(target).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool copied = false;
+
+        if(out >= 0){
+#ifdef FICLONE
+            copied = ::ioctl(out, FICLONE, in) == 0;
+#endif
+            struct stat info;
+            if(!copied && ::fstat(in, &info) == 0){
+                off_t remaining = info.st_size;
+                while(remaining > 0){
+                    ssize_t written = ::copy_file_range(in, nullptr, out, nullptr, static_cast<size_t>(remaining), 0);
+                    if(written <= 0) break;
+                    remaining -= written;
+                }
+                copied = remaining == 0;
+            }
+            ::close(out);
+        }
+        ::close(in);
+
+        if(copied) return true;
+    }
+#endif
+
+    QFile::remove(target);
+    return QFile::copy(source, target);
+}
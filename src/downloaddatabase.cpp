@@ -1,6 +1,77 @@
 #include "../headers/downloaddatabase.h"
 
-DownloadDatabase::DownloadDatabase(const QString& dbPath, QObject *parent) : QObject(parent)
+// Column order shared by bindRecord and getDownloads.
+static const QStringList &recordColumns(){
+    static const QStringList columns = {
+        "name", "url", "filePath", "status", "totalBytes", "downloadedBytes", "expectedHash", "actualHash",
+        "hashAlgorithm", "chunkHashes", "etag", "lastModified", "mirrors", "decompress", "chunkBitmap", "chunkSize",
+        "queuePosition", "uuid", "quantityOfChunks", "pieceHashes", "decodeFormat"
+    };
+    return columns;
+}
+
+// An upsert keeps the row's id and createdAt, which INSERT OR REPLACE would reset.
+static QString saveDownloadSql(){
+    QStringList placeholders;
+    QStringList updates;
+    for (const QString& column : recordColumns()) {
+        placeholders << "?";
+        if (column == "uuid") updates << "uuid = COALESCE(excluded.uuid, uuid)";
+        else if (column != "url") updates << QString("%1 = excluded.%1").arg(column);
+    }
+    updates << "updatedAt = CURRENT_TIMESTAMP";
+
+    return QString("INSERT INTO downloads (%1) VALUES (%2) ON CONFLICT(url) DO UPDATE SET %3")
+        .arg(recordColumns().join(", "), placeholders.join(", "), updates.join(", "));
+}
+
+static QString downloadsTableSql(const QString& table){
+    return QString(
+        "CREATE TABLE IF NOT EXISTS %1 ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "name TEXT NOT NULL,"
+        "url TEXT NOT NULL UNIQUE,"
+        "filePath TEXT,"
+        "status INTEGER NOT NULL DEFAULT %2,"
+        "totalBytes INTEGER DEFAULT 0,"
+        "downloadedBytes INTEGER DEFAULT 0,"
+        "expectedHash TEXT,"
+        "actualHash TEXT,"
+        "hashAlgorithm TEXT,"
+        "chunkHashes BLOB,"
+        "createdAt DATETIME DEFAULT CURRENT_TIMESTAMP,"
+        "updatedAt DATETIME DEFAULT CURRENT_TIMESTAMP,"
+        "etag TEXT,"
+        "lastModified TEXT,"
+        "mirrors TEXT,"
+        "decompress INTEGER DEFAULT 0,"
+        "chunkBitmap BLOB,"
+        "chunkSize INTEGER DEFAULT 1048576,"
+        "queuePosition INTEGER DEFAULT 0,"
+        "uuid TEXT,"
+        "quantityOfChunks INTEGER DEFAULT 8,"
+        "pieceHashes BLOB,"
+        "decodeFormat INTEGER DEFAULT 0"
+        ")").arg(table).arg(DownloadRecord::statusCode("pending"));
+}
+
+static const char *HISTORY_TABLE_SQL =
+    "CREATE TABLE IF NOT EXISTS download_history ("
+    "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "uuid TEXT,"
+    "name TEXT NOT NULL,"
+    "url TEXT NOT NULL,"
+    "filePath TEXT,"
+    "status INTEGER NOT NULL,"
+    "totalBytes INTEGER DEFAULT 0,"
+    "hash TEXT,"
+    "hashAlgorithm TEXT,"
+    "finishedAt DATETIME DEFAULT CURRENT_TIMESTAMP"
+    ")";
+
+DownloadDatabase::DownloadDatabase(const QString& dbPath, QObject *parent, const QString& connectionName) :
+    QObject(parent),
+    m_connectionName(connectionName)
 {
     if(!initDatabase(dbPath)){
         qDebug() << "Failed to initialize database";
@@ -36,41 +107,318 @@ bool DownloadDatabase::initDatabase(const QString& dbPath){
         }
     }
 
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
+    m_db = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
     m_db.setDatabaseName(finalPath);
+    // Other connections to the same file wait for the lock instead of failing.
+    m_db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
 
     if (!m_db.open()) {
         return false;
     }
 
-    return createTables();
+    configureConnection();
+    return createTables() && archiveLeftoverRows();
 }
 
+// WAL lets readers run next to the writer and, with synchronous=NORMAL,
+// commits without an fsync per transaction; the checkpoint still syncs.
+void DownloadDatabase::configureConnection(){
+    QSqlQuery query(m_db);
+    const QStringList pragmas = {
+        "PRAGMA journal_mode = WAL",
+        "PRAGMA synchronous = NORMAL",
+        "PRAGMA cache_size = -16384",
+        "PRAGMA mmap_size = 268435456",
+        "PRAGMA temp_store = MEMORY"
+    };
+    for (const QString& pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qDebug() << "Failed to apply" << pragma << ":" << query.lastError().text();
+        }
+    }
+}
+
+// Prepared once per connection and reused; the cache is cleared before the
+// connection closes.
+QSqlQuery& DownloadDatabase::statement(const QString& sql){
+    auto it = m_statements.find(sql);
+    if (it == m_statements.end()) {
+        QSqlQuery query(m_db);
+        if (!query.prepare(sql)) {
+            qDebug() << "Error preparing statement:" << query.lastError().text();
+        }
+        it = m_statements.insert(sql, query);
+    }
+    return it.value();
+}
+
+// PRAGMA user_version holds the schema version. A database at an older
+// version is upgraded step by step inside one transaction, so a failed
+// step leaves it untouched. Databases from before versioning report 0 and
+// may have any of the early column sets, so steps 2 to 7 check before they
+// change anything.
 bool DownloadDatabase::createTables(){
+    int version = schemaVersion();
+    if(version == SCHEMA_VERSION) return true;
+    if(version > SCHEMA_VERSION){
+        qDebug() << "Database schema version" << version << "is newer than supported version" << SCHEMA_VERSION;
+        return false;
+    }
+
+    if(!m_db.transaction()){
+        qDebug() << "Error starting schema migration:" << m_db.lastError().text();
+        return false;
+    }
+
+    bool ok = m_db.tables().contains("downloads") ? migrate(version) : createSchema();
+
     QSqlQuery query(m_db);
+    ok = ok && query.exec(QString("PRAGMA user_version = %1").arg(SCHEMA_VERSION));
+    if(!ok || !m_db.commit()){
+        qDebug() << "Error upgrading database schema from version" << version << ":" << query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
 
-    QString createTableSql =
-        "CREATE TABLE IF NOT EXISTS downloads ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "name TEXT NOT NULL,"
-        "url TEXT NOT NULL UNIQUE,"
-        "filePath TEXT,"
-        "status TEXT NOT NULL DEFAULT 'pending',"
-        "totalBytes INTEGER DEFAULT 0,"
-        "downloadedBytes INTEGER DEFAULT 0,"
-        "expectedHash TEXT,"
-        "actualHash TEXT,"
-        "hashAlgorithm TEXT,"
-        "chunkHashes BLOB,"
-        "createdAt DATETIME DEFAULT CURRENT_TIMESTAMP,"
-        "updatedAt DATETIME DEFAULT CURRENT_TIMESTAMP"
-        ")";
+    return true;
+}
 
-    query.exec("CREATE INDEX IF NOT EXISTS idx_status ON downloads(status)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_url ON downloads(url)");
+int DownloadDatabase::schemaVersion(){
+    QSqlQuery query(m_db);
+    if(!query.exec("PRAGMA user_version") || !query.next()) return 0;
+    return query.value(0).toInt();
+}
 
-    if(!query.exec(createTableSql)){
-        qDebug() << "Error creating downloads table:" << query.lastError().text();
+bool DownloadDatabase::createSchema(){
+    QSqlQuery query(m_db);
+    if(!query.exec(downloadsTableSql("downloads")) || !query.exec(HISTORY_TABLE_SQL)){
+        qDebug() << "Error creating tables:" << query.lastError().text();
+        return false;
+    }
+    return createIndexes() && createSearchIndex();
+}
+
+// url is UNIQUE and therefore already indexed; the queue index serves the
+// load order.
+bool DownloadDatabase::createIndexes(){
+    QSqlQuery query(m_db);
+    if(!query.exec("CREATE INDEX IF NOT EXISTS idx_queue ON downloads(status, queuePosition)") ||
+       !query.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_uuid ON downloads(uuid)") ||
+       (m_db.tables().contains("download_history") &&
+        !query.exec("CREATE INDEX IF NOT EXISTS idx_history_uuid ON download_history(uuid)"))){
+        qDebug() << "Error creating indexes:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DownloadDatabase::migrate(int fromVersion){
+    for(int version = qMax(fromVersion, 1) + 1; version <= SCHEMA_VERSION; ++version){
+        if(!applyMigration(version)){
+            qDebug() << "Migration to schema version" << version << "failed";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DownloadDatabase::applyMigration(int version){
+    QSqlQuery query(m_db);
+    switch(version){
+    case 2:
+        return ensureColumn("downloads", "etag", "TEXT") &&
+               ensureColumn("downloads", "lastModified", "TEXT");
+    case 3:
+        return ensureColumn("downloads", "mirrors", "TEXT");
+    case 4:
+        return ensureColumn("downloads", "decompress", "INTEGER DEFAULT 0");
+    case 5:
+        return ensureColumn("downloads", "chunkBitmap", "BLOB");
+    case 6:
+        return ensureColumn("downloads", "chunkSize", "INTEGER DEFAULT 1048576");
+    case 7:
+        return ensureColumn("downloads", "queuePosition", "INTEGER DEFAULT 0") &&
+               migrateStatusColumn() &&
+               query.exec("DROP INDEX IF EXISTS idx_url") &&
+               query.exec("DROP INDEX IF EXISTS idx_status") &&
+               query.exec("CREATE INDEX IF NOT EXISTS idx_queue ON downloads(status, queuePosition)");
+    case 8:
+        return ensureColumn("downloads", "uuid", "TEXT") &&
+               ensureColumn("downloads", "quantityOfChunks", "INTEGER DEFAULT 8") &&
+               assignUuids() &&
+               createIndexes();
+    case 9:
+        return archiveFinishedRows();
+    case 10:
+        return createSearchIndex();
+    case 11:
+        return ensureColumn("downloads", "pieceHashes", "BLOB");
+    case 12:
+        return ensureColumn("downloads", "decodeFormat", "INTEGER DEFAULT 0") &&
+               assignDecodeFormats();
+    }
+    return false;
+}
+
+// Finished rows move out of the queue table into the history.
+bool DownloadDatabase::archiveFinishedRows(){
+    using DownloadTypes::DownloadStatus;
+    QSqlQuery query(m_db);
+    QString status = QString("CASE status WHEN %1 THEN %2 WHEN %3 THEN %4 ELSE %5 END")
+                         .arg(DownloadRecord::statusCode("error")).arg(int(DownloadStatus::Error))
+                         .arg(DownloadRecord::statusCode("cancelled")).arg(int(DownloadStatus::Cancelled))
+                         .arg(int(DownloadStatus::Completed));
+    int firstFinished = DownloadRecord::statusCode("completed");
+    int deleted = DownloadRecord::statusCode("deleted");
+
+    bool ok = query.exec(HISTORY_TABLE_SQL) &&
+              query.exec(QString("INSERT INTO download_history (uuid, name, url, filePath, status, totalBytes, hash, hashAlgorithm, finishedAt) "
+                                 "SELECT uuid, name, url, filePath, %1, totalBytes, COALESCE(NULLIF(actualHash, ''), expectedHash), "
+                                 "hashAlgorithm, updatedAt FROM downloads WHERE status >= %2 AND status < %3 ORDER BY queuePosition, id")
+                             .arg(status).arg(firstFinished).arg(deleted)) &&
+              query.exec(QString("DELETE FROM downloads WHERE status >= %1").arg(firstFinished)) &&
+              query.exec("CREATE INDEX IF NOT EXISTS idx_history_uuid ON download_history(uuid)");
+    if(!ok){
+        qDebug() << "Error archiving finished downloads:" << query.lastError().text();
+    }
+    return ok;
+}
+
+// A row that reached a final status but was never archived (the app quit
+// before the batch with its history entry was written) would otherwise stay
+// out of both the queue and the history, so it is moved on every open.
+bool DownloadDatabase::archiveLeftoverRows(){
+    if(!m_db.transaction()){
+        qDebug() << "Error starting archive of finished downloads:" << m_db.lastError().text();
+        return false;
+    }
+    if(!archiveFinishedRows() || !m_db.commit()){
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
+
+// An external-content FTS5 table over the history, kept in step by
+// triggers. SQLite builds without FTS5 skip it and search falls back to LIKE.
+bool DownloadDatabase::createSearchIndex(){
+    QSqlQuery query(m_db);
+    if(!query.exec("CREATE INDEX IF NOT EXISTS idx_history_finished ON download_history(finishedAt)") ||
+       !query.exec("CREATE INDEX IF NOT EXISTS idx_history_status ON download_history(status, finishedAt)")){
+        qDebug() << "Error creating history indexes:" << query.lastError().text();
+        return false;
+    }
+
+    if(!query.exec("CREATE VIRTUAL TABLE IF NOT EXISTS download_history_fts USING fts5("
+                   "name, url, filePath, hash, content='download_history', content_rowid='id')")){
+        qDebug() << "FTS5 is unavailable, history search will scan:" << query.lastError().text();
+        return true;
+    }
+
+    bool ok = query.exec("CREATE TRIGGER IF NOT EXISTS history_fts_insert AFTER INSERT ON download_history BEGIN "
+                         "INSERT INTO download_history_fts(rowid, name, url, filePath, hash) "
+                         "VALUES (new.id, new.name, new.url, new.filePath, new.hash); END") &&
+              query.exec("CREATE TRIGGER IF NOT EXISTS history_fts_delete AFTER DELETE ON download_history BEGIN "
+                         "INSERT INTO download_history_fts(download_history_fts, rowid, name, url, filePath, hash) "
+                         "VALUES ('delete', old.id, old.name, old.url, old.filePath, old.hash); END") &&
+              query.exec("CREATE TRIGGER IF NOT EXISTS history_fts_update AFTER UPDATE ON download_history BEGIN "
+                         "INSERT INTO download_history_fts(download_history_fts, rowid, name, url, filePath, hash) "
+                         "VALUES ('delete', old.id, old.name, old.url, old.filePath, old.hash); "
+                         "INSERT INTO download_history_fts(rowid, name, url, filePath, hash) "
+                         "VALUES (new.id, new.name, new.url, new.filePath, new.hash); END") &&
+              query.exec("INSERT INTO download_history_fts(download_history_fts) VALUES ('rebuild')");
+    if(!ok){
+        qDebug() << "Error creating history search index:" << query.lastError().text();
+    }
+    m_searchIndex = -1;
+    return ok;
+}
+
+bool DownloadDatabase::assignUuids(){
+    QSqlQuery select(m_db);
+    if(!select.exec("SELECT id FROM downloads WHERE uuid IS NULL")) return false;
+
+    QSqlQuery update(m_db);
+    update.prepare("UPDATE downloads SET uuid = ? WHERE id = ?");
+    while(select.next()){
+        update.addBindValue(QUuid::createUuid().toString(QUuid::WithoutBraces));
+        update.addBindValue(select.value(0));
+        if(!update.exec()){
+            qDebug() << "Error assigning uuid:" << update.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decompressing downloads saved before the format was stored picked it from
+// the URL's file name, so that is what they keep.
+bool DownloadDatabase::assignDecodeFormats(){
+    QSqlQuery select(m_db);
+    if(!select.exec("SELECT id, url FROM downloads WHERE decompress = 1")) return false;
+
+    QSqlQuery update(m_db);
+    update.prepare("UPDATE downloads SET decodeFormat = ? WHERE id = ?");
+    while(select.next()){
+        StreamDecoder::Format format = StreamDecoder::formatForFileName(QUrl(select.value(1).toString()).fileName());
+        update.addBindValue(int(format));
+        update.addBindValue(select.value(0));
+        if(!update.exec()){
+            qDebug() << "Error storing decode format:" << update.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Databases written before status codes kept the status as text. SQLite
+// cannot change a column type in place, so the table is copied.
+bool DownloadDatabase::migrateStatusColumn(){
+    QSqlQuery query(m_db);
+    query.exec("PRAGMA table_info(downloads)");
+    QStringList columns;
+    bool textStatus = false;
+    while(query.next()){
+        columns << query.value(1).toString();
+        if(query.value(1).toString() == "status") textStatus = query.value(2).toString().toUpper() == "TEXT";
+    }
+    query.finish();
+    if(!textStatus) return true;
+
+    QString statusCase = "CASE status";
+    for(int code = 0; code < DownloadRecord::statusCount(); ++code){
+        statusCase += QString(" WHEN '%1' THEN %2").arg(DownloadRecord::statusName(code)).arg(code);
+    }
+    statusCase += QString(" ELSE %1 END").arg(DownloadRecord::statusCode("pending"));
+
+    QStringList selected;
+    for(const QString& column : columns){
+        if(column == "status") selected << statusCase;
+        else if(column == "queuePosition") selected << "id";
+        else selected << column;
+    }
+
+    bool ok = query.exec(downloadsTableSql("downloads_migrated")) &&
+              query.exec(QString("INSERT INTO downloads_migrated (%1) SELECT %2 FROM downloads")
+                             .arg(columns.join(", "), selected.join(", "))) &&
+              query.exec("DROP TABLE downloads") &&
+              query.exec("ALTER TABLE downloads_migrated RENAME TO downloads");
+    if(!ok){
+        qDebug() << "Error migrating status column:" << query.lastError().text();
+    }
+
+    return ok;
+}
+
+bool DownloadDatabase::ensureColumn(const QString& table, const QString& column, const QString& definition){
+    QSqlQuery query(m_db);
+    query.exec(QString("PRAGMA table_info(%1)").arg(table));
+    while(query.next()){
+        if(query.value(1).toString() == column) return true;
+    }
+
+    if(!query.exec(QString("ALTER TABLE %1 ADD COLUMN %2 %3").arg(table, column, definition))){
+        qDebug() << "Error adding column" << column << ":" << query.lastError().text();
         return false;
     }
 
@@ -125,43 +473,184 @@ QVector<DownloadRecord> DownloadDatabase::getDownloads()
 {
     QVector<DownloadRecord> records;
 
-    QSqlQuery query(m_db);
+    static const QString sql = "SELECT " + recordColumns().join(", ") + " FROM downloads "
+               "ORDER BY status, queuePosition";
 
-    query.exec("SELECT name, url, filePath, status, totalBytes, downloadedBytes, expectedHash, actualHash, hashAlgorithm, chunkHashes FROM downloads "
-               "ORDER BY "
-               "CASE status "
-               "WHEN 'downloading' THEN 1 "
-               "WHEN 'resumed' THEN 2 "
-               "WHEN 'resumed_in_downloading' THEN 3 "
-               "WHEN 'start_new_task' THEN 4 "
-               "WHEN 'resumed_in_pending' THEN 5 "
-               "WHEN 'pending' THEN 6 "
-               "WHEN 'prepared' THEN 7 "
-               "WHEN 'preparing' THEN 8 "
-               "WHEN 'paused' THEN 9 "
-               "WHEN 'paused_new' THEN 10 "
-               "WHEN 'paused_resume' THEN 11 "
-               "WHEN 'completed' THEN 12 "
-               "WHEN 'error' THEN 13 "
-               "WHEN 'cancelled' THEN 14 "
-               "WHEN 'deleted' THEN 15 "
-               "END ASC;");
+    QSqlQuery& query = statement(sql);
+    if(!query.exec()){
+        qDebug() << "Error loading downloads:" << query.lastError().text();
+        return records;
+    }
+    return readRecords(query);
+}
+
+// Finished rows are archived, but a row can still be finished here if the
+// application stopped before its archive was written.
+QVector<DownloadRecord> DownloadDatabase::getActiveDownloads()
+{
+    static const QString sql = "SELECT " + recordColumns().join(", ") + " FROM downloads "
+               "WHERE status < ? ORDER BY status, queuePosition";
+
+    QSqlQuery& query = statement(sql);
+    query.addBindValue(DownloadRecord::statusCode("completed"));
+    if(!query.exec()){
+        qDebug() << "Error loading active downloads:" << query.lastError().text();
+        return {};
+    }
+    return readRecords(query);
+}
+
+// Newest first; the rowid order is the order entries were archived in.
+static const char *HISTORY_COLUMNS = "h.uuid, h.name, h.url, h.filePath, h.status, h.totalBytes, h.hash, h.hashAlgorithm, h.finishedAt";
+
+// SQLite's CURRENT_TIMESTAMP format, in UTC.
+static QString sqliteTimestamp(const QDateTime& time){
+    return time.toUTC().toString("yyyy-MM-dd HH:mm:ss");
+}
+
+QVector<DownloadTypes::HistoryEntry> DownloadDatabase::getHistory(int offset, int limit)
+{
+    static const QString sql = QString("SELECT %1 FROM download_history h ORDER BY h.id DESC LIMIT ? OFFSET ?").arg(HISTORY_COLUMNS);
+    QSqlQuery& query = statement(sql);
+    query.addBindValue(limit);
+    query.addBindValue(offset);
+    if(!query.exec()){
+        qDebug() << "Error loading download history:" << query.lastError().text();
+        return {};
+    }
+    return readHistory(query);
+}
+
+// Words match as prefixes anywhere in name, URL, path or hash, through the
+// FTS5 index when the SQLite build has it and with LIKE otherwise.
+QVector<DownloadTypes::HistoryEntry> DownloadDatabase::searchHistory(const DownloadTypes::HistoryQuery& search)
+{
+    QStringList where;
+    QVariantList binds;
+
+    const QStringList words = search.text.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    if(!words.isEmpty() && hasSearchIndex()){
+        QStringList terms;
+        for(QString word : words) terms << "\"" + word.replace("\"", "\"\"") + "\"*";
+        where << "h.id IN (SELECT rowid FROM download_history_fts WHERE download_history_fts MATCH ?)";
+        binds << terms.join(' ');
+    }else{
+        for(QString word : words){
+            word.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+            QString pattern = "%" + word + "%";
+            where << "(h.name LIKE ? ESCAPE '\\' OR h.url LIKE ? ESCAPE '\\' OR "
+                     "h.filePath LIKE ? ESCAPE '\\' OR h.hash LIKE ? ESCAPE '\\')";
+            binds << pattern << pattern << pattern << pattern;
+        }
+    }
+
+    if(!search.statuses.isEmpty()){
+        QStringList placeholders;
+        for(DownloadTypes::DownloadStatus status : search.statuses){
+            placeholders << "?";
+            binds << static_cast<int>(status);
+        }
+        where << QString("h.status IN (%1)").arg(placeholders.join(", "));
+    }
+    if(search.finishedFrom.isValid()){
+        where << "h.finishedAt >= ?";
+        binds << sqliteTimestamp(search.finishedFrom);
+    }
+    if(search.finishedTo.isValid()){
+        where << "h.finishedAt < ?";
+        binds << sqliteTimestamp(search.finishedTo);
+    }
+    if(search.minBytes >= 0){
+        where << "h.totalBytes >= ?";
+        binds << search.minBytes;
+    }
+    if(search.maxBytes >= 0){
+        where << "h.totalBytes <= ?";
+        binds << search.maxBytes;
+    }
+
+    QString sql = QString("SELECT %1 FROM download_history h").arg(HISTORY_COLUMNS);
+    if(!where.isEmpty()) sql += " WHERE " + where.join(" AND ");
+    sql += " ORDER BY h.id DESC LIMIT ? OFFSET ?";
+    binds << search.limit << search.offset;
+
+    QSqlQuery& query = statement(sql);
+    for(const QVariant& value : binds) query.addBindValue(value);
+    if(!query.exec()){
+        qDebug() << "Error searching download history:" << query.lastError().text();
+        return {};
+    }
+    return readHistory(query);
+}
+
+QVector<DownloadTypes::HistoryEntry> DownloadDatabase::readHistory(QSqlQuery& query)
+{
+    QVector<DownloadTypes::HistoryEntry> entries;
+    while(query.next()){
+        DownloadTypes::HistoryEntry entry;
+        entry.id = QUuid::fromString(query.value(0).toString());
+        entry.name = query.value(1).toString();
+        entry.url = query.value(2).toString();
+        entry.filePath = query.value(3).toString();
+        entry.status = static_cast<DownloadTypes::DownloadStatus>(query.value(4).toInt());
+        entry.totalBytes = query.value(5).toLongLong();
+        entry.hash = query.value(6).toString();
+        entry.hashAlgorithm = query.value(7).toString();
+        entry.finishedAt = QDateTime::fromString(query.value(8).toString(), "yyyy-MM-dd HH:mm:ss");
+        entry.finishedAt.setTimeZone(QTimeZone::UTC);
+        entries.push_back(entry);
+    }
+    query.finish();
+    return entries;
+}
+
+bool DownloadDatabase::hasSearchIndex(){
+    if(m_searchIndex < 0){
+        QSqlQuery query(m_db);
+        m_searchIndex = query.exec("SELECT 1 FROM sqlite_master WHERE name = 'download_history_fts'") && query.next() ? 1 : 0;
+    }
+    return m_searchIndex == 1;
+}
+
+void DownloadDatabase::deleteHistoryEntry(const QUuid& id){
+    QSqlQuery& query = statement("DELETE FROM download_history WHERE uuid = ?");
+    query.addBindValue(id.toString(QUuid::WithoutBraces));
+    if(!query.exec()){
+        qDebug() << "Error deleting history entry:" << query.lastError().text();
+    }
+}
+
+QVector<DownloadRecord> DownloadDatabase::readRecords(QSqlQuery& query)
+{
+    QVector<DownloadRecord> records;
     while(query.next()){
         DownloadRecord record;
 
         record.m_name = query.value(0).toString();
         record.m_url = query.value(1).toString();
         record.m_filePath = query.value(2).toString();
-        record.m_status = query.value(3).toString();
-        record.m_totalBytes = query.value(4).toInt();
+        record.m_status = DownloadRecord::validStatusCode(query.value(3).toInt());
+        record.m_totalBytes = query.value(4).toLongLong();
         record.m_downloadedBytes = query.value(5).toLongLong();
         record.m_expectedHash = query.value(6).toString();
         record.m_actualHash = query.value(7).toString();
         record.m_hashAlgorithm = query.value(8).toString();
         record.m_chunkHashes = query.value(9).toByteArray();
+        record.m_etag = query.value(10).toString();
+        record.m_lastModified = query.value(11).toString();
+        record.m_mirrors = query.value(12).toString().split('\n', Qt::SkipEmptyParts);
+        record.m_decompress = query.value(13).toBool();
+        record.m_chunkBitmap = query.value(14).toByteArray();
+        record.m_chunkSize = query.value(15).toLongLong();
+        record.m_queuePosition = query.value(16).toLongLong();
+        record.m_uuid = QUuid::fromString(query.value(17).toString());
+        record.m_quantityOfChunks = query.value(18).toLongLong();
+        record.m_pieceHashes = query.value(19).toByteArray();
+        record.m_decodeFormat = query.value(20).toInt();
 
         records.push_back(record);
     }
+    query.finish();
     return records;
 }
 
@@ -170,7 +659,7 @@ bool DownloadDatabase::isValidRecord(const DownloadRecord &record)
     if(record.m_name.isEmpty() ||
         record.m_url.isEmpty() ||
         record.m_filePath.isEmpty() ||
-        record.m_status.isEmpty() ||
+        record.m_status != DownloadRecord::validStatusCode(record.m_status) ||
         record.m_totalBytes < 0
         ) return false;
 
@@ -189,6 +678,18 @@ void DownloadDatabase::bindRecord(QSqlQuery& query, const DownloadRecord& record
     query.addBindValue(record.m_actualHash);
     query.addBindValue(record.m_hashAlgorithm);
     query.addBindValue(record.m_chunkHashes, QSql::In | QSql::Binary);
+    query.addBindValue(record.m_etag);
+    query.addBindValue(record.m_lastModified);
+    query.addBindValue(record.m_mirrors.join('\n'));
+    query.addBindValue(record.m_decompress ? 1 : 0);
+    query.addBindValue(record.m_chunkBitmap, QSql::In | QSql::Binary);
+    query.addBindValue(record.m_chunkSize);
+    query.addBindValue(record.m_queuePosition);
+    query.addBindValue(record.m_uuid.isNull() ? QVariant(QMetaType::fromType<QString>())
+                                              : QVariant(record.m_uuid.toString(QUuid::WithoutBraces)));
+    query.addBindValue(record.m_quantityOfChunks);
+    query.addBindValue(record.m_pieceHashes, QSql::In | QSql::Binary);
+    query.addBindValue(record.m_decodeFormat);
 }
 
 
@@ -206,14 +707,10 @@ void DownloadDatabase::saveDownloads(QVector<DownloadRecord> records){
 
     if (validRecords.isEmpty()) return;
 
-    QString request =
-        "INSERT OR REPLACE INTO downloads "
-        "(name, url, filePath, status, totalBytes, downloadedBytes, expectedHash, actualHash, hashAlgorithm, chunkHashes) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    static const QString request = saveDownloadSql();
+    QSqlQuery& query = statement(request);
 
     if (m_db.transaction()) {
-        QSqlQuery query(m_db);
-        query.prepare(request);
 
         bool allOk = true;
         for (const auto& record : validRecords) {
@@ -233,9 +730,6 @@ void DownloadDatabase::saveDownloads(QVector<DownloadRecord> records){
         qDebug() << "Batch save failed, falling back to individual mode...";
     }
 
-    QSqlQuery query(m_db);
-    query.prepare(request);
-
     for (const auto& record : validRecords) {
         bindRecord(query, record);
         if (!query.exec()) {
@@ -304,10 +798,70 @@ bool DownloadDatabase::isValidPath(const QString& path)
     return true;
 }
 
-void DownloadDatabase::deleteDownload(DownloadRecord record){
-    QSqlQuery query(m_db);
+// Saves and deletions in one transaction; nothing is applied if any fails.
+bool DownloadDatabase::writeBatch(const QVector<DownloadRecord>& saves, const QStringList& deletedUrls,
+                                  const QVector<DownloadTypes::HistoryEntry>& archived){
+    if (saves.isEmpty() && deletedUrls.isEmpty() && archived.isEmpty()) return true;
+    if (!m_db.transaction()) {
+        qDebug() << "Error starting transaction:" << m_db.lastError().text();
+        return false;
+    }
 
-    query.prepare("DELETE FROM downloads WHERE url = ?");
+    QSqlQuery& remove = statement("DELETE FROM downloads WHERE url = ?");
+    for (const QString& url : deletedUrls) {
+        remove.addBindValue(url);
+        if (!remove.exec()) {
+            qDebug() << "Error delete download" << remove.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+    }
+
+    static const QString saveSql = saveDownloadSql();
+    QSqlQuery& insert = statement(saveSql);
+    for (const auto& record : saves) {
+        if (!isValidRecord(record)) {
+            qDebug() << "Validation failed for record, skipping:" << record.m_url;
+            continue;
+        }
+        bindRecord(insert, record);
+        if (!insert.exec()) {
+            qDebug() << "Error saving" << record.m_url << insert.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+    }
+
+    QSqlQuery& archive = statement("INSERT INTO download_history (uuid, name, url, filePath, status, totalBytes, hash, hashAlgorithm) "
+                                   "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    for (const auto& entry : archived) {
+        archive.addBindValue(entry.id.isNull() ? QVariant(QMetaType::fromType<QString>())
+                                               : QVariant(entry.id.toString(QUuid::WithoutBraces)));
+        archive.addBindValue(entry.name);
+        archive.addBindValue(entry.url);
+        archive.addBindValue(entry.filePath);
+        archive.addBindValue(static_cast<int>(entry.status));
+        archive.addBindValue(entry.totalBytes);
+        archive.addBindValue(entry.hash);
+        archive.addBindValue(entry.hashAlgorithm);
+        remove.addBindValue(entry.url);
+        if (!archive.exec() || !remove.exec()) {
+            qDebug() << "Error archiving" << entry.url << archive.lastError().text() << remove.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+    }
+
+    if (!m_db.commit()) {
+        qDebug() << "Error committing batch:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
+
+void DownloadDatabase::deleteDownload(DownloadRecord record){
+    QSqlQuery& query = statement("DELETE FROM downloads WHERE url = ?");
     query.addBindValue(record.m_url);
 
     if(!query.exec()){
@@ -318,7 +872,10 @@ void DownloadDatabase::deleteDownload(DownloadRecord record){
 }
 
 DownloadDatabase::~DownloadDatabase(){
+    m_statements.clear();
     if (m_db.isOpen()) m_db.close();
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(m_connectionName);
 }
 
 
@@ -1,94 +1,11 @@
 #include "../headers/downloaditem.h"
 
-DownloadItem::DownloadItem(const QString& url, const QString& filePath, const QString& name, QWidget *parent) : QWidget(parent),
+DownloadItem::DownloadItem(const QString& url, const QString& filePath, const QString& name, QObject *parent) : QObject(parent),
                                                                                     m_url(url),
                                                                                     m_filePath(filePath),
                                                                                     m_nameFileStr(name),
                                                                                     m_lastBytesReceived(0),
                                                                                     m_currentSpeed(0){
-    m_process = new QProcess(this);
-    setUpUI();
-    setUpConnections();
-    setUpSpeedTimer();
-}
-
-
-void DownloadItem::setUpUI(){
-    m_nameFile = new QLabel(m_nameFileStr);
-    m_progressBar = new QProgressBar();
-    m_checkBox = new QCheckBox();
-
-    m_pauseCheckBox = new Toogle(25, Qt::gray, Qt::white, Qt::blue);
-    m_pauseCheckBox->setChecked(true);
-    m_pauseCheckBox->hide();
-
-    m_openInFolderButton = new QPushButton("Open in Folder");
-    m_deleteButton = new QPushButton("Delete");
-    m_cancellButton = new QPushButton("Cancell");
-
-    m_openInFolderButton->setMaximumWidth(200);
-    m_deleteButton->setMaximumWidth(200);
-    m_cancellButton->setMaximumWidth(200);
-
-    m_progresSize = new QLabel("0%");
-    m_speedDownload = new QLabel("0B/s");
-    m_statusDownload = new QLabel("Preparing");
-    m_sizeFile = new QLabel();
-    m_timeToCompleteLabel = new QLabel();
-
-    m_mainLayout = new QHBoxLayout(this);
-    m_vLayout = new QVBoxLayout();
-    m_upperLayout = new QHBoxLayout();
-    m_lowerLayout = new QHBoxLayout();
-
-    m_upperLayout->addWidget(m_nameFile);
-    m_upperLayout->addWidget(m_openInFolderButton);
-    m_upperLayout->addWidget(m_cancellButton);
-    m_upperLayout->addWidget(m_deleteButton);
-
-    m_lowerLayout->addWidget(m_pauseCheckBox);
-    m_lowerLayout->addWidget(createSpacer(20));
-    m_lowerLayout->addWidget(m_statusDownload);
-    m_lowerLayout->addWidget(createExpandingSpacer());
-    m_lowerLayout->addWidget(m_speedDownload);
-    m_lowerLayout->addWidget(createExpandingSpacer());
-    m_lowerLayout->addWidget(m_sizeFile);
-    m_lowerLayout->addWidget(createExpandingSpacer());
-    m_lowerLayout->addWidget(m_progresSize);
-    m_lowerLayout->addWidget(createExpandingSpacer());
-    m_lowerLayout->addWidget(m_timeToCompleteLabel);
-    m_lowerLayout->addWidget(createSpacer(20));
-
-    m_vLayout->setSpacing(0);
-
-    m_vLayout->addLayout(m_upperLayout);
-    m_vLayout->addWidget(m_progressBar);
-    m_vLayout->addLayout(m_lowerLayout);
-
-    m_mainLayout->addWidget(m_checkBox);
-    m_mainLayout->addLayout(m_vLayout);
-}
-
-void DownloadItem::setUpConnections()
-{
-    connect(m_pauseCheckBox, &QCheckBox::stateChanged, this, [=](bool checked){
-        onPauseCheckBox();
-    });
-    connect(this, &DownloadItem::updateProgress, this, &DownloadItem::updateProgressChange);
-
-    connect(m_openInFolderButton, &QPushButton::clicked, this, &DownloadItem::onOpenFileInFolder);
-    connect(m_cancellButton, &QPushButton::clicked, this, [=](){
-        emit statusChanged(DownloadTask::Status::Cancelled);
-    });
-    connect(m_deleteButton, &QPushButton::clicked, this, [=](){
-        emit statusChanged(DownloadTask::Status::Deleted);
-        emit deleteDownload(this);
-    });
-
-    connect(m_checkBox, &QCheckBox::stateChanged, this, [=](int state){
-        bool checked = (state == Qt::Checked);
-        emit ChangedBt(this, checked);
-    });
 }
 
 void DownloadItem::updateFromDb(const DownloadRecord &record)
@@ -97,33 +14,29 @@ void DownloadItem::updateFromDb(const DownloadRecord &record)
     m_filePath = record.m_filePath;
     m_url = record.m_url;
     m_bytesTotal = record.m_totalBytes;
-    m_pauseCheckBox->show();
-    QString status = record.m_status;
-    if (record.m_status == "pending") chackWhatStatus(DownloadTask::Pending);
-    if (record.m_status == "downloading") chackWhatStatus(DownloadTask::Downloading);
-    if (record.m_status == "resumed") chackWhatStatus(DownloadTask::Resumed);
-    if (record.m_status == "start_new_task") chackWhatStatus(DownloadTask::StartNewTask);
-    if (record.m_status == "resumed_in_pending") chackWhatStatus(DownloadTask::ResumedInPending);
-    if (record.m_status == "resumed_in_downloading") chackWhatStatus(DownloadTask::ResumedInDownloading);
-    if (record.m_status == "paused") chackWhatStatus(DownloadTask::Paused);
-    if (record.m_status == "paused_new") chackWhatStatus(DownloadTask::PausedNew);
-    if (record.m_status == "paused_resume") chackWhatStatus(DownloadTask::PausedResume);
-    if (record.m_status == "error") chackWhatStatus(DownloadTask::Error);
-    if (record.m_status == "cancelled") chackWhatStatus(DownloadTask::Cancelled);
-    if (record.m_status == "deleted") chackWhatStatus(DownloadTask::Deleted);
-    if(record.m_status == "preparing") chackWhatStatus(DownloadTask::Preparing);
-    if(record.m_status == "prepared") chackWhatStatus(DownloadTask::Prepared);
-    if (record.m_status == "completed"){
+    m_pauseVisible = true;
+    DownloadTask::Status status = DownloadTask::statusFromCode(record.m_status);
+    if (status == DownloadTask::Completed){
         onProgressChanged(record.m_totalBytes, record.m_totalBytes);
         chackWhatStatus(DownloadTask::Completed);
     }else{
+        chackWhatStatus(status);
         onProgressChanged(record.m_downloadedBytes, record.m_totalBytes);
     }
 }
 
-void DownloadItem::onPauseCheckBox()
+// Like the switch widget it replaces, every change of the switch is reported
+// to the task, whether it was clicked or followed a status change.
+void DownloadItem::setRunning(bool running){
+    if(m_running == running) return;
+    m_running = running;
+    onPauseSwitched();
+    emit changed();
+}
+
+void DownloadItem::onPauseSwitched()
 {
-    if(m_pauseCheckBox->isChecked()){
+    if(m_running){
         emit statusChanged(DownloadTask::Status::Resumed);
     }else{
         emit statusChanged(DownloadTask::Status::Paused);
@@ -132,98 +45,129 @@ void DownloadItem::onPauseCheckBox()
 
 void DownloadItem::pauseDownloadAll(bool checked){
     if(checked){
-        m_pauseCheckBox->setChecked(checked);
+        setRunning(checked);
         emit statusChanged(DownloadTask::Status::Resumed);
     }else{
-        m_pauseCheckBox->setChecked(checked);
+        setRunning(checked);
         emit statusChanged(DownloadTask::Status::Paused);
     }
 }
 
+void DownloadItem::setChecked(bool checked){
+    if(m_checked == checked) return;
+    m_checked = checked;
+    emit changed();
+    emit ChangedBt(this, checked);
+}
+
+void DownloadItem::cancel(){
+    emit statusChanged(DownloadTask::Status::Cancelled);
+}
+
+void DownloadItem::remove(){
+    emit statusChanged(DownloadTask::Status::Deleted);
+    emit deleteDownload(this);
+}
+
 void DownloadItem::chackWhatStatus(DownloadTask::Status status){
+    bool finished = false;
     switch (status) {
     case DownloadTask::Status::Pending:
-        m_pauseCheckBox->setChecked(true);
-        m_statusDownload->setText("Pending");
+        setRunning(true);
+        m_statusStr = "Pending";
         break;
     case DownloadTask::Status::Cancelled:
-        m_statusDownload->setText("Cancelled");
-        m_pauseCheckBox->hide();
-        m_cancellButton->hide();
-        emit finishedDownload();
+        m_statusStr = "Cancelled";
+        m_pauseVisible = false;
+        m_cancelVisible = false;
+        finished = true;
         break;
     case DownloadTask::Status::Error:
-        m_statusDownload->setText("Error");
-        m_pauseCheckBox->hide();
-        emit finishedDownload();
+        m_statusStr = "Error";
+        m_pauseVisible = false;
+        finished = true;
         break;
     case DownloadTask::Status::Completed:
-        m_statusDownload->setText("Completed");
-        m_pauseCheckBox->hide();
-        m_cancellButton->hide();
-        emit finishedDownload();
+        m_statusStr = "Completed";
+        m_pauseVisible = false;
+        m_cancelVisible = false;
+        finished = true;
         break;
     case DownloadTask::Status::ResumedInDownloading:
-        m_statusDownload->setText("Downloading");
+        m_statusStr = "Downloading";
         break;
     case DownloadTask::Status::ResumedInPending:
-        m_statusDownload->setText("Pending");
+        m_statusStr = "Pending";
         break;
     case DownloadTask::Status::Paused:
-        m_statusDownload->setText("Paused");
-        m_pauseCheckBox->setChecked(false);
+        m_statusStr = "Paused";
+        setRunning(false);
         break;
     case DownloadTask::Status::Downloading:
-        m_pauseCheckBox->show();
-        m_pauseCheckBox->setChecked(true);
-        m_statusDownload->setText("Downloading");
+        m_pauseVisible = true;
+        setRunning(true);
+        m_statusStr = "Downloading";
         break;
     case DownloadTask::Status::Resumed:
-        m_statusDownload->setText("Downloading");
-        m_pauseCheckBox->setChecked(true);
+        m_statusStr = "Downloading";
+        setRunning(true);
         break;
     case DownloadTask::Status::StartNewTask:
-        m_statusDownload->setText("Downloading");
-        m_pauseCheckBox->setChecked(true);
+        m_statusStr = "Downloading";
+        setRunning(true);
         break;
     case DownloadTask::Status::PausedNew:
-        m_statusDownload->setText("Paused");
-        m_pauseCheckBox->setChecked(false);
+        m_statusStr = "Paused";
+        setRunning(false);
         break;
     case DownloadTask::Status::PausedResume:
         break;
     case DownloadTask::Status::Preparing:
-        m_statusDownload->setText("Preparing");
-        m_pauseCheckBox->hide();
+        m_statusStr = "Preparing";
+        m_pauseVisible = false;
         break;
     case DownloadTask::Status::Prepared:
-        m_statusDownload->setText("Prepared");
-        m_pauseCheckBox->hide();
+        m_statusStr = "Prepared";
+        m_pauseVisible = false;
         break;
     case DownloadTask::Status::Deleted:
-        m_statusDownload->setText("Deleted");
-        m_pauseCheckBox->hide();
-        m_cancellButton->hide();
+        m_statusStr = "Deleted";
+        m_pauseVisible = false;
+        m_cancelVisible = false;
         break;
     case DownloadTask::Status::FileIntegrityCheck:
-        m_statusDownload->setText("File Integrity Checking");
-        m_pauseCheckBox->hide();
-        m_cancellButton->hide();
+        m_statusStr = "File Integrity Checking";
+        m_pauseVisible = false;
+        m_cancelVisible = false;
         break;
     }
+    if(finished){
+        m_finished = true;
+        m_transferring = false;
+    }
+    emit changed();
+
+    if(finished) emit finishedDownload();
 }
 
-void DownloadItem::setUpSpeedTimer(){
-    m_timer = new QTimer(this);
-    connect(m_timer, &QTimer::timeout, this, &DownloadItem::calculateSpeed);
-    connect(m_timer, &QTimer::timeout, this, &DownloadItem::calculateTimeToComplete);
-    m_timer->start(1000);
+void DownloadItem::sampleSpeed(){
+    calculateSpeed();
+    calculateTimeToComplete();
 }
 
+// The first sample only sets the baseline; later ones divide by the real
+// interval, so a late tick does not inflate the speed.
 void DownloadItem::calculateSpeed(){
+    qint64 elapsed = m_sampleTimer.isValid() ? m_sampleTimer.restart() : 0;
+    if(elapsed <= 0){
+        m_sampleTimer.start();
+        m_lastBytesReceived = m_totalBytesReceived;
+        return;
+    }
+
     if(m_totalBytesReceived > 0){
         qint64 bytesDiff = m_totalBytesReceived - m_lastBytesReceived;
-        m_currentSpeed = bytesDiff;
+        m_currentSpeed = bytesDiff * 1000 / elapsed;
         m_speedHistory.append(m_currentSpeed);
 
         if (m_speedHistory.size() > 5) {
@@ -232,30 +176,27 @@ void DownloadItem::calculateSpeed(){
         qint64 sumSpeed = 0;
         for (qint64 s : m_speedHistory) sumSpeed += s;
         m_currentSpeed = sumSpeed / m_speedHistory.size();
-
-        updateSpeedString();
+        m_speedSampled = true;
     }
     m_lastBytesReceived = m_totalBytesReceived;
 }
 
-void DownloadItem::updateSpeedString(){
-    QString speedText;
+QString DownloadItem::getSpeedText() const{
+    if(!m_speedSampled) return "0B/s";
 
     if(m_currentSpeed < 1024){
-        speedText = QString("%1 B/s").arg(m_currentSpeed);
+        return QString("%1 B/s").arg(m_currentSpeed);
     }else if(m_currentSpeed < 1024 * 1024){
-        speedText = QString("%1 KB/s").arg(m_currentSpeed / 1024);
+        return QString("%1 KB/s").arg(m_currentSpeed / 1024);
     }else {
-        speedText = QString("%1 MB/s").arg(m_currentSpeed / (1024.0 * 1024.0), 0, 'f', 1);
+        return QString("%1 MB/s").arg(m_currentSpeed / (1024.0 * 1024.0), 0, 'f', 1);
     }
-
-    m_speedDownload->setText(speedText);
 }
 
 void DownloadItem::setFileName(const QString& newFileName)
 {
     m_nameFileStr = newFileName;
-    m_nameFile->setText(m_nameFileStr);
+    emit changed();
 }
 
 QString DownloadItem::getName() const
@@ -273,6 +214,8 @@ QString DownloadItem::getFilePath() const
     return m_filePath;
 }
 
+// Called for every progress report, so it only records the numbers; the
+// list repaints the row on its next refresh tick.
 void DownloadItem::onProgressChanged(qint64 bytesReceived, qint64 bytesTotal){
     m_bytesTotal = bytesTotal;
 
@@ -281,65 +224,52 @@ void DownloadItem::onProgressChanged(qint64 bytesReceived, qint64 bytesTotal){
     }
 
     m_totalBytesReceived = bytesReceived;
+    m_progressReported = true;
+    m_transferring = !m_finished;
+    emit changed();
+}
+
+QString DownloadItem::getSizeText() const{
+    if(!m_progressReported) return QString();
+    return sizeText(m_totalBytesReceived, m_bytesTotal);
+}
 
+QString DownloadItem::sizeText(qint64 bytesReceived, qint64 bytesTotal){
     if(bytesTotal < 1024){
-        m_sizeFileStr = QString("%1/%2 B").arg(bytesReceived).arg(bytesTotal);
+        return QString("%1/%2 B").arg(bytesReceived).arg(bytesTotal);
     }else if(bytesTotal < 1024 * 1024){
-        m_sizeFileStr = QString("%1/%2 KB")
-                            .arg(bytesReceived / 1024.0, 0, 'f', 1)
-                            .arg(bytesTotal / 1024.0, 0, 'f', 1);
+        return QString("%1/%2 KB")
+            .arg(bytesReceived / 1024.0, 0, 'f', 1)
+            .arg(bytesTotal / 1024.0, 0, 'f', 1);
     }else if(bytesTotal < 1024 * 1024 * 1024){
-        m_sizeFileStr = QString("%1/%2 MB")
-                            .arg(bytesReceived / (1024.0 * 1024.0), 0, 'f', 1)
-                            .arg(bytesTotal / (1024.0 * 1024.0), 0, 'f', 1);
+        return QString("%1/%2 MB")
+            .arg(bytesReceived / (1024.0 * 1024.0), 0, 'f', 1)
+            .arg(bytesTotal / (1024.0 * 1024.0), 0, 'f', 1);
     }else{
-        m_sizeFileStr = QString("%1/%2 GB")
-                            .arg(bytesReceived / (1024.0 * 1024.0 * 1024.0), 0, 'f', 2)
-                            .arg(bytesTotal / (1024.0 * 1024.0 * 1024.0), 0, 'f', 2);
+        return QString("%1/%2 GB")
+            .arg(bytesReceived / (1024.0 * 1024.0 * 1024.0), 0, 'f', 2)
+            .arg(bytesTotal / (1024.0 * 1024.0 * 1024.0), 0, 'f', 2);
     }
-    emit updateProgress();
 }
 
-void DownloadItem::updateProgressChange(){
-    m_progressBar->setValue(m_percentages);
-
-    m_progresSize->setText(QString::number(m_percentages) + "%");
-
-    m_sizeFile->setText(m_sizeFileStr);
-}
-
-auto DownloadItem::createExpandingSpacer() -> QWidget*
-{
-    auto *spaser = new QWidget();
-    spaser->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
-    return spaser;
+void DownloadItem::openInFolder(){
+    revealFile(getFilePath());
 }
 
-auto DownloadItem::createSpacer(int width) -> QWidget*
-{
-    auto *spaser = new QWidget();
-    spaser->setFixedWidth(width);
-    return spaser;
-}
-
-void DownloadItem::onOpenFileInFolder(){
-    QFileInfo info(getFilePath());
+void DownloadItem::revealFile(const QString &filePath){
+    QFileInfo info(filePath);
     if (!info.exists()) {
         //!!!
         return;
     }
 
     #ifdef Q_OS_MAC
-    m_process->start("open", QStringList() << "-R" << getFilePath());
+    QProcess::startDetached("open", QStringList() << "-R" << filePath);
     #elif defined(Q_OS_WIN)
-        m_process->start("cmd", QStringList() << "/c" << "start" << getFilePath());
+        QProcess::startDetached("cmd", QStringList() << "/c" << "start" << filePath);
     #elif defined(Q_OS_LINUX)
-        m_process->start("xdg-open", QStringList() << getFilePath());
+        QProcess::startDetached("xdg-open", QStringList() << filePath);
     #endif
-
-    if (!m_process->waitForFinished(5000)) {
-        //!!!
-    }
 }
 
 void DownloadItem::calculateTimeToComplete(){
@@ -349,34 +279,32 @@ void DownloadItem::calculateTimeToComplete(){
     }else{
         m_timeToComplete = 0;
     }
-    updateTimeToComplete();
 }
 
-void DownloadItem::updateTimeToComplete(){
-    if(m_timeToComplete == 0) m_timeToCompleteStr = "0s";
-    else{
-        qint64 hours = m_timeToComplete / 3600;
-        qint64 minutes = (m_timeToComplete % 3600) / 60;
-        qint64 secs = m_timeToComplete % 60;
-
-        if (hours > 0) {
-            m_timeToCompleteStr = QString("%1h %2m")
-            .arg(hours, 2, 10, QChar('0'))
-            .arg(minutes, 2, 10, QChar('0'));
-        }else if(minutes > 0){
-            m_timeToCompleteStr = QString("%1m %2s")
-            .arg(minutes, 2, 10, QChar('0'))
-                .arg(secs, 2, 10, QChar('0'));
-        }else{
-            m_timeToCompleteStr = QString("%1s")
+QString DownloadItem::getTimeToCompleteText() const{
+    if(!m_speedSampled) return QString();
+    if(m_timeToComplete == 0) return "0s";
+
+    qint64 hours = m_timeToComplete / 3600;
+    qint64 minutes = (m_timeToComplete % 3600) / 60;
+    qint64 secs = m_timeToComplete % 60;
+
+    if (hours > 0) {
+        return QString("%1h %2m")
+        .arg(hours, 2, 10, QChar('0'))
+        .arg(minutes, 2, 10, QChar('0'));
+    }else if(minutes > 0){
+        return QString("%1m %2s")
+        .arg(minutes, 2, 10, QChar('0'))
             .arg(secs, 2, 10, QChar('0'));
-        }
+    }else{
+        return QString("%1s")
+        .arg(secs, 2, 10, QChar('0'));
     }
-    m_timeToCompleteLabel->setText(m_timeToCompleteStr);
 }
 
 void DownloadItem::setNotChecked(){
-    m_checkBox->setChecked(false);
+    setChecked(false);
 }
 
 void DownloadItem::deleteItem(){
@@ -384,12 +312,10 @@ void DownloadItem::deleteItem(){
 }
 
 void DownloadItem::onFinished(){
-    m_timer->deleteLater();
+    m_transferring = false;
 }
 
-DownloadItem::~DownloadItem(){
-    m_process->deleteLater();
-}
+DownloadItem::~DownloadItem(){}
 
 qint64 DownloadItem::getResumePos() const
 {
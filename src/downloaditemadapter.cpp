@@ -1,8 +1,7 @@
 #include "../headers/downloaditemadapter.h"
-#include "../headers/downloaditem.h"
 
 
-QVector<DownloadRecord> DownloadAdapter::toRecords(const QVector<QPair<DownloadItem*, std::shared_ptr<DownloadTask>>>& pairs){
+QVector<DownloadRecord> DownloadAdapter::toRecords(const QVector<QPair<DownloadTypes::DownloadRecord, std::shared_ptr<DownloadTask>>>& pairs){
     QVector<DownloadRecord> records;
     for(auto pair : pairs){
         /*DownloadRecord record;
@@ -51,16 +50,37 @@ QVector<DownloadRecord> DownloadAdapter::toRecords(const QVector<QPair<DownloadI
     return records;
 }
 
-DownloadRecord DownloadAdapter::toRecord(const DownloadItem* item, std::shared_ptr<DownloadTask> task){
+DownloadRecord DownloadAdapter::toRecord(const DownloadTypes::DownloadRecord &fields, std::shared_ptr<DownloadTask> task){
     DownloadRecord record;
+    fillFromRegistry(record, fields);
+    fillFromTask(record, task);
+    return record;
+}
+
+void DownloadAdapter::fillFromRegistry(DownloadRecord &record, const DownloadTypes::DownloadRecord &fields){
+    record.m_uuid = fields.id;
+    record.m_name = fields.name;
+    record.m_filePath = fields.filePath;
+    record.m_url = fields.url;
+    record.m_totalBytes = fields.totalBytes;
+    record.m_queuePosition = fields.queuePosition;
+    record.m_status = DownloadTask::statusCode(DownloadTask::fromDownloadStatus(fields.status));
+}
 
-    record.m_name = item->m_nameFileStr;
-    record.m_filePath = item->m_filePath;
-    record.m_url = item->getUrl();
-    record.m_totalBytes = item->m_bytesTotal;
-    record.m_downloadedBytes = task->m_resumeDownloadPos;
+void DownloadAdapter::fillFromTask(DownloadRecord &record, std::shared_ptr<DownloadTask> task){
+    record.m_downloadedBytes = task->m_savedChunks.isEmpty()
+                                   ? task->m_resumeDownloadPos
+                                   : task->m_savedChunks.completedBytes(task->m_fileInfo.chunkSize, task->m_fileInfo.totalBytes);
+    record.m_chunkBitmap = task->m_savedChunks.toRle();
+    record.m_chunkSize = task->m_fileInfo.chunkSize;
+    record.m_quantityOfChunks = task->m_fileInfo.quantityOfChunks;
     record.m_expectedHash = task->m_remoteExpectedHash;
     record.m_actualHash = task->m_actualHash;
+    record.m_etag = task->m_etag;
+    record.m_lastModified = task->m_lastModified;
+    record.m_mirrors = task->m_mirrors;
+    record.m_decompress = task->m_fileInfo.decompress;
+    record.m_decodeFormat = task->m_fileInfo.decodeFormat;
     if(task->m_activeAlgorithm == QCryptographicHash::Sha256){
         record.m_hashAlgorithm = "Sha256";
     }else{
@@ -73,23 +93,28 @@ DownloadRecord DownloadAdapter::toRecord(const DownloadItem* item, std::shared_p
 
     record.m_chunkHashes = serializedChunks;
 
-    DownloadTask::Status status = task->getStatus();
-    switch(status) {
-    case DownloadTask::Status::Pending: record.m_status = "pending"; break;
-    case DownloadTask::Status::Downloading: record.m_status = "downloading"; break;
-    case DownloadTask::Status::Resumed: record.m_status = "resumed"; break;
-    case DownloadTask::Status::StartNewTask: record.m_status = "start_new_task"; break;
-    case DownloadTask::Status::ResumedInPending: record.m_status = "resumed_in_pending"; break;
-    case DownloadTask::Status::ResumedInDownloading: record.m_status = "resumed_in_downloading"; break;
-    case DownloadTask::Status::Paused: record.m_status = "paused"; break;
-    case DownloadTask::Status::PausedNew: record.m_status = "paused_new"; break;
-    case DownloadTask::Status::PausedResume: record.m_status = "paused_resume"; break;
-    case DownloadTask::Status::Completed: record.m_status = "completed"; break;
-    case DownloadTask::Status::Error: record.m_status = "error"; break;
-    case DownloadTask::Status::Cancelled: record.m_status = "cancelled"; break;
-    case DownloadTask::Status::Deleted: record.m_status = "deleted"; break;
-    case DownloadTask::Status::Preparing: record.m_status = "preparing"; break;
-    case DownloadTask::Status::Prepared: record.m_status = "prepared"; break;
+    if(!task->m_expectedChunkHashes.isEmpty()){
+        QDataStream pieces(&record.m_pieceHashes, QIODevice::WriteOnly);
+        pieces << task->m_expectedChunkHashes;
     }
-    return record;
+}
+
+void DownloadAdapter::fillHistoryFromRegistry(DownloadTypes::HistoryEntry &entry, const DownloadTypes::DownloadRecord &fields){
+    entry.id = fields.id;
+    entry.name = fields.name;
+    entry.filePath = fields.filePath;
+    entry.url = fields.url;
+    entry.totalBytes = fields.totalBytes;
+
+    switch(fields.status){
+    case DownloadTypes::DownloadStatus::Error: entry.status = DownloadTypes::DownloadStatus::Error; break;
+    case DownloadTypes::DownloadStatus::Cancelled: entry.status = DownloadTypes::DownloadStatus::Cancelled; break;
+    default: entry.status = DownloadTypes::DownloadStatus::Completed; break;
+    }
+}
+
+void DownloadAdapter::fillHistoryFromTask(DownloadTypes::HistoryEntry &entry, std::shared_ptr<DownloadTask> task){
+    entry.hash = task->m_actualHash.isEmpty() ? task->m_remoteExpectedHash : task->m_actualHash;
+    entry.hashAlgorithm = task->m_activeAlgorithm == QCryptographicHash::Sha256 ? "Sha256" : "md5";
+    entry.finishedAt = QDateTime::currentDateTimeUtc();
 }
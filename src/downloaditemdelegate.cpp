@@ -0,0 +1,143 @@
+#include "../headers/downloaditemdelegate.h"
+
+DownloadItemDelegate::DownloadItemDelegate(QObject *parent) : QStyledItemDelegate(parent) {}
+
+DownloadItemDelegate::Layout DownloadItemDelegate::layout(const QRect &rect, bool cancellable) const{
+    Layout result;
+    QRect inner = rect.adjusted(MARGIN, MARGIN, -MARGIN, -MARGIN);
+
+    result.checkBox = QRect(inner.left(), inner.center().y() - 8, 16, 16);
+    QRect content = inner.adjusted(16 + 2 * MARGIN, 0, 0, 0);
+
+    int top = content.top();
+    result.remove = QRect(content.right() - BUTTON_WIDTH + 1, top, BUTTON_WIDTH, LINE_HEIGHT);
+    int right = result.remove.left() - MARGIN;
+    if(cancellable){
+        result.cancel = QRect(right - BUTTON_WIDTH + 1, top, BUTTON_WIDTH, LINE_HEIGHT);
+        right = result.cancel.left() - MARGIN;
+    }
+    result.openInFolder = QRect(right - BUTTON_WIDTH + 1, top, BUTTON_WIDTH, LINE_HEIGHT);
+    result.name = QRect(content.left(), top, result.openInFolder.left() - MARGIN - content.left(), LINE_HEIGHT);
+
+    result.progress = QRect(content.left(), top + LINE_HEIGHT + 2, content.width(), 12);
+
+    int lower = result.progress.bottom() + 2;
+    QRect line(content.left(), lower, content.width(), content.bottom() - lower + 1);
+    result.pauseSwitch = QRect(line.left(), line.center().y() - 5, 25, 10);
+
+    QRect columns = line.adjusted(25 + 20, 0, 0, 0);
+    int width = columns.width() / 5;
+    QRect *cells[] = {&result.status, &result.speed, &result.size, &result.percentages, &result.timeToComplete};
+    for(int i = 0; i < 5; ++i){
+        *cells[i] = QRect(columns.left() + i * width, line.top(), width, line.height());
+    }
+    return result;
+}
+
+void DownloadItemDelegate::paintButton(QPainter *painter, const QStyleOptionViewItem &option,
+                                       const QRect &rect, const QString &text) const{
+    QStyleOptionButton button;
+    button.rect = rect;
+    button.text = text;
+    button.state = QStyle::State_Enabled | QStyle::State_Raised;
+    button.fontMetrics = option.fontMetrics;
+    button.palette = option.palette;
+
+    QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_PushButton, &button, painter, option.widget);
+}
+
+void DownloadItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const{
+    if(!index.isValid()) return;
+
+    QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+    bool cancellable = index.data(DownloadListModel::CancellableRole).toBool();
+    bool pausable = index.data(DownloadListModel::PausableRole).toBool();
+    int percentages = index.data(DownloadListModel::ProgressRole).toInt();
+    Layout rows = layout(option.rect, cancellable);
+
+    painter->save();
+    style->drawPrimitive(QStyle::PE_PanelItemViewItem, &option, painter, option.widget);
+
+    QStyleOptionButton checkBox;
+    checkBox.rect = rows.checkBox;
+    checkBox.state = QStyle::State_Enabled |
+                     (index.data(Qt::CheckStateRole).toInt() == Qt::Checked ? QStyle::State_On : QStyle::State_Off);
+    checkBox.palette = option.palette;
+    style->drawPrimitive(QStyle::PE_IndicatorCheckBox, &checkBox, painter, option.widget);
+
+    painter->setPen(option.palette.color(QPalette::Text));
+    painter->setFont(option.font);
+    painter->drawText(rows.name, Qt::AlignLeft | Qt::AlignVCenter,
+                      option.fontMetrics.elidedText(index.data(Qt::DisplayRole).toString(), Qt::ElideMiddle, rows.name.width()));
+
+    paintButton(painter, option, rows.openInFolder, "Open in Folder");
+    if(cancellable) paintButton(painter, option, rows.cancel, "Cancell");
+    paintButton(painter, option, rows.remove, "Delete");
+
+    QStyleOptionProgressBar progress;
+    progress.rect = rows.progress;
+    progress.minimum = 0;
+    progress.maximum = 100;
+    progress.progress = percentages;
+    progress.state = QStyle::State_Enabled | QStyle::State_Horizontal;
+    progress.palette = option.palette;
+    progress.fontMetrics = option.fontMetrics;
+    style->drawControl(QStyle::CE_ProgressBar, &progress, painter, option.widget);
+
+    if(pausable){
+        Toogle::paintSwitch(painter, rows.pauseSwitch, index.data(DownloadListModel::RunningRole).toBool(),
+                            Qt::gray, Qt::white, Qt::blue);
+    }
+
+    painter->setPen(option.palette.color(QPalette::Text));
+    painter->drawText(rows.status, Qt::AlignLeft | Qt::AlignVCenter, index.data(DownloadListModel::StatusRole).toString());
+    painter->drawText(rows.speed, Qt::AlignCenter, index.data(DownloadListModel::SpeedRole).toString());
+    painter->drawText(rows.size, Qt::AlignCenter, index.data(DownloadListModel::SizeRole).toString());
+    painter->drawText(rows.percentages, Qt::AlignCenter, QString::number(percentages) + "%");
+    painter->drawText(rows.timeToComplete, Qt::AlignRight | Qt::AlignVCenter,
+                      index.data(DownloadListModel::TimeToCompleteRole).toString());
+
+    painter->restore();
+}
+
+QSize DownloadItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const{
+    Q_UNUSED(index);
+    return QSize(option.rect.width(), ROW_HEIGHT);
+}
+
+bool DownloadItemDelegate::editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                                       const QModelIndex &index){
+    if(event->type() != QEvent::MouseButtonRelease) return false;
+
+    auto *mouse = static_cast<QMouseEvent*>(event);
+    if(mouse->button() != Qt::LeftButton) return false;
+
+    auto *list = qobject_cast<DownloadListModel*>(model);
+    if(!list || !index.isValid()) return false;
+
+    bool cancellable = index.data(DownloadListModel::CancellableRole).toBool();
+    Layout rows = layout(option.rect, cancellable);
+    QPoint pos = mouse->position().toPoint();
+
+    if(rows.checkBox.contains(pos)){
+        bool checked = index.data(Qt::CheckStateRole).toInt() == Qt::Checked;
+        return model->setData(index, checked ? Qt::Unchecked : Qt::Checked, Qt::CheckStateRole);
+    }
+    if(index.data(DownloadListModel::PausableRole).toBool() && rows.pauseSwitch.contains(pos)){
+        return model->setData(index, !index.data(DownloadListModel::RunningRole).toBool(), DownloadListModel::RunningRole);
+    }
+    if(rows.openInFolder.contains(pos)){
+        list->openInFolder(index.row());
+        return true;
+    }
+    if(cancellable && rows.cancel.contains(pos)){
+        list->cancel(index.row());
+        return true;
+    }
+    if(rows.remove.contains(pos)){
+        list->remove(index.row());
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,320 @@
+#include "../headers/downloadlistmodel.h"
+
+DownloadListModel::DownloadListModel(QObject *parent) : QAbstractListModel(parent) {
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(REFRESH_INTERVAL_MS);
+    connect(m_refreshTimer, &QTimer::timeout, this, &DownloadListModel::refresh);
+}
+
+void DownloadListModel::setRefreshInterval(int milliseconds){
+    m_refreshTimer->setInterval(milliseconds);
+}
+
+int DownloadListModel::rowCount(const QModelIndex &parent) const{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant DownloadListModel::data(const QModelIndex &index, int role) const{
+    if(!index.isValid() || index.row() >= m_rows.size()) return {};
+
+    const Row &row = m_rows[index.row()];
+    if(!row.item) return historyData(row, role);
+
+    const DownloadItem *item = row.item;
+    switch(role){
+    case Qt::DisplayRole:
+        return item->getName();
+    case Qt::ToolTipRole:
+        return item->getFilePath();
+    case Qt::CheckStateRole:
+        return item->isChecked() ? Qt::Checked : Qt::Unchecked;
+    case ItemRole:
+        return QVariant::fromValue(const_cast<DownloadItem*>(item));
+    case StatusRole:
+        return item->getStatusText();
+    case ProgressRole:
+        return item->getPercentages();
+    case SizeRole:
+        return item->getSizeText();
+    case SpeedRole:
+        return item->getSpeedText();
+    case TimeToCompleteRole:
+        return item->getTimeToCompleteText();
+    case RunningRole:
+        return item->isRunning();
+    case PausableRole:
+        return item->isPauseVisible();
+    case CancellableRole:
+        return item->isCancelVisible();
+    }
+    return {};
+}
+
+// A finished download shows what the history keeps: a completed one is full,
+// a failed or cancelled one shows no progress.
+QVariant DownloadListModel::historyData(const Row &row, int role) const{
+    const DownloadTypes::HistoryEntry &entry = row.history;
+    bool completed = entry.status == DownloadTypes::DownloadStatus::Completed;
+    switch(role){
+    case Qt::DisplayRole:
+        return entry.name;
+    case Qt::ToolTipRole:
+        return entry.filePath;
+    case Qt::CheckStateRole:
+        return row.checked ? Qt::Checked : Qt::Unchecked;
+    case ItemRole:
+        return QVariant::fromValue<DownloadItem*>(nullptr);
+    case StatusRole:
+        return entry.status == DownloadTypes::DownloadStatus::Error ? QString("Error")
+             : entry.status == DownloadTypes::DownloadStatus::Cancelled ? QString("Cancelled") : QString("Completed");
+    case ProgressRole:
+        return completed ? 100 : 0;
+    case SizeRole:
+        return completed ? DownloadItem::sizeText(entry.totalBytes, entry.totalBytes) : QString();
+    case SpeedRole:
+    case TimeToCompleteRole:
+        return QString();
+    case RunningRole:
+    case PausableRole:
+    case CancellableRole:
+        return false;
+    }
+    return {};
+}
+
+// Checking a row and flipping its switch go through the item, which reports
+// them to the manager and the task as the widgets did.
+bool DownloadListModel::setData(const QModelIndex &index, const QVariant &value, int role){
+    if(!index.isValid() || index.row() >= m_rows.size()) return false;
+    DownloadItem *item = itemAt(index.row());
+    if(!item){
+        Row &row = m_rows[index.row()];
+        if(role != Qt::CheckStateRole) return false;
+        bool checked = value.toInt() == Qt::Checked;
+        if(row.checked != checked){
+            row.checked = checked;
+            emit dataChanged(index, index, {Qt::CheckStateRole});
+            emit historyCheckChanged(row.history.id, checked);
+        }
+        return true;
+    }
+
+    if(role == Qt::CheckStateRole){
+        item->setChecked(value.toInt() == Qt::Checked);
+        return true;
+    }
+    if(role == RunningRole && item->isPauseVisible()){
+        item->setRunning(value.toBool());
+        return true;
+    }
+    return false;
+}
+
+Qt::ItemFlags DownloadListModel::flags(const QModelIndex &index) const{
+    if(!index.isValid()) return Qt::NoItemFlags;
+    return Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
+}
+
+QHash<int, QByteArray> DownloadListModel::roleNames() const{
+    QHash<int, QByteArray> names = QAbstractListModel::roleNames();
+    names[ItemRole] = "item";
+    names[StatusRole] = "status";
+    names[ProgressRole] = "progress";
+    names[SizeRole] = "size";
+    names[SpeedRole] = "speed";
+    names[TimeToCompleteRole] = "timeToComplete";
+    names[RunningRole] = "running";
+    names[PausableRole] = "pausable";
+    names[CancellableRole] = "cancellable";
+    return names;
+}
+
+void DownloadListModel::addItem(DownloadItem *item){
+    addItems({item});
+}
+
+// A page of history is inserted as one block, so the view lays out once.
+void DownloadListModel::addItems(const QVector<DownloadItem*> &items){
+    QVector<DownloadItem*> added;
+    for(DownloadItem *item : items){
+        if(item && !m_itemRows.contains(item) && !added.contains(item)) added.append(item);
+    }
+    if(added.isEmpty()) return;
+
+    int first = m_rows.size();
+    beginInsertRows(QModelIndex(), first, first + added.size() - 1);
+    for(DownloadItem *item : added){
+        m_itemRows.insert(item, m_rows.size());
+        Row row;
+        row.item = item;
+        m_rows.append(row);
+        connect(item, &DownloadItem::changed, this, &DownloadListModel::onItemChanged);
+    }
+    endInsertRows();
+}
+
+void DownloadListModel::removeItem(DownloadItem *item){
+    int row = rowOf(item);
+    if(row < 0) return;
+
+    disconnect(item, nullptr, this, nullptr);
+    m_dirty.remove(item);
+    m_transferring.remove(item);
+    eraseRow(row);
+}
+
+DownloadItem* DownloadListModel::itemAt(int row) const{
+    return row >= 0 && row < m_rows.size() ? m_rows[row].item : nullptr;
+}
+
+int DownloadListModel::rowOf(DownloadItem *item) const{
+    return m_itemRows.value(item, -1);
+}
+
+void DownloadListModel::addHistory(const QVector<DownloadTypes::HistoryEntry> &entries){
+    QVector<DownloadTypes::HistoryEntry> added;
+    QSet<QUuid> ids;
+    for(const auto &entry : entries){
+        if(!entry.id.isNull() && (m_historyRows.contains(entry.id) || ids.contains(entry.id))) continue;
+        ids.insert(entry.id);
+        added.append(entry);
+    }
+    if(added.isEmpty()) return;
+
+    int first = m_rows.size();
+    beginInsertRows(QModelIndex(), first, first + added.size() - 1);
+    for(const auto &entry : std::as_const(added)){
+        if(!entry.id.isNull()) m_historyRows.insert(entry.id, m_rows.size());
+        Row row;
+        row.history = entry;
+        m_rows.append(row);
+    }
+    endInsertRows();
+}
+
+void DownloadListModel::replaceWithHistory(DownloadItem *item, const DownloadTypes::HistoryEntry &entry){
+    int position = rowOf(item);
+    if(position < 0) return;
+
+    disconnect(item, nullptr, this, nullptr);
+    m_itemRows.remove(item);
+    m_dirty.remove(item);
+    m_transferring.remove(item);
+
+    Row &row = m_rows[position];
+    row.checked = item->isChecked();
+    row.item = nullptr;
+    row.history = entry;
+    if(!entry.id.isNull()) m_historyRows.insert(entry.id, position);
+    emit dataChanged(index(position), index(position));
+}
+
+void DownloadListModel::removeHistory(const QUuid &id){
+    int row = rowOfHistory(id);
+    if(row >= 0) eraseRow(row);
+}
+
+void DownloadListModel::setHistoryChecked(const QUuid &id, bool checked){
+    int row = rowOfHistory(id);
+    if(row < 0 || m_rows[row].checked == checked) return;
+    m_rows[row].checked = checked;
+    emit dataChanged(index(row), index(row), {Qt::CheckStateRole});
+}
+
+int DownloadListModel::rowOfHistory(const QUuid &id) const{
+    return m_historyRows.value(id, -1);
+}
+
+void DownloadListModel::openInFolder(int row){
+    if(row < 0 || row >= m_rows.size()) return;
+    if(DownloadItem *item = m_rows[row].item){
+        item->openInFolder();
+    }else{
+        DownloadItem::revealFile(m_rows[row].history.filePath);
+    }
+}
+
+void DownloadListModel::cancel(int row){
+    if(DownloadItem *item = itemAt(row)) item->cancel();
+}
+
+// The row disappears with the download; the view finishes handling the
+// click that asked for it first.
+void DownloadListModel::remove(int row){
+    if(row < 0 || row >= m_rows.size()) return;
+    if(DownloadItem *item = m_rows[row].item){
+        QMetaObject::invokeMethod(item, &DownloadItem::remove, Qt::QueuedConnection);
+    }else{
+        QUuid id = m_rows[row].history.id;
+        QMetaObject::invokeMethod(this, [this, id](){ emit historyRemovalRequested(id); }, Qt::QueuedConnection);
+    }
+}
+
+void DownloadListModel::eraseRow(int row){
+    beginRemoveRows(QModelIndex(), row, row);
+    const Row &erased = m_rows[row];
+    if(erased.item){
+        m_itemRows.remove(erased.item);
+    }else if(!erased.history.id.isNull()){
+        m_historyRows.remove(erased.history.id);
+    }
+    m_rows.remove(row);
+    reindex(row);
+    endRemoveRows();
+}
+
+void DownloadListModel::reindex(int from){
+    for(int i = from; i < m_rows.size(); ++i){
+        const Row &row = m_rows[i];
+        if(row.item){
+            m_itemRows[row.item] = i;
+        }else if(!row.history.id.isNull()){
+            m_historyRows[row.history.id] = i;
+        }
+    }
+}
+
+void DownloadListModel::onItemChanged(){
+    markDirty(qobject_cast<DownloadItem*>(sender()));
+}
+
+void DownloadListModel::markDirty(DownloadItem *item){
+    if(!m_itemRows.contains(item)) return;
+
+    m_dirty.insert(item);
+    if(item->isTransferring()){
+        m_transferring.insert(item);
+    }else{
+        m_transferring.remove(item);
+    }
+    if(!m_refreshTimer->isActive()) m_refreshTimer->start();
+}
+
+// One dataChanged spanning the dirty rows; the view repaints only the part
+// of that span it shows.
+void DownloadListModel::refresh(){
+    if(!m_transferring.isEmpty() &&
+        (!m_sinceSpeedSample.isValid() || m_sinceSpeedSample.elapsed() >= SPEED_SAMPLE_MS)){
+        m_sinceSpeedSample.start();
+        for(DownloadItem *item : std::as_const(m_transferring)){
+            item->sampleSpeed();
+            m_dirty.insert(item);
+        }
+    }
+
+    if(!m_dirty.isEmpty()){
+        int first = m_rows.size();
+        int last = -1;
+        for(DownloadItem *item : std::as_const(m_dirty)){
+            int row = m_itemRows.value(item, -1);
+            if(row < 0) continue;
+            first = qMin(first, row);
+            last = qMax(last, row);
+        }
+        m_dirty.clear();
+        if(last >= 0) emit dataChanged(index(first), index(last));
+    }
+
+    // Idle lists cost no timer events.
+    if(m_transferring.isEmpty()) m_refreshTimer->stop();
+}
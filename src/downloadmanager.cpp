@@ -2,9 +2,12 @@
 
 DownloadManager::DownloadManager(QObject *parent) : QObject(parent){
     m_threadPool = new ThreadPool(this);
-    m_db = new DownloadDatabase("",this);
-    m_networkManager = new NetworkManager(this);
+    m_db = new AsyncDatabase(QString(), this);
+    m_registry = new DownloadRegistry(this);
+    m_checkpoints = new CheckpointService(m_db, m_registry, this);
     m_storageManager = new StorageManager();
+    m_cache = std::make_shared<DownloadCache>(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/content");
+    m_storageManager->setCache(m_cache);
 
     m_storageThread = new QThread(this);
 
@@ -14,34 +17,55 @@ DownloadManager::DownloadManager(QObject *parent) : QObject(parent){
 
     m_storageThread->start();
 
+    // The registry emits on the task threads.
+    connect(m_registry, &DownloadRegistry::progressChanged, this, &DownloadManager::onProgressChanged, Qt::QueuedConnection);
+    connect(m_registry, &DownloadRegistry::statusChanged, this, &DownloadManager::onStatusChanged, Qt::QueuedConnection);
+
     connect(m_threadPool, &ThreadPool::allDownloadsStoped, this, [this](){
-        QVector<QPair<DownloadItem*, std::shared_ptr<DownloadTask>>> pairs;
-        for(auto it = m_itemTask.begin(); it != m_itemTask.end(); ++it){
-            pairs.append(QPair<DownloadItem*, std::shared_ptr<DownloadTask>>(it.key(), it.value()));
+        QVector<QPair<DownloadTypes::DownloadRecord, std::shared_ptr<DownloadTask>>> pairs;
+        for(auto it = m_tasks.begin(); it != m_tasks.end(); ++it){
+            pairs.append(QPair<DownloadTypes::DownloadRecord, std::shared_ptr<DownloadTask>>(m_registry->getRecord(it.key()), it.value()));
         }
-        m_db->saveDownloads(DownloadAdapter().toRecords(pairs));
+        m_db->save(DownloadAdapter().toRecords(pairs));
+        m_db->flush().then(this, [this](bool committed){
+            if(!committed) qDebug() << "The final save failed; progress since the last checkpoint is lost";
+            emit readyToQuit();
+        });
     }, Qt::QueuedConnection);
-
-    connect(m_db, &DownloadDatabase::saveSuccesed, this, [&](){
-        emit readyToQuit();
-    });
 }
 
 void DownloadManager::processDownloadRequest(const QString &url, const QString &saveDir, const DownloadTypes::UserChoice &userChoice){
+    // Extra whitespace-separated links are mirrors of the first one.
+    QStringList mirrors = url.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    QString primaryUrl = mirrors.isEmpty() ? url : mirrors.takeFirst();
+
+    // One probe per request, so concurrent requests cannot pick up each other's answers.
+    NetworkManager *probe = new NetworkManager(this);
+
+    connect(probe, &NetworkManager::fileInfoReady, this, [=](const RemoteFileInfo &info) {
+        probe->deleteLater();
 
-    connect(m_networkManager, &NetworkManager::fileInfoReady, this, [=](const RemoteFileInfo &info) {
         if (!info.isValid) {
             return;
         }
 
+        // The decoder follows the suffix that is stripped from the saved name,
+        // which need not be the one in the URL.
         QString finalFileName = !userChoice.newFileName.isEmpty() ? userChoice.newFileName + info.suffix : info.fileName;
+        int decodeFormat = StreamDecoder::None;
+        if (userChoice.decompress) {
+            StreamDecoder::Format format = StreamDecoder::formatForFileName(finalFileName);
+            if (StreamDecoder::isSupported(format)) decodeFormat = format;
+            finalFileName = StreamDecoder::decodedFileName(finalFileName);
+        }
         QString filePath = QDir(saveDir).absoluteFilePath(finalFileName);
 
         DownloadTypes::ConflictResult result = checkForConflicts(info.url.toString(), filePath);
 
         if(result.type == DownloadTypes::NoConflict || userChoice.action == DownloadTypes::Download ||
             (userChoice.action == DownloadTypes::DownloadWithNewName && result.type == DownloadTypes::UrlDownloading)){
-            createAndStartDownload(info.url.toString(), filePath, finalFileName, info.fileSize);
+            createAndStartDownload(info, filePath, finalFileName, info.supportsRange ? mirrors : QStringList(),
+                                   QString(), userChoice.decompress, decodeFormat);
         } else if(userChoice.action == DownloadTypes::Cancel) {
 
         }else{
@@ -50,7 +74,7 @@ void DownloadManager::processDownloadRequest(const QString &url, const QString &
 
     }, Qt::SingleShotConnection);
 
-    m_networkManager->getRemoteFileInfo(QUrl(url));
+    probe->probeRemoteFile(QUrl(primaryUrl));
 }
 
 DownloadTypes::ConflictResult DownloadManager::checkForConflicts(const QString &url, const QString &filePuth)
@@ -61,7 +85,7 @@ DownloadTypes::ConflictResult DownloadManager::checkForConflicts(const QString &
 
     bool fileExists = QFile::exists(result.filePath);
 
-    result.existingDownloads = m_urlsDownloading.contains(url);
+    result.existingDownloads = !m_registry->findByUrl(url).isNull();
 
     if (fileExists && result.existingDownloads) {
         result.type = DownloadTypes::BothConflicts;
@@ -75,52 +99,191 @@ DownloadTypes::ConflictResult DownloadManager::checkForConflicts(const QString &
     return result;
 }
 
-void DownloadManager::createAndStartDownload(const QString &url, const QString &filePath, const QString& nameOfFile, qint64 fileSize) {
+void DownloadManager::createAndStartDownload(const RemoteFileInfo &info, const QString &filePath, const QString& nameOfFile,
+                                             const QStringList &mirrors, const QString &expectedHash, bool decompress,
+                                             int decodeFormat, qint64 chunkSize, const QVector<QByteArray> &pieceHashes) {
+    QString url = info.url.toString();
+
     DownloadTypes::DownloadRecord fileInfo;
     fileInfo.name = nameOfFile;
     fileInfo.filePath = filePath;
-    fileInfo.totalBytes = fileSize;
+    fileInfo.totalBytes = info.fileSize;
+    fileInfo.etag = info.etag;
+    fileInfo.lastModified = info.lastModified;
+    fileInfo.mirrors = mirrors;
+    fileInfo.expectedHash = expectedHash;
+    fileInfo.decompress = decompress;
+    fileInfo.decodeFormat = decodeFormat;
+    fileInfo.chunkSize = chunkSize > 0 ? chunkSize : DownloadTypes::chunkSizeFor(info.fileSize);
+    fileInfo.id = QUuid::createUuid();
+
+    // Registered right away, so a second request for the URL sees the conflict.
+    DownloadTypes::DownloadRecord entry = fileInfo;
+    entry.url = url;
+    entry.queuePosition = m_nextQueuePosition++;
+    m_registry->addRecord(std::move(entry));
+
+    if(decompress){
+        startTask(info, fileInfo, DownloadCache::Entry(), pieceHashes);
+        return;
+    }
 
-    DownloadItem *item = new DownloadItem(url, filePath, nameOfFile);
+    // The cache index is read and rewritten on the storage thread, like the
+    // cache's other file work.
+    std::shared_ptr<DownloadCache> cache = m_cache;
+    QMetaObject::invokeMethod(m_storageManager, [this, cache, info, fileInfo, pieceHashes, url](){
+        DownloadCache::Entry cached = cache->lookup(fileInfo.expectedHash, url, info.etag, info.fileSize);
+        QMetaObject::invokeMethod(this, [this, info, fileInfo, cached, pieceHashes](){
+            startTask(info, fileInfo, cached, pieceHashes);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void DownloadManager::startTask(const RemoteFileInfo &info, DownloadTypes::DownloadRecord fileInfo, const DownloadCache::Entry &cached,
+                                const QVector<QByteArray> &pieceHashes){
+    QString url = info.url.toString();
+
+    // Content fetched before is copied out of the cache; its hash also stands
+    // in for the checksum discovery.
+    if(!cached.path.isEmpty()) fileInfo.expectedHash = cached.hash;
+
+    DownloadItem *item = new DownloadItem(url, fileInfo.filePath, fileInfo.name);
+    item->setId(fileInfo.id);
     std::shared_ptr<DownloadTask> task = std::make_shared<DownloadTask>(url, fileInfo);
 
+    // The probe's bytes can be reused only if the rest can be fetched from that
+    // offset, and not when they still have to go through a decoder.
+    if(!cached.path.isEmpty()){
+        task->setCachedSource(cached.path);
+    }else if((info.complete || info.supportsRange) && !fileInfo.decompress){
+        task->setPrefetchedData(info.prefetched, info.complete);
+    }
+    if(!pieceHashes.isEmpty()){
+        task->setExpectedChunkHashes(pieceHashes);
+    }
+
     QMetaObject::invokeMethod(m_storageManager, "openFile",
                               Qt::QueuedConnection,
                               Q_ARG(DownloadTypes::DownloadRecord, fileInfo));
 
     m_items.push_back(item);
+    m_activeItems.insert(fileInfo.id, item);
+    connectTask(item, task);
+    startWhenFileOpen(item, task, false);
+}
+
+// Other downloads' files open in between, so the connection stays until its
+// own file is open. It is dropped then, or when the download is archived or
+// deleted first, so it never keeps a task alive.
+void DownloadManager::startWhenFileOpen(DownloadItem *item, std::shared_ptr<DownloadTask> task, bool restored){
+    const QUuid id = item->getId();
+    m_pendingOpens.insert(id, connect(m_storageManager, &StorageManager::fileOpen, this,
+                                      [this, id, item, task, restored](const DownloadTypes::DownloadRecord &fileInfo){
+        if(!m_pendingOpens.contains(id) || fileInfo != task->getFileInfo()) return;
+        disconnect(m_pendingOpens.take(id));
+
+        if(restored){
+            m_threadPool->addTaskFromDB(task);
+        }else{
+            m_threadPool->addTask(task);
+        }
+        m_tasks[id] = task;
+        m_checkpoints->track(id, task);
+
+        emit downloadReadyToAdd(item);
+    }, Qt::QueuedConnection));
+}
+
+void DownloadManager::connectTask(DownloadItem *item, std::shared_ptr<DownloadTask> task){
+    const QUuid id = item->getId();
 
     connect(m_storageManager, &StorageManager::savedLastChunk, task.get(), &DownloadTask::onFinished, Qt::QueuedConnection);
-    connect(m_storageManager, &StorageManager::changeQuantityOfChunks, task.get(), &DownloadTask::changeQuantityOfChunks, Qt::QueuedConnection);
     connect(task.get(), &DownloadTask::openFile, m_storageManager, &StorageManager::openFile, Qt::QueuedConnection);
     connect(task.get(), &DownloadTask::clearFile, m_storageManager, &StorageManager::clearFile, Qt::QueuedConnection);
     connect(task.get(), &DownloadTask::stopWrite, m_storageManager, &StorageManager::closeFile, Qt::QueuedConnection);
+    connect(task.get(), &DownloadTask::finishWrite, m_storageManager, &StorageManager::finishFile, Qt::QueuedConnection);
     connect(task.get(), &DownloadTask::writeChunk, m_storageManager, &StorageManager::writeChunk, Qt::QueuedConnection);
+    connect(m_storageManager, &StorageManager::chunksSaved, task.get(), &DownloadTask::onChunksSaved, Qt::QueuedConnection);
+    connect(task.get(), &DownloadTask::materializeFromCache, m_storageManager, &StorageManager::materializeFile, Qt::QueuedConnection);
+    connect(m_storageManager, &StorageManager::materializeFailed, task.get(), &DownloadTask::onMaterializeFailed, Qt::QueuedConnection);
+    connect(task.get(), &DownloadTask::cacheFile, m_storageManager, &StorageManager::cacheFile, Qt::QueuedConnection);
     connect(item, &DownloadItem::statusChanged, task.get(), &DownloadTask::setStatus, Qt::QueuedConnection);
-    connect(task.get(), &DownloadTask::progressChanged, item, &DownloadItem::onProgressChanged, Qt::QueuedConnection);
-    connect(task.get(), &DownloadTask::statusChanged, m_threadPool, &ThreadPool::chackWhatStatus, Qt::QueuedConnection);
-    connect(task.get(), &DownloadTask::statusChanged, item, &DownloadItem::chackWhatStatus, Qt::QueuedConnection);
+
+    // Applied on the task's thread; the registry's signals then reach the
+    // list, the scheduler and the checkpoints.
+    DownloadRegistry *registry = m_registry;
+    connect(task.get(), &DownloadTask::progressChanged, m_registry, [registry, id](qint64 bytesReceived, qint64 bytesTotal){
+        registry->updateProgress(id, bytesReceived, bytesTotal);
+    }, Qt::DirectConnection);
+    connect(task.get(), &DownloadTask::statusChanged, m_registry, [registry, id](DownloadTask::Status status){
+        registry->updateStatus(id, DownloadTask::toDownloadStatus(status));
+    }, Qt::DirectConnection);
+
     connect(item, &DownloadItem::deleteDownload, this, &DownloadManager::deleteDownload);
     connect(item, &DownloadItem::finishedDownload, this, &DownloadManager::finished);
     connect(item, &DownloadItem::ChangedBt, this, &DownloadManager::changeBt);
+}
 
-    connect(m_storageManager, &StorageManager::fileOpen, this, [=](const DownloadTypes::DownloadRecord &fileInfo){
-        if(fileInfo == task->getFileInfo()){
+void DownloadManager::onProgressChanged(QUuid id, qint64 bytesReceived, qint64 bytesTotal){
+    if(DownloadItem *item = m_activeItems.value(id)){
+        item->onProgressChanged(bytesReceived, bytesTotal);
+    }
+}
 
-            m_threadPool->addTask(task);
+void DownloadManager::onStatusChanged(QUuid id, DownloadTypes::DownloadStatus status){
+    DownloadTask::Status taskStatus = DownloadTask::fromDownloadStatus(status);
+    if(std::shared_ptr<DownloadTask> task = m_tasks.value(id)){
+        m_threadPool->chackWhatStatus(task.get(), taskStatus);
+    }
+    if(DownloadItem *item = m_activeItems.value(id)){
+        item->chackWhatStatus(taskStatus);
+    }
+}
+
+// Everything a HEAD request and the checksum probes would find out is already
+// in the metalink, so the downloads start straight away.
+void DownloadManager::importMetalink(const QString &metalinkPath, const QString &saveDir){
+    QString error;
+    const QVector<MetalinkFile> files = MetalinkParser::parseFile(metalinkPath, &error);
+    if(files.isEmpty()){
+        qDebug() << "Metalink import failed:" << (error.isEmpty() ? "no downloadable files" : error);
+        return;
+    }
 
-            m_itemTask[item] = task;
-            m_urlsDownloading.append(url);
+    for(const MetalinkFile &file : files){
+        QString filePath = QDir(saveDir).absoluteFilePath(file.name);
 
-            emit downloadReadyToAdd(item);
+        DownloadTypes::ConflictResult result = checkForConflicts(file.urls.first(), filePath);
+        if(result.type != DownloadTypes::NoConflict){
+            qDebug() << "Metalink entry" << file.name << "skipped: already downloading or file exists";
+            continue;
         }
-    }, static_cast<Qt::ConnectionType>(Qt::SingleShotConnection | Qt::QueuedConnection));
 
+        RemoteFileInfo info;
+        info.url = QUrl(file.urls.first());
+        info.fileName = file.name;
+        info.fileSize = qMax<qint64>(file.size, 0);
+        info.supportsRange = true;
+        info.isValid = true;
+
+        // With SHA-256 pieces the chunks follow the piece layout, so every
+        // chunk can be checked against its piece hash.
+        bool usePieces = file.pieceType == "sha-256" && !file.pieceHashes.isEmpty()
+                         && file.pieceLength >= 64 * 1024 && file.pieceLength <= 64 * 1024 * 1024;
+
+        if(!usePieces && !file.pieceHashes.isEmpty()){
+            qDebug() << "Metalink pieces of" << file.pieceLength << "bytes (" << file.pieceType << ") do not match the chunk layout";
+        }
+
+        createAndStartDownload(info, filePath, file.name, file.urls.mid(1), file.hashes.value("sha-256"),
+                               false, StreamDecoder::None, usePieces ? file.pieceLength : 0,
+                               usePieces ? file.pieceHashes : QVector<QByteArray>());
+    }
 }
 
 void DownloadManager::finished(){
     DownloadItem *item = qobject_cast<DownloadItem*>(sender());
-    m_urlsDownloading.removeOne(item->getUrl());
+    archive(item);
 }
 
 void DownloadManager::changeBt(DownloadItem* item, bool checked){
@@ -129,8 +292,20 @@ void DownloadManager::changeBt(DownloadItem* item, bool checked){
     }else if(!checked && m_selectedItems.contains(item)){
         m_selectedItems.removeOne(item);
     }
+    updateSelectionButtons();
+}
+
+void DownloadManager::changeHistoryBt(const QUuid &id, bool checked){
+    if(checked){
+        m_selectedHistory.insert(id);
+    }else{
+        m_selectedHistory.remove(id);
+    }
+    updateSelectionButtons();
+}
 
-    if(m_selectedItems.size() > 0){
+void DownloadManager::updateSelectionButtons(){
+    if(m_selectedItems.size() > 0 || !m_selectedHistory.isEmpty()){
         emit showButtons();
     }else{
         emit hideButtons();
@@ -143,6 +318,9 @@ void DownloadManager::downloadAll(){
         item->setNotChecked();
     }
     m_selectedItems.clear();
+    for(const QUuid &id : std::exchange(m_selectedHistory, {})){
+        emit historyUnchecked(id);
+    }
     emit hideButtons();
 }
 
@@ -152,6 +330,9 @@ void DownloadManager::pauseAll(){
         item->setNotChecked();
     }
     m_selectedItems.clear();
+    for(const QUuid &id : std::exchange(m_selectedHistory, {})){
+        emit historyUnchecked(id);
+    }
     emit hideButtons();
 }
 
@@ -160,64 +341,144 @@ void DownloadManager::deleteAll(){
         item->deleteItem();
     }
     m_selectedItems.clear();
+    for(const QUuid &id : std::exchange(m_selectedHistory, {})){
+        deleteHistoryEntry(id);
+    }
     emit hideButtons();
 }
 
+// Only unfinished downloads get a task at startup; finished ones are read
+// a page at a time as the list is scrolled.
 void DownloadManager::setItemsFromDB(){
-    QVector<DownloadRecord> records = m_db->getDownloads();
+    m_db->loadActiveDownloads().then(this, [this](const QVector<DownloadRecord> &records){
+        restoreItems(records);
+        loadMoreHistory();
+    });
+}
+
+void DownloadManager::loadMoreHistory(){
+    if(m_historyLoading || m_historyExhausted) return;
+
+    m_historyLoading = true;
+    m_db->loadHistory(m_historyLoaded, HISTORY_PAGE_SIZE).then(this, [this](const QVector<DownloadTypes::HistoryEntry> &entries){
+        m_historyLoading = false;
+        m_historyLoaded += entries.size();
+        m_historyExhausted = entries.size() < HISTORY_PAGE_SIZE;
+        restoreHistory(entries);
+    });
+}
 
-    for(auto& record : records){
+void DownloadManager::restoreHistory(const QVector<DownloadTypes::HistoryEntry> &entries){
+    // Entries archived during this session are listed already.
+    QVector<DownloadTypes::HistoryEntry> fresh;
+    for(const auto& entry : entries){
+        if(!entry.id.isNull()){
+            if(m_historyIds.contains(entry.id)) continue;
+            m_historyIds.insert(entry.id);
+        }
+        fresh.append(entry);
+    }
+    if(!fresh.isEmpty()) emit historyReadyToAdd(fresh);
+}
+
+// A finished download drops its task and then its item; its row stays in
+// the list as a history entry, so memory and signal traffic follow the
+// active downloads only.
+void DownloadManager::archive(DownloadItem *item){
+    const QUuid id = item->getId();
+    disconnect(m_pendingOpens.take(id));
+    std::shared_ptr<DownloadTask> task = m_tasks.take(id);
+    if(!task) return;
+
+    m_checkpoints->forget(id);
+    m_activeItems.remove(id);
+    task->disconnect(item);
+    task->disconnect(m_registry);
+    item->disconnect(task.get());
+
+    DownloadTypes::HistoryEntry entry;
+    DownloadAdapter::fillHistoryFromRegistry(entry, m_registry->getRecord(id));
+    m_registry->removeRecord(id);
+
+    QPointer<DownloadItem> guard(item);
+    QMetaObject::invokeMethod(task.get(), [this, task, entry, guard]() mutable {
+        DownloadAdapter::fillHistoryFromTask(entry, task);
+        QMetaObject::invokeMethod(this, [this, entry, guard](){
+            // Deleted in the meantime; its row is already queued for removal.
+            if(!guard) return;
+
+            m_db->archive(entry);
+            // New entries sort first, so later pages start one row further.
+            ++m_historyLoaded;
+            m_historyIds.insert(entry.id);
+
+            DownloadItem *item = guard.data();
+            m_items.removeOne(item);
+            if(m_selectedItems.removeOne(item)) m_selectedHistory.insert(entry.id);
+            emit downloadArchived(item, entry);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void DownloadManager::restoreItems(const QVector<DownloadRecord> &records){
+    for(const auto& record : records){
         DownloadTypes::DownloadRecord fileInfo;
         fileInfo.name = record.m_name;
         fileInfo.filePath = record.m_filePath;
         fileInfo.totalBytes = record.m_totalBytes;
+        fileInfo.etag = record.m_etag;
+        fileInfo.lastModified = record.m_lastModified;
+        fileInfo.mirrors = record.m_mirrors;
+        fileInfo.decompress = record.m_decompress;
+        fileInfo.decodeFormat = record.m_decodeFormat;
+        // A known checksum spares the task its discovery requests.
+        fileInfo.expectedHash = record.m_expectedHash;
+        fileInfo.chunkSize = record.m_chunkSize > 0 ? record.m_chunkSize : DownloadTypes::DEFAULT_CHUNK_SIZE;
+        fileInfo.id = record.m_uuid.isNull() ? QUuid::createUuid() : record.m_uuid;
+        if(record.m_quantityOfChunks > 0) fileInfo.quantityOfChunks = record.m_quantityOfChunks;
         DownloadItem* item = new DownloadItem(record.m_url, record.m_filePath, record.m_name);
+        item->setId(fileInfo.id);
         std::shared_ptr<DownloadTask> task = std::make_shared<DownloadTask>(record.m_url, fileInfo);
 
         m_items.push_back(item);
+        m_activeItems.insert(fileInfo.id, item);
 
         item->updateFromDb(record);
+        m_nextQueuePosition = qMax(m_nextQueuePosition, record.m_queuePosition + 1);
         task->updateFromDb(record);
 
-        connect(m_storageManager, &StorageManager::fileOpen, this, [=](const DownloadTypes::DownloadRecord &fileInfo){
-            if(fileInfo == task->getFileInfo() && !m_itemTask[item]){
-
-                m_threadPool->addTaskFromDB(task);
+        DownloadTypes::DownloadRecord entry = fileInfo;
+        entry.url = record.m_url;
+        entry.queuePosition = record.m_queuePosition;
+        entry.downloadedBytes = record.m_downloadedBytes;
+        entry.status = DownloadTask::toDownloadStatus(task->getStatus());
+        m_registry->addRecord(std::move(entry));
 
-                m_itemTask[item] = task;
-                m_urlsDownloading.append(record.m_url);
-
-                emit downloadReadyToAdd(item);
-            }
-        }, Qt::QueuedConnection);
+        startWhenFileOpen(item, task, true);
 
         QMetaObject::invokeMethod(m_storageManager, "openFile",
                                   Qt::QueuedConnection,
                                   Q_ARG(DownloadTypes::DownloadRecord, fileInfo));
 
-        connect(m_storageManager, &StorageManager::savedLastChunk, task.get(), &DownloadTask::onFinished, Qt::QueuedConnection);
-        connect(m_storageManager, &StorageManager::changeQuantityOfChunks, task.get(), &DownloadTask::changeQuantityOfChunks, Qt::QueuedConnection);
-        connect(task.get(), &DownloadTask::openFile, m_storageManager, &StorageManager::openFile, Qt::QueuedConnection);
-        connect(task.get(), &DownloadTask::clearFile, m_storageManager, &StorageManager::clearFile, Qt::QueuedConnection);
-        connect(task.get(), &DownloadTask::stopWrite, m_storageManager, &StorageManager::closeFile, Qt::QueuedConnection);
-        connect(task.get(), &DownloadTask::writeChunk, m_storageManager, &StorageManager::writeChunk, Qt::QueuedConnection);
-        connect(item, &DownloadItem::statusChanged, task.get(), &DownloadTask::setStatus, Qt::QueuedConnection);
-        connect(task.get(), &DownloadTask::progressChanged, item, &DownloadItem::onProgressChanged, Qt::QueuedConnection);
-        connect(task.get(), &DownloadTask::statusChanged, m_threadPool, &ThreadPool::chackWhatStatus, Qt::QueuedConnection);
-        connect(task.get(), &DownloadTask::statusChanged, item, &DownloadItem::chackWhatStatus, Qt::QueuedConnection);
-        connect(item, &DownloadItem::deleteDownload, this, &DownloadManager::deleteDownload);
-        connect(item, &DownloadItem::finishedDownload, this, &DownloadManager::finished);
-
-        connect(item, &DownloadItem::ChangedBt, this, &DownloadManager::changeBt);
+        connectTask(item, task);
     }
 }
 
+QFuture<QVector<DownloadTypes::HistoryEntry>> DownloadManager::searchHistory(const DownloadTypes::HistoryQuery &query){
+    return m_db->searchHistory(query);
+}
+
 void DownloadManager::prepareToExit(){
+    m_checkpoints->stop();
+
     QVector<std::shared_ptr<DownloadTask>> tasks;
 
-    for(auto task : m_itemTask){
-        if(task->getStatus() == DownloadTask::Status::Downloading || task->getStatus() == DownloadTask::Status::ResumedInDownloading
-            || task->getStatus() == DownloadTask::Status::Resumed){
+    for(const DownloadRegistry::Progress &progress : m_registry->snapshot()){
+        std::shared_ptr<DownloadTask> task = m_tasks.value(progress.id);
+        if(!task) continue;
+
+        if(progress.status == DownloadTypes::DownloadStatus::Downloading || progress.status == DownloadTypes::DownloadStatus::ResumedInDownloading
+            || progress.status == DownloadTypes::DownloadStatus::Resumed){
             tasks.append(task);
         }
     }
@@ -227,7 +488,9 @@ void DownloadManager::prepareToExit(){
 void DownloadManager::deleteDownload(DownloadItem *item){
     if (!item) return;
 
-    std::shared_ptr<DownloadTask> task = m_itemTask.value(item);
+    const QUuid id = item->getId();
+    disconnect(m_pendingOpens.take(id));
+    std::shared_ptr<DownloadTask> task = m_tasks.take(id);
 
     if (task) {
         m_threadPool->removeTask(task);
@@ -241,13 +504,25 @@ void DownloadManager::deleteDownload(DownloadItem *item){
         //task->deleteLater();
     }
 
-    m_itemTask.remove(item);
+    m_activeItems.remove(id);
+    m_registry->removeRecord(id);
+    m_checkpoints->forget(id);
     m_items.removeOne(item);
-    m_db->deleteDownload(DownloadAdapter().toRecord(item, task));
-    m_urlsDownloading.removeOne(item->getUrl());
+    m_db->remove(item->getUrl());
     emit deleteDownloadItem(item);
 }
 
+void DownloadManager::deleteHistoryEntry(const QUuid &id){
+    if(!m_historyIds.remove(id)) return;
+
+    m_selectedHistory.remove(id);
+    m_db->removeHistory(id);
+    // Later history pages are read by offset.
+    --m_historyLoaded;
+    emit historyEntryRemoved(id);
+    updateSelectionButtons();
+}
+
 DownloadManager::~DownloadManager(){
     m_storageThread->quit();
     m_storageThread->wait();
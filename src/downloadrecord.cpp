@@ -1,8 +1,47 @@
 #include "../headers/downloadrecord.h"
 
-DownloadRecord::DownloadRecord(QObject* parent) : QObject(parent) {}
+#include <QHash>
+
+static const QStringList &statusNames(){
+    static const QStringList names = {
+        "downloading", "resumed", "resumed_in_downloading", "start_new_task", "resumed_in_pending",
+        "pending", "prepared", "preparing", "paused", "paused_new", "paused_resume",
+        "completed", "error", "cancelled", "deleted"
+    };
+    return names;
+}
+
+static int pendingCode(){
+    static const int code = statusNames().indexOf("pending");
+    return code;
+}
+
+int DownloadRecord::statusCode(const QString& status){
+    static const QHash<QString, int> codes = [](){
+        QHash<QString, int> codes;
+        for (int i = 0; i < statusNames().size(); ++i) codes.insert(statusNames()[i], i);
+        return codes;
+    }();
+    return codes.value(status, pendingCode());
+}
+
+QString DownloadRecord::statusName(int code){
+    if (code < 0 || code >= statusNames().size()) return "pending";
+    return statusNames()[code];
+}
+
+int DownloadRecord::statusCount(){
+    return statusNames().size();
+}
+
+int DownloadRecord::validStatusCode(int code){
+    return code >= 0 && code < statusNames().size() ? code : pendingCode();
+}
+
+DownloadRecord::DownloadRecord(QObject* parent) : QObject(parent), m_status(pendingCode()) {}
 
 DownloadRecord::DownloadRecord(const DownloadRecord& record){
+    m_uuid = record.m_uuid;
     m_name = record.m_name;
     m_url = record.m_url;
     m_status = record.m_status;
@@ -10,17 +49,28 @@ DownloadRecord::DownloadRecord(const DownloadRecord& record){
 
     m_totalBytes = record.m_totalBytes;
     m_downloadedBytes = record.m_downloadedBytes;
+    m_chunkSize = record.m_chunkSize;
+    m_queuePosition = record.m_queuePosition;
+    m_quantityOfChunks = record.m_quantityOfChunks;
 
     m_expectedHash = record.m_expectedHash;
     m_actualHash = record.m_actualHash;
     m_hashAlgorithm = record.m_hashAlgorithm;
     m_chunkHashes = record.m_chunkHashes;
+    m_pieceHashes = record.m_pieceHashes;
+    m_chunkBitmap = record.m_chunkBitmap;
+    m_etag = record.m_etag;
+    m_lastModified = record.m_lastModified;
+    m_mirrors = record.m_mirrors;
+    m_decompress = record.m_decompress;
+    m_decodeFormat = record.m_decodeFormat;
 
     m_createdAt = record.m_createdAt;
 
 }
 
 DownloadRecord& DownloadRecord::operator=(const DownloadRecord& record){
+    m_uuid = record.m_uuid;
     m_name = record.m_name;
     m_url = record.m_url;
     m_filePath = record.m_filePath;
@@ -28,6 +78,21 @@ DownloadRecord& DownloadRecord::operator=(const DownloadRecord& record){
 
     m_totalBytes = record.m_totalBytes;
     m_downloadedBytes = record.m_downloadedBytes;
+    m_chunkSize = record.m_chunkSize;
+    m_queuePosition = record.m_queuePosition;
+    m_quantityOfChunks = record.m_quantityOfChunks;
+
+    m_expectedHash = record.m_expectedHash;
+    m_actualHash = record.m_actualHash;
+    m_hashAlgorithm = record.m_hashAlgorithm;
+    m_chunkHashes = record.m_chunkHashes;
+    m_pieceHashes = record.m_pieceHashes;
+    m_chunkBitmap = record.m_chunkBitmap;
+    m_etag = record.m_etag;
+    m_lastModified = record.m_lastModified;
+    m_mirrors = record.m_mirrors;
+    m_decompress = record.m_decompress;
+    m_decodeFormat = record.m_decodeFormat;
 
     m_createdAt = record.m_createdAt;
 
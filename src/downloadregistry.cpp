@@ -1,39 +1,126 @@
 #include "../headers/downloadregistry.h"
 
+DownloadRegistry::Entry::Entry(DownloadTypes::DownloadRecord&& fields) :
+    received(fields.downloadedBytes),
+    total(fields.totalBytes),
+    status(static_cast<int>(fields.status))
+{
+    record = std::make_shared<const DownloadTypes::DownloadRecord>(std::move(fields));
+}
+
+DownloadTypes::DownloadRecord DownloadRegistry::Entry::toRecord(const DownloadTypes::DownloadRecord &fields) const{
+    DownloadTypes::DownloadRecord result = fields;
+    result.downloadedBytes = received.load(std::memory_order_relaxed);
+    result.totalBytes = total.load(std::memory_order_relaxed);
+    result.status = static_cast<DownloadTypes::DownloadStatus>(status.load(std::memory_order_relaxed));
+    return result;
+}
+
 DownloadRegistry::DownloadRegistry(QObject *parent): QObject(parent) {}
 
+DownloadRegistry::Shard& DownloadRegistry::shardFor(const QUuid &id){
+    return m_shards[qHash(id) % SHARD_COUNT];
+}
+
+const DownloadRegistry::Shard& DownloadRegistry::shardFor(const QUuid &id) const{
+    return m_shards[qHash(id) % SHARD_COUNT];
+}
+
+std::shared_ptr<DownloadRegistry::Entry> DownloadRegistry::find(const QUuid &id) const{
+    const Shard &shard = shardFor(id);
+    QReadLocker locker(&shard.lock);
+    return shard.entries.value(id);
+}
+
 QUuid DownloadRegistry::addRecord(DownloadTypes::DownloadRecord&& record){
-    QMutexLocker locker(&m_mutex);
-    QUuid id = QUuid::createUuid();
-    m_records[id] = std::move(record);
+    QUuid id = record.id.isNull() ? QUuid::createUuid() : record.id;
+    record.id = id;
+    auto entry = std::make_shared<Entry>(std::move(record));
+
+    Shard &shard = shardFor(id);
+    QWriteLocker locker(&shard.lock);
+    shard.entries.insert(id, std::move(entry));
     return id;
 }
 
+bool DownloadRegistry::removeRecord(QUuid id){
+    Shard &shard = shardFor(id);
+    QWriteLocker locker(&shard.lock);
+    return shard.entries.remove(id) > 0;
+}
+
 void DownloadRegistry::updateProgress(QUuid id, qint64 received, qint64 total){
-    QMutexLocker locker(&m_mutex);
-    if (m_records.contains(id)) {
-        auto &record = m_records[id];
-        record.downloadedBytes = received;
-        record.totalBytes = total;
-        emit progressChanged(id, received, total);
-    }
+    std::shared_ptr<Entry> entry = find(id);
+    if(!entry) return;
+
+    entry->received.store(received, std::memory_order_relaxed);
+    entry->total.store(total, std::memory_order_relaxed);
+    emit progressChanged(id, received, total);
 }
 
 void DownloadRegistry::updateStatus(QUuid id, DownloadTypes::DownloadStatus status){
-    QMutexLocker locker(&m_mutex);
-    if(m_records.contains(id)){
-        auto &record = m_records[id];
-        record.status = status;
-        emit statusChanged(id, status);
-    }
+    std::shared_ptr<Entry> entry = find(id);
+    if(!entry) return;
+
+    entry->status.store(static_cast<int>(status), std::memory_order_relaxed);
+    emit statusChanged(id, status);
 }
 
 DownloadTypes::DownloadRecord DownloadRegistry::getRecord(QUuid id) const{
-    QMutexLocker locker(&m_mutex);
-    return m_records.value(id);
+    const Shard &shard = shardFor(id);
+    std::shared_ptr<Entry> entry;
+    std::shared_ptr<const DownloadTypes::DownloadRecord> fields;
+    {
+        QReadLocker locker(&shard.lock);
+        entry = shard.entries.value(id);
+        if(entry) fields = entry->record;
+    }
+    return entry ? entry->toRecord(*fields) : DownloadTypes::DownloadRecord();
+}
+
+QUuid DownloadRegistry::findByUrl(const QString &url) const{
+    for(const Shard &shard : m_shards){
+        QReadLocker locker(&shard.lock);
+        for(auto it = shard.entries.cbegin(); it != shard.entries.cend(); ++it){
+            if(it.value()->record->url == url) return it.key();
+        }
+    }
+    return QUuid();
 }
 
+// Only shared pointers are copied under the locks; the records are
+// assembled afterwards.
 QList<DownloadTypes::DownloadRecord> DownloadRegistry::getAllRecords() const {
-    QMutexLocker locker(&m_mutex);
-    return m_records.values();
+    QVector<QPair<std::shared_ptr<Entry>, std::shared_ptr<const DownloadTypes::DownloadRecord>>> entries;
+    for(const Shard &shard : m_shards){
+        QReadLocker locker(&shard.lock);
+        for(const auto &entry : shard.entries){
+            entries.append({entry, entry->record});
+        }
+    }
+
+    QList<DownloadTypes::DownloadRecord> records;
+    records.reserve(entries.size());
+    for(const auto &pair : std::as_const(entries)){
+        records.append(pair.first->toRecord(*pair.second));
+    }
+    return records;
+}
+
+QVector<DownloadRegistry::Progress> DownloadRegistry::snapshot() const{
+    QVector<Progress> progress;
+    for(const Shard &shard : m_shards){
+        QReadLocker locker(&shard.lock);
+        progress.reserve(progress.size() + shard.entries.size());
+        for(auto it = shard.entries.cbegin(); it != shard.entries.cend(); ++it){
+            const Entry &entry = *it.value();
+            Progress item;
+            item.id = it.key();
+            item.received = entry.received.load(std::memory_order_relaxed);
+            item.total = entry.total.load(std::memory_order_relaxed);
+            item.status = static_cast<DownloadTypes::DownloadStatus>(entry.status.load(std::memory_order_relaxed));
+            progress.append(item);
+        }
+    }
+    return progress;
 }
@@ -6,11 +6,27 @@ DownloadTask::DownloadTask(const QString& url, DownloadTypes::DownloadRecord fil
                                                                     m_fileInfo(fileInfo),
                                                                     m_resumeDownloadPos(0)
 {
+    m_etag = fileInfo.etag;
+    m_lastModified = fileInfo.lastModified;
+
     m_timeoutTimer = new QTimer(this);
     m_timeoutTimer->setSingleShot(true);
 
+    m_segmentWatchdog = new QTimer(this);
+    m_segmentWatchdog->setInterval(WATCHDOG_INTERVAL_MS);
+
+    setMirrors(fileInfo.mirrors);
+    if(m_fileInfo.totalBytes > 0){
+        m_savedChunks.resize(lastChunkIndex() + 1);
+    }
+
     m_chunkProcessor = new ChunkProcessor(this);
+    m_chunkProcessor->setChunkSize(m_fileInfo.chunkSize);
     m_networkManager = new NetworkManager(this);
+    m_networkManager->setChunkProcessor(m_chunkProcessor);
+    if(m_fileInfo.decompress){
+        m_networkManager->setAcceptEncoding(StreamDecoder::acceptEncoding());
+    }
 
     setUpConnections();
 
@@ -20,17 +36,28 @@ DownloadTask::DownloadTask(const QString& url, DownloadTypes::DownloadRecord fil
         }
     }, Qt::SingleShotConnection);
 
-    startHashDiscovery();
+    if(!fileInfo.expectedHash.isEmpty()){
+        m_remoteExpectedHash = fileInfo.expectedHash;
+        QMetaObject::invokeMethod(this, &DownloadTask::start, Qt::QueuedConnection);
+    }else{
+        startHashDiscovery();
+    }
 }
 
 void DownloadTask::setUpConnections(){
-    connect(m_networkManager, &NetworkManager::dataReceived, m_chunkProcessor, &ChunkProcessor::processData, Qt::QueuedConnection);
-    connect(m_networkManager, &NetworkManager::downloadProgress, this, &DownloadTask::onDownloadProgress, Qt::QueuedConnection);
+    connect(m_networkManager, &NetworkManager::downloadProgress, this, &DownloadTask::onDownloadProgress, Qt::DirectConnection);
+    connect(m_networkManager, &NetworkManager::finished, this, &DownloadTask::onTransferFinished, Qt::DirectConnection);
+    connect(m_chunkProcessor, &ChunkProcessor::chunkReady, this, &DownloadTask::saveAndWriteChunckHash, Qt::DirectConnection);
+    connect(m_networkManager, &NetworkManager::validatorsReceived, this, &DownloadTask::onValidatorsReceived, Qt::DirectConnection);
+    connect(m_networkManager, &NetworkManager::rangeIgnored, this, &DownloadTask::onRangeIgnored, Qt::DirectConnection);
+    connect(m_networkManager, &NetworkManager::encodingReceived, this, &DownloadTask::onEncodingReceived, Qt::DirectConnection);
+    connect(m_chunkProcessor, &ChunkProcessor::decodeFailed, this, &DownloadTask::onDecodeFailed, Qt::QueuedConnection);
+
+    // Error handling aborts the reply, so it must not run inside the reply's own signal.
     connect(m_networkManager, &NetworkManager::errorOccurred, this, &DownloadTask::onNetworkError, Qt::QueuedConnection);
-    connect(m_networkManager, &NetworkManager::finished, m_chunkProcessor, &ChunkProcessor::finalize, Qt::QueuedConnection);
-    connect(m_chunkProcessor, &ChunkProcessor::chunkReady, this, &DownloadTask::saveAndWriteChunckHash, Qt::QueuedConnection);
 
     connect(m_timeoutTimer, &QTimer::timeout, this, &DownloadTask::onTimeout);
+    connect(m_segmentWatchdog, &QTimer::timeout, this, &DownloadTask::checkSegments);
 }
 
 void DownloadTask::updateFromDb(const DownloadRecord &record){
@@ -38,6 +65,8 @@ void DownloadTask::updateFromDb(const DownloadRecord &record){
 
     m_remoteExpectedHash = record.m_expectedHash;
     m_actualHash = record.m_actualHash;
+    m_etag = record.m_etag;
+    m_lastModified = record.m_lastModified;
     //!!!
     if(record.m_hashAlgorithm == "md5"){
         //m_activeAlgorithm = QCryptographicHash::Md5;
@@ -50,34 +79,102 @@ void DownloadTask::updateFromDb(const DownloadRecord &record){
     QDataStream in(&chunkData, QIODevice::ReadOnly);
     in >> m_chunkHashes;
 
-    QString status = record.m_status;
-    if (record.m_status == "pending") m_status = DownloadTask::Pending;
-    if (record.m_status == "downloading") m_status = DownloadTask::Downloading;
-    if (record.m_status == "resumed") m_status = DownloadTask::Resumed;
-    if (record.m_status == "start_new_task") m_status = DownloadTask::StartNewTask;
-    if (record.m_status == "resumed_in_pending") m_status = DownloadTask::ResumedInPending;
-    if (record.m_status == "resumed_in_downloading") m_status = DownloadTask::ResumedInDownloading;
-    if (record.m_status == "paused") m_status = DownloadTask::Paused;
-    if (record.m_status == "paused_new") m_status = DownloadTask::PausedNew;
-    if (record.m_status == "paused_resume") m_status = DownloadTask::PausedResume;
-    if (record.m_status == "completed") m_status = DownloadTask::Completed;
-    if (record.m_status == "error") m_status = DownloadTask::Error;
-    if (record.m_status == "cancelled") m_status = DownloadTask::Cancelled;
-    if (record.m_status == "deleted") m_status = DownloadTask::Deleted;
-    if (record.m_status == "preparing") m_status = DownloadTask::Preparing;
-    if (record.m_status == "prepared") m_status = DownloadTask::Prepared;
+    if(!record.m_pieceHashes.isEmpty()){
+        QDataStream pieces(record.m_pieceHashes);
+        pieces >> m_expectedChunkHashes;
+    }
+
+    ChunkBitmap saved = ChunkBitmap::fromRle(record.m_chunkBitmap);
+    if(!saved.isEmpty()){
+        m_savedChunks = saved;
+        m_resumeDownloadPos = savedPrefixBytes();
+    }else{
+        // Rows written before the bitmap existed only have a sequential offset.
+        for(int i = 0; i < m_resumeDownloadPos / m_fileInfo.chunkSize; ++i) m_savedChunks.set(i);
+    }
+
+    m_status = statusFromCode(record.m_status, m_status);
 
 }
 
 void DownloadTask::saveAndWriteChunckHash(int index, const QByteArray &data, const QByteArray &hash){
     m_timeoutTimer->start(m_timeoutSeconds * 1000);
     if(!hash.isEmpty()){
-        m_chunkHashes.append(hash);
+        if(!matchesReference(index, hash)){
+            qDebug() << "Chunk" << index << "does not match the reference hash";
+            QMetaObject::invokeMethod(this, [this, index](){ restartFromChunk(index); }, Qt::QueuedConnection);
+            return;
+        }
+
+        storeChunkHash(index, hash);
 
         emit writeChunk(m_fileInfo, index, data);
     }
 }
 
+void DownloadTask::storeChunkHash(int index, const QByteArray &hash){
+    if(m_chunkHashes.size() <= index){
+        m_chunkHashes.resize(index + 1);
+    }
+    m_chunkHashes[index] = hash;
+}
+
+bool DownloadTask::matchesReference(int index, const QByteArray &hash) const{
+    return index >= m_expectedChunkHashes.size() || m_expectedChunkHashes[index].isEmpty()
+           || m_expectedChunkHashes[index] == hash;
+}
+
+void DownloadTask::restartFromChunk(int index){
+    if(m_multiSource || m_status == Status::Paused || m_status == Status::PausedResume
+        || m_status == Status::PausedNew || m_status == Status::Pending) return;
+
+    m_networkManager->abort();
+    m_resumeDownloadPos = static_cast<qint64>(index) * m_fileInfo.chunkSize;
+    if(m_chunkHashes.size() > index){
+        m_chunkHashes.resize(index);
+    }
+    emit stopWrite(m_fileInfo);
+
+    handleFailure("Chunk verification failed", true);
+}
+
+void DownloadTask::onTransferFinished(){
+    m_chunkProcessor->finalize();
+    flushProgress();
+
+    StreamDecoder *decoder = m_chunkProcessor->decoder();
+    if(decoder && decoder->hasError()) return;
+
+    // The file was preallocated to the compressed size; cut it to what was decoded.
+    emit finishWrite(m_fileInfo, decoder ? decoder->decodedBytes() : -1);
+}
+
+// Decodes Content-Encoding, or the .gz/.zst/.xz payload whose suffix was
+// stripped from the saved name.
+void DownloadTask::onEncodingReceived(const QString &contentEncoding){
+    if(!m_fileInfo.decompress) return;
+
+    StreamDecoder::Format format = StreamDecoder::formatForEncoding(contentEncoding);
+    m_decodingTransport = format != StreamDecoder::None;
+    if(!m_decodingTransport){
+        format = StreamDecoder::Format(m_fileInfo.decodeFormat);
+    }
+
+    if(StreamDecoder::isSupported(format)){
+        m_chunkProcessor->setDecoder(std::make_unique<StreamDecoder>(format, m_activeAlgorithm));
+    }else{
+        m_chunkProcessor->setDecoder(nullptr);
+    }
+}
+
+void DownloadTask::onDecodeFailed(){
+    if(m_status == Status::Error || m_status == Status::Completed) return;
+
+    qDebug() << "Compressed stream is corrupt or truncated";
+    syncAndStop();
+    handleFailure("Decompression failed", false);
+}
+
 void DownloadTask::setStatus(Status newStatus){
     if(newStatus != m_status){
         m_status = newStatus;
@@ -87,13 +184,157 @@ void DownloadTask::setStatus(Status newStatus){
 
 void DownloadTask::startDownload(){
     if(m_status == Status::Prepared){
-        m_networkManager->startDownload(m_url);
+        if(!m_cachedSource.isEmpty()){
+            emit materializeFromCache(m_fileInfo, m_cachedSource);
+        }else{
+            beginTransfer();
+        }
         setStatus(Status::Downloading);
     }else{
         QTimer::singleShot(200, this, &DownloadTask::startDownload);
     }
 }
 
+void DownloadTask::beginTransfer(){
+    if(useMirrors() && !m_prefetchComplete){
+        // Segments write whole chunks straight to storage; a partial tail left
+        // in the chunk processor by the probe would never be flushed.
+        m_prefetched.clear();
+        startSegments(0);
+        return;
+    }
+
+    consumePrefetched();
+    if(m_prefetchComplete){
+        onTransferFinished();
+    }else{
+        m_networkManager->startDownload(m_url, m_resumeDownloadPos, ifRangeValidator());
+    }
+}
+
+void DownloadTask::setCachedSource(const QString &path){
+    m_cachedSource = path;
+}
+
+void DownloadTask::onMaterializeFailed(const DownloadTypes::DownloadRecord &fileInfo){
+    if(fileInfo != m_fileInfo) return;
+
+    qDebug() << "Cached copy unusable, downloading" << m_url;
+    m_cachedSource.clear();
+    emit openFile(m_fileInfo, 0);
+    beginTransfer();
+}
+
+// Only content whose hash is known to be right (or that carries a strong
+// ETag) is worth keeping; decoded downloads differ from what the URL serves.
+void DownloadTask::offerToCache(const QString &verifiedHash){
+    if(m_fileInfo.decompress) return;
+    if(verifiedHash.isEmpty() && m_etag.isEmpty()) return;
+
+    emit cacheFile(m_fileInfo, m_url, m_etag, verifiedHash);
+}
+
+// Names tie Status to the persisted codes of DownloadRecord; they are only
+// looked up while the code tables are built. FileIntegrityCheck is transient
+// and saved as pending.
+static const QHash<QString, DownloadTask::Status> &statusesByName(){
+    static const QHash<QString, DownloadTask::Status> statuses = {
+        {"pending", DownloadTask::Pending},
+        {"downloading", DownloadTask::Downloading},
+        {"resumed", DownloadTask::Resumed},
+        {"start_new_task", DownloadTask::StartNewTask},
+        {"resumed_in_pending", DownloadTask::ResumedInPending},
+        {"resumed_in_downloading", DownloadTask::ResumedInDownloading},
+        {"paused", DownloadTask::Paused},
+        {"paused_new", DownloadTask::PausedNew},
+        {"paused_resume", DownloadTask::PausedResume},
+        {"completed", DownloadTask::Completed},
+        {"error", DownloadTask::Error},
+        {"cancelled", DownloadTask::Cancelled},
+        {"deleted", DownloadTask::Deleted},
+        {"preparing", DownloadTask::Preparing},
+        {"prepared", DownloadTask::Prepared}
+    };
+    return statuses;
+}
+
+DownloadTask::Status DownloadTask::statusFromCode(int code, Status fallback){
+    static const QVector<int> statuses = [](){
+        QVector<int> statuses(DownloadRecord::statusCount(), -1);
+        for(auto it = statusesByName().begin(); it != statusesByName().end(); ++it){
+            statuses[DownloadRecord::statusCode(it.key())] = it.value();
+        }
+        return statuses;
+    }();
+    int status = statuses.value(code, -1);
+    return status < 0 ? fallback : Status(status);
+}
+
+int DownloadTask::statusCode(Status status){
+    static const QVector<int> codes = [](){
+        QVector<int> codes(Deleted + 1, DownloadRecord::statusCode("pending"));
+        for(auto it = statusesByName().begin(); it != statusesByName().end(); ++it){
+            codes[it.value()] = DownloadRecord::statusCode(it.key());
+        }
+        return codes;
+    }();
+    return codes.value(status, DownloadRecord::statusCode("pending"));
+}
+
+// The registry stores the shared status type; every task status has its own
+// value there, so a status survives the round trip unchanged.
+DownloadTypes::DownloadStatus DownloadTask::toDownloadStatus(Status status){
+    using DownloadTypes::DownloadStatus;
+    switch(status){
+    case FileIntegrityCheck: return DownloadStatus::FileIntegrityCheck;
+    case Preparing: return DownloadStatus::Preparing;
+    case Prepared: return DownloadStatus::Ready;
+    case Pending: return DownloadStatus::Pending;
+    case Downloading: return DownloadStatus::Downloading;
+    case Resumed: return DownloadStatus::Resumed;
+    case StartNewTask: return DownloadStatus::StartNewTask;
+    case ResumedInPending: return DownloadStatus::ResumedInPending;
+    case ResumedInDownloading: return DownloadStatus::ResumedInDownloading;
+    case Paused: return DownloadStatus::Paused;
+    case PausedNew: return DownloadStatus::PausedNew;
+    case PausedResume: return DownloadStatus::PausedResume;
+    case Completed: return DownloadStatus::Completed;
+    case Error: return DownloadStatus::Error;
+    case Cancelled: return DownloadStatus::Cancelled;
+    case Deleted: return DownloadStatus::Deleted;
+    }
+    return DownloadStatus::Pending;
+}
+
+DownloadTask::Status DownloadTask::fromDownloadStatus(DownloadTypes::DownloadStatus status){
+    using DownloadTypes::DownloadStatus;
+    switch(status){
+    case DownloadStatus::FileIntegrityCheck: return FileIntegrityCheck;
+    case DownloadStatus::Preparing: return Preparing;
+    case DownloadStatus::Ready: return Prepared;
+    case DownloadStatus::Pending: return Pending;
+    case DownloadStatus::Downloading: return Downloading;
+    case DownloadStatus::Resumed: return Resumed;
+    case DownloadStatus::StartNewTask: return StartNewTask;
+    case DownloadStatus::ResumedInPending: return ResumedInPending;
+    case DownloadStatus::ResumedInDownloading: return ResumedInDownloading;
+    case DownloadStatus::Paused: return Paused;
+    case DownloadStatus::PausedNew: return PausedNew;
+    case DownloadStatus::PausedResume: return PausedResume;
+    case DownloadStatus::Completed: return Completed;
+    case DownloadStatus::Error: return Error;
+    case DownloadStatus::Cancelled: return Cancelled;
+    case DownloadStatus::Deleted: return Deleted;
+    }
+    return Pending;
+}
+
+QString DownloadTask::getOrigin() const
+{
+    QUrl url(m_url);
+    return url.adjusted(QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment | QUrl::RemoveUserInfo).toString();
+}
+
 void DownloadTask::startHashDiscovery()
 {
     m_hashCandidates.clear();
@@ -121,16 +362,15 @@ void DownloadTask::tryNextHashCandidate()
         return;
     }
 
-    QNetworkAccessManager *manager = new QNetworkAccessManager(this);
     QString candidate = m_hashCandidates.takeFirst();
     QNetworkRequest request((QUrl(candidate)));
 
     request.setHeader(QNetworkRequest::UserAgentHeader, "Mozilla/5.0");
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
 
-    QNetworkReply* reply = manager->get(request);
+    QNetworkReply* reply = NetworkSession::manager()->get(request);
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, candidate, manager]() {
+    connect(reply, &QNetworkReply::finished, this, [this, reply, candidate]() {
         if (reply->error() == QNetworkReply::NoError) {
             parseHashContent(reply->readAll(), candidate);
             reply->deleteLater();
@@ -145,7 +385,6 @@ void DownloadTask::tryNextHashCandidate()
             reply->deleteLater();
             tryNextHashCandidate();
         }
-        manager->deleteLater();
     });
 }
 
@@ -184,7 +423,21 @@ void DownloadTask::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal){
 
     m_timeToRetry = 1;
 
-    emit progressChanged(bytesReceived + m_resumeDownloadPos, bytesTotal + m_resumeDownloadPos);
+    publishProgress(bytesReceived + m_resumeDownloadPos, bytesTotal + m_resumeDownloadPos);
+}
+
+void DownloadTask::publishProgress(qint64 bytesReceived, qint64 bytesTotal){
+    if(!m_progressThrottle.shouldPublish(bytesReceived, bytesTotal)) return;
+
+    emit progressChanged(bytesReceived, bytesTotal);
+}
+
+void DownloadTask::flushProgress(){
+    qint64 bytesReceived = 0;
+    qint64 bytesTotal = 0;
+    if(!m_progressThrottle.takePending(bytesReceived, bytesTotal)) return;
+
+    emit progressChanged(bytesReceived, bytesTotal);
 }
 
 void DownloadTask::measureSpeed(qint64 bytesReceived){
@@ -246,13 +499,32 @@ void DownloadTask::onFinished(const DownloadTypes::DownloadRecord &fileInfo){
 
     qDebug() << "123456789";
 
-    if(fileInfo == m_fileInfo){
+    if(fileInfo == m_fileInfo && !m_cachedSource.isEmpty()){
+        // The cached object was verified when it was stored.
+        qDebug() << "✅ restored from cache:" << m_fileInfo.filePath;
+        setStatus(Status::Completed);
+    }else if(fileInfo == m_fileInfo){
+        flushProgress();
+        qDebug() << "Progress reports published:" << m_progressThrottle.publishedCount()
+                 << "suppressed:" << m_progressThrottle.suppressedCount();
         setStatus(Status::FileIntegrityCheck);
         m_networkManager->abort();
 
         m_timeoutTimer->stop();
 
-        if(!m_remoteExpectedHash.isEmpty()){
+        StreamDecoder *decoder = m_chunkProcessor->decoder();
+        if(!m_remoteExpectedHash.isEmpty() && decoder){
+            // Hashed while streaming: a .gz target is published with the hash of
+            // the archive, a Content-Encoding body with that of the decoded file.
+            QString localHash = m_decodingTransport ? decoder->decodedHash() : decoder->compressedHash();
+            qDebug() << "localHash: " << localHash;
+            qDebug() << "m_remoteExpectedHash: " << m_remoteExpectedHash;
+
+            bool isOk = (localHash == m_remoteExpectedHash);
+            setStatus(Status::Completed);
+            qDebug() << (isOk ? "✅ file propely" : "❌ file corupted!");
+            if(isOk && !m_decodingTransport) offerToCache(m_activeAlgorithm == QCryptographicHash::Sha256 ? localHash : QString());
+        }else if(!m_remoteExpectedHash.isEmpty()){
             QFile file(m_fileInfo.filePath);
             if (!file.open(QIODevice::ReadOnly)) return;
 
@@ -269,10 +541,12 @@ void DownloadTask::onFinished(const DownloadTypes::DownloadRecord &fileInfo){
             bool isOk = (localHash == m_remoteExpectedHash);
             setStatus(Status::Completed);
             qDebug() << (isOk ? "✅ file propely" : "❌ file corupted!");
+            if(isOk) offerToCache(m_activeAlgorithm == QCryptographicHash::Sha256 ? localHash : QString());
         }else{
             connect(this, &DownloadTask::checkFinished, this, [=](bool isCorrupted){
                 qDebug() << (!isCorrupted ? "✅ file propely" : "❌ file corupted!");
                 setStatus(Status::Completed);
+                if(!isCorrupted) offerToCache(QString());
             }, Qt::SingleShotConnection);
 
             verifyHashOfFile();
@@ -295,26 +569,65 @@ void DownloadTask::pauseDownload(){
 void DownloadTask::resumeDownload(){
 
     connect(this, &DownloadTask::checkFinished, this, [=](bool isCorrupted){
-        if(isCorrupted){
-            m_resumeDownloadPos = 0;
-
+        // A decoder cannot pick up mid-stream, so decompressing downloads start over.
+        if(isCorrupted || m_fileInfo.decompress){
             syncAndStop();
 
+            m_resumeDownloadPos = 0;
             m_chunkHashes.clear();
+            m_savedChunks.clear();
             emit clearFile(m_fileInfo);
-            qDebug() << "- The existing chunks have been checked. File corrupted";
+            qDebug() << (isCorrupted ? "- The existing chunks have been checked. File corrupted"
+                                     : "- Decompressing download restarts from the beginning");
         }else{
             qDebug() << "+ The existing chunks have been checked. Let's continue...";
+            if(!m_savedChunks.isEmpty()) m_resumeDownloadPos = savedPrefixBytes();
+        }
+
+        if(m_savedChunks.isComplete()){
+            emit openFile(m_fileInfo, m_resumeDownloadPos);
+            emit finishWrite(m_fileInfo, -1);
+            return;
         }
 
-        m_chunkProcessor->reset(m_resumeDownloadPos / (1024 * 1024));
-        m_networkManager->startDownload(m_url, m_resumeDownloadPos);
+        if(useMirrors()){
+            startSegments(m_resumeDownloadPos / m_fileInfo.chunkSize);
+        }else{
+            m_multiSource = false;
+            m_chunkProcessor->reset(m_resumeDownloadPos / m_fileInfo.chunkSize);
+            m_networkManager->startDownload(m_url, m_resumeDownloadPos, ifRangeValidator());
+        }
         emit openFile(m_fileInfo, m_resumeDownloadPos);
     }, Qt::SingleShotConnection);
 
     verifyHashOfFile();
 }
 
+QString DownloadTask::ifRangeValidator() const{
+    // If-Range only accepts strong entity tags.
+    if(!m_etag.isEmpty() && !m_etag.startsWith("W/")){
+        return m_etag;
+    }
+    return m_lastModified;
+}
+
+void DownloadTask::onValidatorsReceived(const QString &etag, const QString &lastModified){
+    if(!etag.isEmpty()) m_etag = etag;
+    if(!lastModified.isEmpty()) m_lastModified = lastModified;
+}
+
+void DownloadTask::onRangeIgnored(){
+    qDebug() << "Remote file changed or range not honoured. Restarting from the beginning...";
+
+    m_resumeDownloadPos = 0;
+    m_chunkHashes.clear();
+    m_savedChunks.clear();
+    m_chunkProcessor->reset(0);
+
+    emit clearFile(m_fileInfo);
+    emit openFile(m_fileInfo, 0);
+}
+
 bool DownloadTask::isRetryableError(QNetworkReply::NetworkError error){
     return (error == QNetworkReply::ConnectionRefusedError ||
             error == QNetworkReply::RemoteHostClosedError ||
@@ -373,32 +686,255 @@ void DownloadTask::scheduleRetry(const QString& error){
 }
 
 void DownloadTask::syncAndStop() {
+    flushProgress();
+
+    if(m_multiSource){
+        stopSegments();
+
+        // Hashes past the gap are kept: the saved-chunk bitmap tells the
+        // resume which of those chunks need no second download.
+        int index = m_receivedChunks.firstMissing(m_segmentsFirstChunk);
+        m_resumeDownloadPos = qMin(static_cast<qint64>(index) * m_fileInfo.chunkSize, m_fileInfo.totalBytes);
+
+        emit stopWrite(m_fileInfo);
+        return;
+    }
+
     m_networkManager->abort();
-    m_resumeDownloadPos = static_cast<qint64>(m_chunkProcessor->getCurrentIndex()) * 1024 * 1024;
+    m_resumeDownloadPos = static_cast<qint64>(m_chunkProcessor->getCurrentIndex()) * m_fileInfo.chunkSize;
     m_chunkProcessor->reset(m_chunkProcessor->getCurrentIndex());
     emit stopWrite(m_fileInfo);
 }
 
+// Only chunks confirmed on disk are checked, each at its own offset, so
+// chunks saved past a gap survive the resume.
 void DownloadTask::verifyHashOfFile(){
-    if (m_chunkHashes.isEmpty() || m_resumeDownloadPos == 0) emit checkFinished(false);
+    if(m_chunkHashes.isEmpty()){
+        emit checkFinished(false);
+        return;
+    }
 
     QFile file(m_fileInfo.filePath);
-    if (!file.open(QIODevice::ReadOnly)) emit checkFinished(true);
+    if(!file.open(QIODevice::ReadOnly)){
+        emit checkFinished(true);
+        return;
+    }
+
+    for(int i = 0; i < m_chunkHashes.size(); ++i){
+        if(m_chunkHashes[i].isEmpty()) continue;
 
-    for (int i = 0; i < m_chunkHashes.size(); ++i) {
-        QByteArray chunkData = file.read(1024 * 1024);
+        qint64 offset = static_cast<qint64>(i) * m_fileInfo.chunkSize;
+        bool saved = m_savedChunks.isEmpty() ? offset < m_resumeDownloadPos : m_savedChunks.test(i);
+        if(!saved) continue;
+
+        QByteArray chunkData;
+        if(file.seek(offset)) chunkData = file.read(m_fileInfo.chunkSize);
         QByteArray currentHash = QCryptographicHash::hash(chunkData, m_activeAlgorithm).toHex();
 
-        if (currentHash != m_chunkHashes[i]) {
+        if(chunkData.isEmpty() || currentHash != m_chunkHashes[i]){
             emit checkFinished(true);
+            return;
         }
     }
     emit checkFinished(false);
 }
 
-void DownloadTask::changeQuantityOfChunks(const DownloadTypes::DownloadRecord &fileInfo, qint64 valueOfChange){
-    if(m_fileInfo == fileInfo){
-        m_fileInfo.quantityOfChunks += valueOfChange;
+void DownloadTask::onChunksSaved(const DownloadTypes::DownloadRecord &fileInfo, const QVector<int> &indices){
+    if(fileInfo != m_fileInfo) return;
+
+    for(int index : indices){
+        m_savedChunks.set(index);
+    }
+}
+
+qint64 DownloadTask::savedPrefixBytes() const{
+    qint64 bytes = static_cast<qint64>(m_savedChunks.firstMissing()) * m_fileInfo.chunkSize;
+    return m_fileInfo.totalBytes > 0 ? qMin(bytes, m_fileInfo.totalBytes) : bytes;
+}
+
+void DownloadTask::setMirrors(const QStringList &mirrors){
+    m_mirrors = mirrors;
+    m_mirrorScheduler.setMirrors(QStringList(m_url) + mirrors);
+}
+
+void DownloadTask::setExpectedChunkHashes(const QVector<QByteArray> &hashes){
+    m_expectedChunkHashes = hashes;
+}
+
+void DownloadTask::setPrefetchedData(const QByteArray &data, bool complete){
+    m_prefetched = data;
+    m_prefetchComplete = complete;
+}
+
+// Feeds the probe's bytes through the chunk pipeline; the network continues
+// from where they end.
+void DownloadTask::consumePrefetched(){
+    QByteArray data = std::exchange(m_prefetched, QByteArray());
+    if(data.isEmpty()) return;
+
+    m_chunkProcessor->processData(data);
+    m_resumeDownloadPos = data.size();
+    publishProgress(m_resumeDownloadPos, m_fileInfo.totalBytes);
+}
+
+bool DownloadTask::useMirrors() const{
+    return m_mirrorScheduler.activeCount() > 1 && m_fileInfo.totalBytes > 0 && !m_fileInfo.decompress;
+}
+
+int DownloadTask::lastChunkIndex() const{
+    return static_cast<int>((m_fileInfo.totalBytes - 1) / m_fileInfo.chunkSize);
+}
+
+void DownloadTask::startSegments(int firstChunk){
+    stopSegments();
+
+    m_multiSource = true;
+    m_segmentsFirstChunk = firstChunk;
+    m_segmentBytes = 0;
+
+    // Chunks already on disk, or handed to storage from the probe, are skipped.
+    m_receivedChunks = m_savedChunks;
+    m_receivedChunks.resize(lastChunkIndex() + 1);
+    for(int i = 0; i < firstChunk; ++i) m_receivedChunks.set(i);
+    m_segmentBaseBytes = m_receivedChunks.completedBytes(m_fileInfo.chunkSize, m_fileInfo.totalBytes);
+
+    m_segmentWatchdog->start();
+    m_timeoutTimer->start(m_timeoutSeconds * 1000);
+    continueSegments(-1);
+}
+
+void DownloadTask::startSegment(int mirror, int firstChunk, int lastChunk){
+    SegmentDownloader *segment = new SegmentDownloader(mirror, m_mirrorScheduler.url(mirror), firstChunk, lastChunk,
+                                                       m_fileInfo.chunkSize, m_fileInfo.totalBytes, m_activeAlgorithm, this);
+
+    connect(segment, &SegmentDownloader::chunkReady, this, [this, segment](int index, const QByteArray &data, const QByteArray &hash){
+        onSegmentChunk(segment, index, data, hash);
+    }, Qt::DirectConnection);
+    connect(segment, &SegmentDownloader::progress, this, &DownloadTask::onSegmentProgress, Qt::DirectConnection);
+    connect(segment, &SegmentDownloader::finished, this, [this, segment](){
+        onSegmentFinished(segment);
+    }, Qt::QueuedConnection);
+    connect(segment, &SegmentDownloader::failed, this, [this, segment](){
+        onSegmentFailed(segment);
+    }, Qt::QueuedConnection);
+
+    m_segments.append(segment);
+    segment->start();
+}
+
+void DownloadTask::stopSegments(){
+    m_segmentWatchdog->stop();
+    for(SegmentDownloader *segment : m_segments){
+        segment->disconnect(this);
+        segment->abort();
+        segment->deleteLater();
+    }
+    m_segments.clear();
+    m_stalledTicks.clear();
+}
+
+void DownloadTask::onSegmentChunk(SegmentDownloader *segment, int index, const QByteArray &data, const QByteArray &hash){
+    if(!matchesReference(index, hash)){
+        qDebug() << "Chunk" << index << "from" << m_mirrorScheduler.url(segment->mirror()).host() << "does not match the reference hash";
+        segment->rejectChunk(index);
+        return;
+    }
+
+    m_receivedChunks.set(index);
+    saveAndWriteChunckHash(index, data, hash);
+}
+
+void DownloadTask::onSegmentProgress(qint64 bytes){
+    m_segmentBytes += bytes;
+
+    qint64 received = qMin(m_segmentBaseBytes + m_segmentBytes, m_fileInfo.totalBytes);
+    measureSpeed(received);
+    m_timeToRetry = 1;
+
+    publishProgress(received, m_fileInfo.totalBytes);
+}
+
+void DownloadTask::onSegmentFinished(SegmentDownloader *segment){
+    if(!m_segments.removeOne(segment)) return;
+    m_stalledTicks.remove(segment);
+    segment->deleteLater();
+
+    continueSegments(segment->mirror());
+}
+
+void DownloadTask::continueSegments(int mirror){
+    // Work stealing: a mirror that is done takes over the second half of the
+    // biggest range still in flight.
+    SegmentDownloader *busiest = nullptr;
+    for(SegmentDownloader *other : m_segments){
+        if(!busiest || other->remainingChunks() > busiest->remainingChunks()){
+            busiest = other;
+        }
+    }
+
+    if(busiest && busiest->remainingChunks() > 2){
+        int lastChunk = busiest->lastChunk();
+        int splitAt = busiest->nextChunk() + busiest->remainingChunks() / 2;
+        busiest->shrinkTo(splitAt - 1);
+        startSegment(mirror, splitAt, lastChunk);
+        return;
+    }
+
+    if(!m_segments.isEmpty()) return;
+
+    // Nothing in flight: split the next gap between the mirrors.
+    const auto runs = m_receivedChunks.missingRuns(m_segmentsFirstChunk);
+    if(!runs.isEmpty()){
+        const auto segments = m_mirrorScheduler.assign(runs.first().first, runs.first().second);
+        if(segments.isEmpty()){
+            qDebug() << "No usable mirror left";
+            syncAndStop();
+            handleFailure("All mirrors failed", false);
+            return;
+        }
+        for(const auto &segment : segments){
+            startSegment(segment.mirror, segment.firstChunk, segment.lastChunk);
+        }
+        return;
+    }
+
+    m_segmentWatchdog->stop();
+    emit finishWrite(m_fileInfo, -1);
+}
+
+void DownloadTask::onSegmentFailed(SegmentDownloader *segment){
+    if(!m_segments.removeOne(segment)) return;
+    m_stalledTicks.remove(segment);
+    segment->deleteLater();
+
+    m_mirrorScheduler.reportFailure(segment->mirror());
+
+    int mirror = m_mirrorScheduler.bestMirror(segment->mirror());
+    if(mirror < 0){
+        qDebug() << "No usable mirror left";
+        syncAndStop();
+        handleFailure("All mirrors failed", false);
+        return;
+    }
+
+    if(segment->nextChunk() <= segment->lastChunk()){
+        startSegment(mirror, segment->nextChunk(), segment->lastChunk());
+    }else{
+        continueSegments(mirror);
+    }
+}
+
+void DownloadTask::checkSegments(){
+    const auto segments = m_segments;
+    for(SegmentDownloader *segment : segments){
+        qint64 bytes = segment->takeBytesSinceSample();
+        if(bytes > 0){
+            m_stalledTicks[segment] = 0;
+            m_mirrorScheduler.reportThroughput(segment->mirror(), bytes * 1000.0 / WATCHDOG_INTERVAL_MS);
+        }else if(++m_stalledTicks[segment] >= MAX_STALLED_TICKS){
+            qDebug() << "Mirror" << m_mirrorScheduler.url(segment->mirror()).host() << "stalled";
+            segment->fail();
+        }
     }
 }
 
@@ -40,10 +40,12 @@ void MainWindow::setUpUI(){
     m_nameApp = new QLabel("Download Manager");
 
     m_urlInput = new QLineEdit(this);
-    m_urlInput->setPlaceholderText("Enter the link");
+    m_urlInput->setPlaceholderText("Enter the link (mirrors separated by spaces)");
 
     m_downloadButton = new QPushButton("Download");
+    m_decompressCheckBox = new QCheckBox("Decompress .gz/.zst/.xz while downloading");
     m_browseButton = new QPushButton("Select a folder");
+    m_metalinkButton = new QPushButton("Import Metalink");
 
     m_downloadAllItemsBt = new QPushButton("Download All");
     m_pauseAllItemsBt = new QPushButton("Pause All");
@@ -55,17 +57,37 @@ void MainWindow::setUpUI(){
 
     m_hboxLayout = new QHBoxLayout();
 
-    m_listWidget = new QListWidget();
-    m_listWidget->setSelectionMode(QAbstractItemView::NoSelection);
+    m_listModel = new DownloadListModel(this);
+    m_listView = new QListView();
+    m_listView->setModel(m_listModel);
+    m_listView->setItemDelegate(new DownloadItemDelegate(m_listView));
+    m_listView->setSelectionMode(QAbstractItemView::NoSelection);
+    m_listView->setUniformItemSizes(true);
+    m_listView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+
+    m_searchInput = new QLineEdit(this);
+    m_searchInput->setPlaceholderText("Search history by name, URL, path or hash");
+    m_searchInput->setClearButtonEnabled(true);
+
+    m_searchResults = new QListWidget();
+    m_searchResults->hide();
+
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(250);
 
     m_hboxLayout->addWidget(m_urlInput);
     m_hboxLayout->addWidget(m_browseButton);
+    m_hboxLayout->addWidget(m_metalinkButton);
 
     m_vboxLayout->addWidget(m_nameApp);
     m_vboxLayout->addLayout(m_hboxLayout);
+    m_vboxLayout->addWidget(m_decompressCheckBox);
     m_vboxLayout->addWidget(m_downloadButton);
     m_vboxLayout->addLayout(m_layoutForSelectedItemsBt);
-    m_vboxLayout->addWidget(m_listWidget);
+    m_vboxLayout->addWidget(m_searchInput);
+    m_vboxLayout->addWidget(m_listView);
+    m_vboxLayout->addWidget(m_searchResults);
 
     setLayoutForSelectedItemsBtVisible(false);
 }
@@ -75,7 +97,25 @@ void MainWindow::setUpConnections(){
 
     connect(m_browseButton, &QPushButton::clicked, this, &MainWindow::onClickBrowseButton);
 
+    connect(m_metalinkButton, &QPushButton::clicked, this, &MainWindow::onClickMetalinkButton);
+
     connect(m_downloadManager, &DownloadManager::downloadReadyToAdd, this, &MainWindow::addDownloadItem);
+    connect(m_downloadManager, &DownloadManager::historyReadyToAdd, this, &MainWindow::addHistoryEntries);
+    connect(m_downloadManager, &DownloadManager::downloadArchived, this, &MainWindow::archiveDownloadItem);
+    connect(m_downloadManager, &DownloadManager::historyEntryRemoved, m_listModel, &DownloadListModel::removeHistory);
+    connect(m_downloadManager, &DownloadManager::historyUnchecked, m_listModel, [this](const QUuid &id){
+        m_listModel->setHistoryChecked(id, false);
+    });
+    connect(m_listModel, &DownloadListModel::historyCheckChanged, m_downloadManager, &DownloadManager::changeHistoryBt);
+    connect(m_listModel, &DownloadListModel::historyRemovalRequested, m_downloadManager, &DownloadManager::deleteHistoryEntry);
+
+    // Pages of finished downloads are fetched when the list nears its end,
+    // or while it is too short to scroll at all.
+    connect(m_listView->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::onListScrolled);
+    connect(m_listView->verticalScrollBar(), &QScrollBar::rangeChanged, this, &MainWindow::onListScrolled);
+
+    connect(m_searchInput, &QLineEdit::textChanged, this, &MainWindow::onSearchChanged);
+    connect(m_searchTimer, &QTimer::timeout, this, &MainWindow::runSearch);
 
     connect(m_downloadManager, &DownloadManager::showButtons, this, [=](){
         setLayoutForSelectedItemsBtVisible(true);
@@ -94,6 +134,7 @@ void MainWindow::setUpConnections(){
 
 void MainWindow::handleDownloadConflicts(const QString &url, const DownloadTypes::ConflictResult &conflict){
     DownloadTypes::UserChoice choice = showConflictDialog(url, conflict.type);
+    choice.decompress = m_decompressCheckBox->isChecked();
 
     m_downloadManager->processDownloadRequest(url, m_dir, choice);
 
@@ -164,18 +205,34 @@ void MainWindow::onClickDownloadButton(){
         return;
     }
 
-    if(!(url.startsWith("http://") || url.startsWith("https://"))){
-        QMessageBox::warning(this, "Error", "Please enter a valid HTTP/HTTPS URL");
-        return;
+    const QStringList sources = url.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    for(const QString &source : sources){
+        if(!(source.startsWith("http://") || source.startsWith("https://"))){
+            QMessageBox::warning(this, "Error", "Please enter a valid HTTP/HTTPS URL");
+            return;
+        }
     }
 
     m_urlInput->clear();
 
     DownloadTypes::UserChoice choice;
+    choice.decompress = m_decompressCheckBox->isChecked();
 
     m_downloadManager->processDownloadRequest(url, m_dir, choice);
 }
 
+void MainWindow::onClickMetalinkButton(){
+    if(m_dir.isEmpty()) {
+        QMessageBox::warning(this, "Error", "Please select folder");
+        return;
+    }
+
+    QString path = QFileDialog::getOpenFileName(this, "Import Metalink", QString(), "Metalink (*.meta4 *.metalink)");
+    if(path.isEmpty()) return;
+
+    m_downloadManager->importMetalink(path, m_dir);
+}
+
 void MainWindow::onClickBrowseButton(){
     QString dir = QFileDialog::getExistingDirectory(this,
                                                     "select a folder",
@@ -187,27 +244,63 @@ void MainWindow::onClickBrowseButton(){
 }
 
 void MainWindow::addDownloadItem(DownloadItem* item){
+    m_listModel->addItem(item);
+}
+
+void MainWindow::addHistoryEntries(const QVector<DownloadTypes::HistoryEntry> &entries){
+    m_listModel->addHistory(entries);
+}
 
-    QListWidgetItem *listItem = new QListWidgetItem("");
+void MainWindow::archiveDownloadItem(DownloadItem *item, const DownloadTypes::HistoryEntry &entry){
+    m_listModel->replaceWithHistory(item, entry);
+    item->deleteLater();
+}
+
+void MainWindow::onListScrolled(){
+    QScrollBar *bar = m_listView->verticalScrollBar();
+    if(bar->value() >= bar->maximum() - bar->pageStep()){
+        m_downloadManager->loadMoreHistory();
+    }
+}
 
-    m_listWidget->addItem(listItem);
-    m_listWidget->setItemWidget(listItem, item);
+void MainWindow::onSearchChanged(const QString &text){
+    bool searching = !text.trimmed().isEmpty();
+    m_listView->setVisible(!searching);
+    m_searchResults->setVisible(searching);
 
-    listItem->setSizeHint(QSize(item->width(), item->height()));
+    if(searching){
+        m_searchTimer->start();
+    }else{
+        m_searchTimer->stop();
+        m_searchResults->clear();
+    }
+}
 
-    QThread* currentObjThread = this->thread();
-    QThread* currentExecThread = QThread::currentThread();
+void MainWindow::runSearch(){
+    DownloadTypes::HistoryQuery query;
+    query.text = m_searchInput->text().trimmed();
+    query.limit = 200;
+
+    m_downloadManager->searchHistory(query).then(this, [this, text = query.text](const QVector<DownloadTypes::HistoryEntry> &entries){
+        // A newer query has been typed since.
+        if(m_searchInput->text().trimmed() != text) return;
+
+        m_searchResults->clear();
+        for(const auto &entry : entries){
+            QString status = entry.status == DownloadTypes::DownloadStatus::Error ? "Error"
+                           : entry.status == DownloadTypes::DownloadStatus::Cancelled ? "Cancelled" : "Completed";
+            QListWidgetItem *result = new QListWidgetItem(QString("%1  —  %2  —  %3\n%4")
+                                                              .arg(entry.name, status,
+                                                                   entry.finishedAt.toLocalTime().toString("yyyy-MM-dd HH:mm"),
+                                                                   entry.url));
+            result->setToolTip(entry.filePath + (entry.hash.isEmpty() ? QString() : "\n" + entry.hash));
+            m_searchResults->addItem(result);
+        }
+    });
 }
 
 void MainWindow::deleteDownloadItem(DownloadItem* item){
-    for(int i = 0; i < m_listWidget->count(); ++i){
-        QListWidgetItem* listItem = m_listWidget->item(i);
-        DownloadItem* downloadItem = qobject_cast<DownloadItem*>(m_listWidget->itemWidget(listItem));
-        if(downloadItem == item){
-            delete m_listWidget->takeItem(i);
-            break;
-        }
-    }
+    m_listModel->removeItem(item);
     item->deleteLater();
 }
 
@@ -0,0 +1,105 @@
+#include "../headers/metalinkparser.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+#include <QDebug>
+#include <algorithm>
+#include <climits>
+
+QVector<MetalinkFile> MetalinkParser::parseFile(const QString &path, QString *error){
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)){
+        if(error) *error = file.errorString();
+        return {};
+    }
+
+    return parse(file.readAll(), error);
+}
+
+QVector<MetalinkFile> MetalinkParser::parse(const QByteArray &document, QString *error){
+    QVector<MetalinkFile> files;
+    QXmlStreamReader reader(document);
+
+    if(!reader.readNextStartElement() || reader.name() != QLatin1String("metalink")){
+        if(error) *error = "Not a metalink document";
+        return {};
+    }
+
+    while(reader.readNextStartElement()){
+        if(reader.name() == QLatin1String("file")){
+            MetalinkFile file = readFile(reader);
+            if(!file.name.isEmpty() && !file.urls.isEmpty()){
+                files.append(file);
+            }else{
+                qDebug() << "Metalink entry without a name or usable URL skipped";
+            }
+        }else{
+            reader.skipCurrentElement();
+        }
+    }
+
+    if(reader.hasError()){
+        if(error) *error = reader.errorString();
+        return {};
+    }
+
+    return files;
+}
+
+MetalinkFile MetalinkParser::readFile(QXmlStreamReader &reader){
+    MetalinkFile file;
+
+    // The name may carry a relative path; only the last component is used so
+    // an entry can never point outside the download folder.
+    QString name = QFileInfo(reader.attributes().value("name").toString()).fileName();
+    if(name != ".." && name != "."){
+        file.name = name;
+    }
+
+    QVector<QPair<int, QString>> urls;
+
+    while(reader.readNextStartElement()){
+        if(reader.name() == QLatin1String("size")){
+            bool ok = false;
+            qint64 size = reader.readElementText().trimmed().toLongLong(&ok);
+            if(ok) file.size = size;
+        }else if(reader.name() == QLatin1String("hash")){
+            QString type = reader.attributes().value("type").toString().toLower();
+            file.hashes[type] = reader.readElementText().trimmed().toLower();
+        }else if(reader.name() == QLatin1String("pieces")){
+            readPieces(reader, file);
+        }else if(reader.name() == QLatin1String("url")){
+            bool ok = false;
+            int priority = reader.attributes().value("priority").toInt(&ok);
+            QString url = reader.readElementText().trimmed();
+
+            QString scheme = QUrl(url).scheme();
+            if(scheme == "http" || scheme == "https"){
+                urls.append({ok ? priority : INT_MAX, url});
+            }
+        }else{
+            reader.skipCurrentElement();
+        }
+    }
+
+    std::stable_sort(urls.begin(), urls.end(), [](const auto &a, const auto &b){ return a.first < b.first; });
+    for(const auto &url : urls){
+        if(!file.urls.contains(url.second)) file.urls.append(url.second);
+    }
+
+    return file;
+}
+
+void MetalinkParser::readPieces(QXmlStreamReader &reader, MetalinkFile &file){
+    file.pieceType = reader.attributes().value("type").toString().toLower();
+    file.pieceLength = reader.attributes().value("length").toLongLong();
+
+    while(reader.readNextStartElement()){
+        if(reader.name() == QLatin1String("hash")){
+            file.pieceHashes.append(reader.readElementText().trimmed().toLower().toUtf8());
+        }else{
+            reader.skipCurrentElement();
+        }
+    }
+}
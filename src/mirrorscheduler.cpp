@@ -0,0 +1,132 @@
+#include "../headers/mirrorscheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+void MirrorScheduler::setMirrors(const QStringList &urls){
+    m_mirrors.clear();
+    for(const QString &url : urls){
+        QUrl parsed(url);
+        if(!parsed.isValid()) continue;
+
+        bool duplicate = false;
+        for(const Mirror &mirror : m_mirrors){
+            if(mirror.url == parsed) duplicate = true;
+        }
+        if(duplicate) continue;
+
+        Mirror mirror;
+        mirror.url = parsed;
+        m_mirrors.append(mirror);
+    }
+}
+
+int MirrorScheduler::activeCount() const{
+    int active = 0;
+    for(const Mirror &mirror : m_mirrors){
+        if(mirror.enabled) ++active;
+    }
+    return active;
+}
+
+void MirrorScheduler::reportThroughput(int mirror, double bytesPerSecond){
+    if(mirror < 0 || mirror >= m_mirrors.size()) return;
+
+    Mirror &entry = m_mirrors[mirror];
+    if(entry.throughput <= 0){
+        entry.throughput = bytesPerSecond;
+    }else{
+        entry.throughput = SMOOTHING * bytesPerSecond + (1 - SMOOTHING) * entry.throughput;
+    }
+}
+
+void MirrorScheduler::reportFailure(int mirror){
+    if(mirror < 0 || mirror >= m_mirrors.size()) return;
+
+    Mirror &entry = m_mirrors[mirror];
+    ++entry.failures;
+    if(entry.failures >= MAX_FAILURES){
+        entry.enabled = false;
+    }
+}
+
+// Mirrors without measurements yet get the average speed of the measured
+// ones; every failure halves a mirror's share.
+double MirrorScheduler::weight(int mirror) const{
+    const Mirror &entry = m_mirrors[mirror];
+    if(!entry.enabled) return 0;
+
+    double throughput = entry.throughput;
+    if(throughput <= 0){
+        double sum = 0;
+        int measured = 0;
+        for(const Mirror &other : m_mirrors){
+            if(other.enabled && other.throughput > 0){
+                sum += other.throughput;
+                ++measured;
+            }
+        }
+        throughput = measured > 0 ? sum / measured : 1.0;
+    }
+
+    return throughput / std::pow(2.0, entry.failures);
+}
+
+int MirrorScheduler::bestMirror(int exclude) const{
+    int best = -1;
+    double bestWeight = 0;
+    for(int i = 0; i < m_mirrors.size(); ++i){
+        if(i == exclude) continue;
+        double w = weight(i);
+        if(w > bestWeight){
+            bestWeight = w;
+            best = i;
+        }
+    }
+
+    if(best == -1 && exclude >= 0 && weight(exclude) > 0){
+        best = exclude;
+    }
+    return best;
+}
+
+QVector<MirrorScheduler::Segment> MirrorScheduler::assign(int firstChunk, int lastChunk) const{
+    QVector<Segment> segments;
+    int chunks = lastChunk - firstChunk + 1;
+    if(chunks <= 0) return segments;
+
+    QVector<int> active;
+    double totalWeight = 0;
+    for(int i = 0; i < m_mirrors.size(); ++i){
+        double w = weight(i);
+        if(w > 0){
+            active.append(i);
+            totalWeight += w;
+        }
+    }
+    if(active.isEmpty()) return segments;
+
+    std::sort(active.begin(), active.end(), [this](int a, int b){ return weight(a) > weight(b); });
+    while(active.size() > chunks){
+        totalWeight -= weight(active.takeLast());
+    }
+
+    int next = firstChunk;
+    for(int i = 0; i < active.size(); ++i){
+        int remainingMirrors = active.size() - i - 1;
+        int share = (i == active.size() - 1)
+                        ? lastChunk - next + 1
+                        : qMax(1, static_cast<int>(std::llround(chunks * weight(active[i]) / totalWeight)));
+        share = qMin(share, lastChunk - next + 1 - remainingMirrors);
+
+        Segment segment;
+        segment.mirror = active[i];
+        segment.firstChunk = next;
+        segment.lastChunk = next + share - 1;
+        segments.append(segment);
+
+        next += share;
+    }
+
+    return segments;
+}
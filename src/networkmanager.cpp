@@ -1,10 +1,8 @@
 #include "../headers/networkmanager.h"
 
-NetworkManager::NetworkManager(QObject *parent) : QObject(parent) {
-    m_manager = new QNetworkAccessManager(this);
-}
+NetworkManager::NetworkManager(QObject *parent) : QObject(parent) {}
 
-QNetworkRequest NetworkManager::prepareRequest(const QUrl &url, qint64 startByte){
+QNetworkRequest NetworkManager::prepareRequest(const QUrl &url, qint64 startByte, const QString &ifRange, qint64 endByte){
     QNetworkRequest request(url);
 
     request.setHeader(QNetworkRequest::UserAgentHeader,
@@ -18,12 +16,22 @@ QNetworkRequest NetworkManager::prepareRequest(const QUrl &url, qint64 startByte
 
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
 
-    request.setRawHeader("Connection", "keep-alive");
     request.setRawHeader("Upgrade-Insecure-Requests", "1");
 
-    if(startByte > 0){
+    // Setting Accept-Encoding ourselves also stops QNetworkAccessManager from
+    // inflating bodies behind our back, which would break byte ranges.
+    request.setRawHeader("Accept-Encoding", m_acceptEncoding);
+
+    if(startByte > 0 || endByte >= 0){
         QString range = QString("bytes=%1-").arg(startByte);
+        if(endByte >= 0){
+            range += QString::number(endByte);
+        }
         request.setRawHeader("Range", range.toUtf8());
+
+        if(!ifRange.isEmpty()){
+            request.setRawHeader("If-Range", ifRange.toUtf8());
+        }
     }
 
     return request;
@@ -33,18 +41,22 @@ QNetworkRequest NetworkManager::prepareRequest(const QUrl &url, qint64 startByte
 void NetworkManager::getRemoteFileInfo(const QUrl& url){
     QNetworkRequest request = prepareRequest(url);
 
-    QNetworkReply *reply = m_manager->head(request);
+    QNetworkReply *reply = NetworkSession::manager()->head(request);
 
     connect(reply, &QNetworkReply::finished, this, [=]() {
         RemoteFileInfo info;
         info.url = url;
 
         if (reply->error() == QNetworkReply::NoError) {
+            // After redirects, the URL the answer came from.
+            info.url = reply->url();
             info.isValid = true;
             info.fileSize = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
             info.supportsRange = (reply->rawHeader("Accept-Ranges") == "bytes");
             info.mimeType = reply->header(QNetworkRequest::ContentTypeHeader).toString();
             info.fileName = parseFileName(reply);
+            info.etag = QString::fromUtf8(reply->rawHeader("ETag"));
+            info.lastModified = QString::fromUtf8(reply->rawHeader("Last-Modified"));
 
             QFileInfo fileDetails(info.fileName);
             info.suffix = "." + fileDetails.suffix();
@@ -58,6 +70,100 @@ void NetworkManager::getRemoteFileInfo(const QUrl& url){
     });
 }
 
+// Opens the GET straight away instead of sending a HEAD first. The first
+// response carries everything HEAD would; up to PREFETCH_LIMIT bytes of the
+// body are kept in memory until the caller has resolved conflicts.
+void NetworkManager::probeRemoteFile(const QUrl &url){
+    QNetworkRequest request = prepareRequest(url);
+    request.setRawHeader("Range", "bytes=0-");
+
+    m_probeInfo = RemoteFileInfo();
+    m_probeInfo.url = url;
+
+    m_probeReply = NetworkSession::manager()->get(request);
+
+    connect(m_probeReply, &QNetworkReply::metaDataChanged, this, &NetworkManager::onProbeMetaDataChanged);
+    connect(m_probeReply, &QNetworkReply::readyRead, this, &NetworkManager::onProbeReadyRead);
+    connect(m_probeReply, &QNetworkReply::finished, this, &NetworkManager::onProbeFinished);
+}
+
+void NetworkManager::onProbeMetaDataChanged(){
+    if (!m_probeReply) return;
+
+    int status = m_probeReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status < 200 || status >= 300) return;
+
+    // Redirects have been followed by now; later requests go straight to
+    // the final location.
+    m_probeInfo.url = m_probeReply->url();
+    m_probeInfo.isValid = true;
+    if (status == 206) {
+        QString contentRange = QString::fromUtf8(m_probeReply->rawHeader("Content-Range"));
+        m_probeInfo.fileSize = contentRange.section('/', 1).toLongLong();
+        m_probeInfo.supportsRange = true;
+    } else {
+        m_probeInfo.fileSize = m_probeReply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        m_probeInfo.supportsRange = false;
+    }
+    m_probeInfo.mimeType = m_probeReply->header(QNetworkRequest::ContentTypeHeader).toString();
+    m_probeInfo.fileName = parseFileName(m_probeReply);
+    m_probeInfo.etag = QString::fromUtf8(m_probeReply->rawHeader("ETag"));
+    m_probeInfo.lastModified = QString::fromUtf8(m_probeReply->rawHeader("Last-Modified"));
+    m_probeInfo.suffix = "." + QFileInfo(m_probeInfo.fileName).suffix();
+}
+
+void NetworkManager::onProbeReadyRead(){
+    if (!m_probeReply || !m_probeInfo.isValid) return;
+
+    qint64 wanted = PREFETCH_LIMIT - m_probeInfo.prefetched.size();
+    if (wanted > 0) {
+        m_probeInfo.prefetched += m_probeReply->read(wanted);
+    }
+
+    if (m_probeInfo.prefetched.size() >= PREFETCH_LIMIT) {
+        m_probeInfo.complete = m_probeInfo.fileSize > 0 && m_probeInfo.prefetched.size() >= m_probeInfo.fileSize;
+        finishProbe();
+    }
+}
+
+void NetworkManager::onProbeFinished(){
+    if (!m_probeReply) return;
+
+    int status = m_probeReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    // An empty file cannot satisfy "bytes=0-"; ask with HEAD instead.
+    if (status == 416) {
+        QUrl url = m_probeInfo.url;
+        m_probeReply->deleteLater();
+        m_probeReply = nullptr;
+        getRemoteFileInfo(url);
+        return;
+    }
+
+    if (m_probeReply->error() == QNetworkReply::NoError) {
+        m_probeInfo.prefetched += m_probeReply->read(PREFETCH_LIMIT - m_probeInfo.prefetched.size());
+        m_probeInfo.complete = true;
+        if (m_probeInfo.fileSize <= 0) m_probeInfo.fileSize = m_probeInfo.prefetched.size();
+    } else {
+        m_probeInfo.isValid = false;
+        m_probeInfo.errorString = m_probeReply->errorString();
+        m_probeInfo.prefetched.clear();
+    }
+
+    finishProbe();
+}
+
+void NetworkManager::finishProbe(){
+    m_probeReply->disconnect(this);
+    if (m_probeReply->isRunning()) {
+        m_probeReply->abort();
+    }
+    m_probeReply->deleteLater();
+    m_probeReply = nullptr;
+
+    emit fileInfoReady(std::exchange(m_probeInfo, RemoteFileInfo()));
+}
+
 QString NetworkManager::parseFileName(QNetworkReply *reply){
     QString disposition = reply->header(QNetworkRequest::ContentDispositionHeader).toString();
     QString name;
@@ -73,21 +179,66 @@ QString NetworkManager::parseFileName(QNetworkReply *reply){
 }
 
 
-void NetworkManager::startDownload(const QUrl &url, qint64 startByte){
-    m_reply = m_manager->get(prepareRequest(url, startByte));
+void NetworkManager::startDownload(const QUrl &url, qint64 startByte, const QString &ifRange, qint64 endByte){
+    m_startByte = startByte;
+    m_ranged = startByte > 0 || endByte >= 0;
+    m_reply = NetworkSession::manager()->get(prepareRequest(url, startByte, ifRange, endByte));
 
+    connect(m_reply, &QNetworkReply::metaDataChanged, this, &NetworkManager::onMetaDataChanged);
     connect(m_reply, &QNetworkReply::readyRead, this, &NetworkManager::onReadyRead);
     connect(m_reply, &QNetworkReply::downloadProgress, this, &NetworkManager::onDownloadProgress);
     connect(m_reply, &QNetworkReply::finished, this, &NetworkManager::onFinished);
     connect(m_reply, &QNetworkReply::errorOccurred, this, &NetworkManager::onError);
 }
 
+void NetworkManager::setChunkProcessor(ChunkProcessor *processor){
+    m_chunkProcessor = processor;
+}
+
+void NetworkManager::setAcceptEncoding(const QByteArray &encodings){
+    m_acceptEncoding = encodings;
+}
+
+void NetworkManager::onMetaDataChanged(){
+    if (!m_reply) return;
+
+    int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 0) return;
+
+    emit validatorsReceived(QString::fromUtf8(m_reply->rawHeader("ETag")),
+                            QString::fromUtf8(m_reply->rawHeader("Last-Modified")));
+
+    if (status == 206) {
+        QString contentRange = QString::fromUtf8(m_reply->rawHeader("Content-Range"));
+        qint64 total = contentRange.section('/', 1).toLongLong();
+        if (total > 0) emit remoteSizeReceived(total);
+    } else {
+        qint64 length = m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        if (length > 0) emit remoteSizeReceived(length);
+    }
+
+    // 200 to a ranged request means the If-Range validator no longer matches
+    // (or the server ignores Range): the body is the whole, current file.
+    if (m_ranged && status == 200) {
+        m_startByte = 0;
+        m_ranged = false;
+        emit rangeIgnored();
+    }
+
+    emit encodingReceived(QString::fromUtf8(m_reply->rawHeader("Content-Encoding")));
+}
+
 void NetworkManager::onReadyRead(){
-    if (m_reply) {
-        QByteArray data = m_reply->readAll();
-        if (!data.isEmpty()) {
-            emit dataReceived(data);
-        }
+    if (!m_reply) return;
+
+    if (m_chunkProcessor) {
+        m_chunkProcessor->readFrom(m_reply);
+        return;
+    }
+
+    QByteArray data = m_reply->readAll();
+    if (!data.isEmpty()) {
+        emit dataReceived(data);
     }
 }
 
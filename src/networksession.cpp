@@ -0,0 +1,11 @@
+#include "../headers/networksession.h"
+
+QThreadStorage<QNetworkAccessManager*> NetworkSession::s_managers;
+
+QNetworkAccessManager* NetworkSession::manager(){
+    if(!s_managers.hasLocalData()){
+        s_managers.setLocalData(new QNetworkAccessManager());
+    }
+
+    return s_managers.localData();
+}
@@ -0,0 +1,51 @@
+#include "../headers/progressthrottle.h"
+
+ProgressThrottle::ProgressThrottle(qint64 intervalMs, qint64 byteStep) :
+    m_intervalMs(intervalMs),
+    m_byteStep(byteStep) {}
+
+bool ProgressThrottle::shouldPublish(qint64 received, qint64 total){
+    bool publish;
+    if(!m_sincePublished.isValid() || received < m_lastReceived){
+        publish = true;
+    }else if(total > 0 && received >= total){
+        publish = received != m_lastReceived;
+    }else{
+        qint64 advanced = received - m_lastReceived;
+        qint64 elapsed = m_sincePublished.elapsed();
+        publish = advanced > 0 && ((elapsed >= m_intervalMs && advanced >= m_byteStep) || elapsed >= MAX_SILENCE_MS);
+    }
+
+    if(publish){
+        markPublished(received);
+    }else{
+        ++m_suppressed;
+        m_hasPending = received != m_lastReceived;
+        m_pendingReceived = received;
+        m_pendingTotal = total;
+    }
+    return publish;
+}
+
+// The last suppressed report, if it is newer than what was published.
+bool ProgressThrottle::takePending(qint64 &received, qint64 &total){
+    if(!m_hasPending) return false;
+
+    received = m_pendingReceived;
+    total = m_pendingTotal;
+    markPublished(received);
+    return true;
+}
+
+void ProgressThrottle::reset(){
+    m_sincePublished.invalidate();
+    m_lastReceived = 0;
+    m_hasPending = false;
+}
+
+void ProgressThrottle::markPublished(qint64 received){
+    m_sincePublished.start();
+    m_lastReceived = received;
+    m_hasPending = false;
+    ++m_published;
+}
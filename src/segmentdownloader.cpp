@@ -0,0 +1,128 @@
+#include "../headers/segmentdownloader.h"
+
+SegmentDownloader::SegmentDownloader(int mirror, const QUrl &url, int firstChunk, int lastChunk,
+                                     qint64 chunkSize, qint64 totalBytes, QCryptographicHash::Algorithm algorithm,
+                                     QObject *parent) : QObject(parent),
+                                                        m_mirror(mirror),
+                                                        m_url(url),
+                                                        m_nextChunk(firstChunk),
+                                                        m_lastChunk(lastChunk),
+                                                        m_chunkSize(chunkSize),
+                                                        m_totalBytes(totalBytes)
+{
+    m_chunkProcessor = new ChunkProcessor(this);
+    m_chunkProcessor->setChunkSize(m_chunkSize);
+    m_chunkProcessor->setCryptographicAlgorithm(algorithm);
+    m_chunkProcessor->reset(firstChunk);
+
+    m_networkManager = new NetworkManager(this);
+    m_networkManager->setChunkProcessor(m_chunkProcessor);
+
+    connect(m_chunkProcessor, &ChunkProcessor::chunkReady, this, &SegmentDownloader::onChunkReady, Qt::DirectConnection);
+    connect(m_networkManager, &NetworkManager::downloadProgress, this, &SegmentDownloader::onDownloadProgress, Qt::DirectConnection);
+    connect(m_networkManager, &NetworkManager::finished, this, &SegmentDownloader::onNetworkFinished, Qt::DirectConnection);
+    connect(m_networkManager, &NetworkManager::remoteSizeReceived, this, &SegmentDownloader::onRemoteSize, Qt::DirectConnection);
+    connect(m_networkManager, &NetworkManager::rangeIgnored, this, &SegmentDownloader::onRangeIgnored, Qt::DirectConnection);
+    connect(m_networkManager, &NetworkManager::errorOccurred, this, &SegmentDownloader::fail, Qt::QueuedConnection);
+}
+
+void SegmentDownloader::start(){
+    qint64 startByte = m_nextChunk * m_chunkSize;
+    qint64 endByte = qMin((m_lastChunk + 1) * m_chunkSize, m_totalBytes) - 1;
+
+    m_networkManager->startDownload(m_url, startByte, QString(), endByte);
+}
+
+void SegmentDownloader::abort(){
+    m_finished = true;
+    m_networkManager->abort();
+}
+
+void SegmentDownloader::shrinkTo(int lastChunk){
+    m_lastChunk = qMax(lastChunk, m_nextChunk - 1);
+    if(m_nextChunk > m_lastChunk){
+        complete();
+    }
+}
+
+qint64 SegmentDownloader::takeBytesSinceSample(){
+    qint64 bytes = m_bytesSinceSample;
+    m_bytesSinceSample = 0;
+    return bytes;
+}
+
+void SegmentDownloader::rejectChunk(int index){
+    m_nextChunk = index;
+    fail();
+}
+
+void SegmentDownloader::onChunkReady(int index, const QByteArray &data, const QByteArray &hash){
+    if(m_finished || index > m_lastChunk) return;
+
+    m_nextChunk = index + 1;
+    emit chunkReady(index, data, hash);
+
+    if(m_nextChunk > m_lastChunk){
+        complete();
+    }
+}
+
+void SegmentDownloader::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal){
+    qint64 delta = bytesReceived - m_lastProgress;
+    m_lastProgress = bytesReceived;
+    m_bytesSinceSample += delta;
+
+    if(!m_finished){
+        emit progress(delta);
+    }
+}
+
+void SegmentDownloader::onNetworkFinished(){
+    m_chunkProcessor->finalize();
+
+    if(!m_finished && m_nextChunk <= m_lastChunk){
+        fail();
+    }
+}
+
+void SegmentDownloader::onRemoteSize(qint64 totalSize){
+    if(totalSize != m_totalBytes){
+        qDebug() << "Mirror" << m_url.host() << "reports" << totalSize << "bytes instead of" << m_totalBytes;
+        fail();
+    }
+}
+
+// The body of a 200 starts at byte 0, not at this segment, so none of it may
+// be chunked under this segment's indexes. The reply is still inside its own
+// signal here; aborting it and reporting the failure wait for the event loop.
+void SegmentDownloader::onRangeIgnored(){
+    if(m_finished) return;
+
+    qDebug() << "Mirror" << m_url.host() << "ignored the range request";
+    m_finished = true;
+    m_networkManager->setChunkProcessor(nullptr);
+    QMetaObject::invokeMethod(this, &SegmentDownloader::reportFailure, Qt::QueuedConnection);
+}
+
+void SegmentDownloader::fail(){
+    if(m_finished || m_failed) return;
+
+    m_finished = true;
+    reportFailure();
+}
+
+void SegmentDownloader::reportFailure(){
+    if(m_failed) return;
+
+    m_failed = true;
+    m_networkManager->abort();
+    emit failed();
+}
+
+void SegmentDownloader::complete(){
+    if(m_finished) return;
+
+    m_finished = true;
+    m_networkManager->abort();
+    emit finished();
+}
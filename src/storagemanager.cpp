@@ -1,5 +1,8 @@
 #include "../headers/storagemanager.h"
 
+#include <algorithm>
+#include <QDebug>
+
 StorageManager::StorageManager(QObject *parent) : QObject(parent) {}
 
 StorageManager::~StorageManager() {
@@ -21,7 +24,8 @@ void StorageManager::openFile(const DownloadTypes::DownloadRecord &fileInfo) {
             }
         }
         m_files[fileInfo] = file;
-    }else{
+        m_quantityOfChunks[fileInfo] = fileInfo.quantityOfChunks;
+    }else if(!m_files[fileInfo]->isOpen()){
         if (!m_files[fileInfo]->open(QIODevice::ReadWrite)) {
             emit errorOccurred("Не вдалося відкрити файл для запису: " + m_files[fileInfo]->errorString());
         }
@@ -31,130 +35,155 @@ void StorageManager::openFile(const DownloadTypes::DownloadRecord &fileInfo) {
 }
 
 void StorageManager::writeChunk(const DownloadTypes::DownloadRecord &fileInfo, int index, const QByteArray &data) {
-    if (!m_files[fileInfo]->isOpen()) return;
-    if(data.size() < m_chunkSize){
-        m_data[fileInfo].push_back(data);
-        writeToDisk(fileInfo, index);
-    }else{
-        m_data[fileInfo].push_back(data);
-    }
+    if (!m_files.contains(fileInfo) || !m_files[fileInfo]->isOpen()) return;
+
+    auto &chunks = m_data[fileInfo];
+    chunks.push_back(qMakePair(index, data));
 
-    if(m_data[fileInfo].size() >= fileInfo.quantityOfChunks){
-        writeToDisk(fileInfo, index);
+    // The batch size is counted in MiB so it means the same for any chunk size.
+    qint64 batchBytes = m_quantityOfChunks.value(fileInfo, fileInfo.quantityOfChunks) * DownloadTypes::DEFAULT_CHUNK_SIZE;
+    if(chunks.size() * fileInfo.chunkSize >= batchBytes){
+        writeToDisk(fileInfo);
     }
 }
 
-void StorageManager::writeToDisk(const DownloadTypes::DownloadRecord &fileInfo, qint64 lastIndex){
+// Chunks are written at their own offsets, so batches coming from several
+// mirrors in any order land correctly; seeks happen only between runs.
+void StorageManager::writeToDisk(const DownloadTypes::DownloadRecord &fileInfo){
     if (!m_files.contains(fileInfo)) return;
 
     std::shared_ptr<QFile> file = m_files[fileInfo];
     auto &chunks = m_data[fileInfo];
-    if (chunks.isEmpty()) return;
+    if (chunks.isEmpty() || !file->isOpen()) return;
 
-    if (!chunks.isEmpty() && chunks.last().size() < m_chunkSize) {
-        closeFile(fileInfo);
-    }else{
-
-        qint64 firstIndexInBatch = lastIndex - chunks.size() + 1;
-        position = firstIndexInBatch * m_chunkSize;
-
-        if (!file->seek(position)) {
-            emit errorOccurred("Помилка позиціювання: " + file->errorString());
-            return;
-        }
+    std::sort(chunks.begin(), chunks.end(), [](const QPair<int, QByteArray> &a, const QPair<int, QByteArray> &b){
+        return a.first < b.first;
+    });
 
-        QElapsedTimer timer;
-        timer.start();
-        bool success = true;
-        for (const QByteArray &chunk : chunks) {
-            if (file->write(chunk) == -1) {
+    QElapsedTimer timer;
+    timer.start();
+    bool success = true;
+    int previousIndex = -2;
+    for (const auto &chunk : chunks) {
+        if (chunk.first != previousIndex + 1) {
+            position = chunk.first * fileInfo.chunkSize;
+            if (!file->seek(position)) {
+                emit errorOccurred("Помилка позиціювання: " + file->errorString());
                 success = false;
                 break;
             }
         }
 
-
-        if (!success) {
-            emit errorOccurred("Помилка запису на диск!");
-        } else {
-            file->flush();
-            emit chunkSaved(lastIndex);
-        }
-        qint64 writeTime = timer.elapsed();
-        updateQuantityOfChunks(fileInfo, writeTime, chunks.size());
-
-        chunks.clear();
-    }
-}
-
-void StorageManager::flushAllData(const DownloadTypes::DownloadRecord &fileInfo){
-    if (!m_files.contains(fileInfo)) return;
-
-    std::shared_ptr<QFile> file = m_files[fileInfo];
-    auto &chunks = m_data[fileInfo];
-    if (chunks.isEmpty()) return;
-
-    bool success = true;
-    for (const QByteArray &chunk : chunks) {
-        if (file->write(chunk) == -1) {
+        if (file->write(chunk.second) == -1) {
             success = false;
             break;
         }
+        previousIndex = chunk.first;
     }
 
     if (!success) {
         emit errorOccurred("Помилка запису на диск!");
     } else {
         file->flush();
-    }
 
-    if (!chunks.isEmpty() && chunks.last().size() < m_chunkSize) {
-        emit savedLastChunk(fileInfo);
+        QVector<int> indices;
+        indices.reserve(chunks.size());
+        for (const auto &chunk : chunks) indices.append(chunk.first);
+        emit chunksSaved(fileInfo, indices);
     }
+    qint64 writeTime = timer.elapsed();
+    updateQuantityOfChunks(fileInfo, writeTime, qMax<qint64>(1, chunks.size() * fileInfo.chunkSize / DownloadTypes::DEFAULT_CHUNK_SIZE));
 
     chunks.clear();
-
 }
 
-void StorageManager::updateQuantityOfChunks(const DownloadTypes::DownloadRecord &fileInfo, qint64 writeTime, qint64 dataSize){
-    if (dataSize <= 0) return;
+// The write batch size adapts to the disk: slow writes get bigger batches,
+// fast ones smaller. It is kept here rather than in the task's fileInfo,
+// which is the key of m_files and must not change while the file is open.
+void StorageManager::updateQuantityOfChunks(const DownloadTypes::DownloadRecord &fileInfo, qint64 writeTime, qint64 dataMiB){
+    if (dataMiB <= 0) return;
 
-    qint64 avgTimePerChunk = writeTime / dataSize;
+    qint64 &quantity = m_quantityOfChunks[fileInfo];
+    qint64 avgTimePerMiB = writeTime / dataMiB;
 
-    if (avgTimePerChunk < 10) {
-        if (fileInfo.quantityOfChunks > 8) emit changeQuantityOfChunks(fileInfo, -4);
+    if (avgTimePerMiB < 10) {
+        if (quantity > 8) quantity -= 4;
     }
-    else if (avgTimePerChunk < 30) {
-        if (fileInfo.quantityOfChunks > 16) emit changeQuantityOfChunks(fileInfo, -2);
+    else if (avgTimePerMiB < 30) {
+        if (quantity > 16) quantity -= 2;
     }
-    else if (avgTimePerChunk > 40 && avgTimePerChunk <= 100) {
-        if (fileInfo.quantityOfChunks < 64) emit changeQuantityOfChunks(fileInfo, 4);
+    else if (avgTimePerMiB > 40 && avgTimePerMiB <= 100) {
+        if (quantity < 64) quantity += 4;
     }
-    else if (avgTimePerChunk > 100) {
-        if (fileInfo.quantityOfChunks < 128) emit changeQuantityOfChunks(fileInfo, 8);
+    else if (avgTimePerMiB > 100) {
+        if (quantity < 128) quantity += 8;
     }
 
-    if(fileInfo.quantityOfChunks > 120 || fileInfo.quantityOfChunks < 4){
-        emit changeQuantityOfChunks(fileInfo, qBound(8LL, (qint64)fileInfo.quantityOfChunks, 128LL));
-    }
+    quantity = qBound(4LL, quantity, 128LL);
 }
 
 void StorageManager::clearFile(const DownloadTypes::DownloadRecord &fileInfo){
-    if (m_files[fileInfo]->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        m_files[fileInfo]->close();
+    if (!m_files.contains(fileInfo)) return;
+
+    m_data.remove(fileInfo);
+
+    std::shared_ptr<QFile> file = m_files[fileInfo];
+    if (file->isOpen()) {
+        file->resize(0);
+    } else if (file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file->close();
     }
 }
 
 void StorageManager::closeFile(const DownloadTypes::DownloadRecord &fileInfo) {
-    flushAllData(fileInfo);
+    if (!m_files.contains(fileInfo)) return;
+
+    writeToDisk(fileInfo);
     if (m_files[fileInfo]->isOpen()) {
         m_files[fileInfo]->flush();
         m_files[fileInfo]->close();
     }
 }
 
+void StorageManager::finishFile(const DownloadTypes::DownloadRecord &fileInfo, qint64 finalSize) {
+    if (finalSize >= 0 && m_files.contains(fileInfo)) {
+        writeToDisk(fileInfo);
+        if (m_files[fileInfo]->isOpen() && !m_files[fileInfo]->resize(finalSize)) {
+            emit errorOccurred("Помилка зміни розміру файлу: " + m_files[fileInfo]->errorString());
+        }
+    }
+    closeFile(fileInfo);
+    emit savedLastChunk(fileInfo);
+}
+
 void StorageManager::deleteAllInfo(const DownloadTypes::DownloadRecord &fileInfo){
     closeFile(fileInfo);
     m_files.remove(fileInfo);
-    m_data.remove((fileInfo));
+    m_data.remove(fileInfo);
+    m_quantityOfChunks.remove(fileInfo);
+}
+
+void StorageManager::setCache(std::shared_ptr<DownloadCache> cache) {
+    m_cache = cache;
+}
+
+// Fills the target from a cached copy of the same content instead of the network.
+void StorageManager::materializeFile(const DownloadTypes::DownloadRecord &fileInfo, const QString &sourcePath) {
+    closeFile(fileInfo);
+    m_data.remove(fileInfo);
+
+    if (DownloadCache::materialize(sourcePath, fileInfo.filePath)) {
+        emit savedLastChunk(fileInfo);
+    } else {
+        qDebug() << "Could not restore" << fileInfo.filePath << "from cache";
+        emit materializeFailed(fileInfo);
+    }
+}
+
+void StorageManager::cacheFile(const DownloadTypes::DownloadRecord &fileInfo, const QString &url, const QString &etag, const QString &hash) {
+    if (!m_cache) return;
+
+    if (!m_cache->store(fileInfo.filePath, hash, url, etag)) {
+        qDebug() << "Could not cache" << fileInfo.filePath;
+    }
 }
@@ -0,0 +1,248 @@
+#include "../headers/streamdecoder.h"
+
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+struct StreamDecoder::State {
+    z_stream zlib{};
+    bool zlibReady{false};
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd{nullptr};
+#endif
+#ifdef HAVE_LZMA
+    lzma_stream lzma = LZMA_STREAM_INIT;
+    bool lzmaReady{false};
+#endif
+};
+
+StreamDecoder::StreamDecoder(Format format, QCryptographicHash::Algorithm algorithm) :
+    m_state(std::make_unique<State>()),
+    m_format(format),
+    m_compressedHash(algorithm),
+    m_decodedHash(algorithm)
+{
+    switch (m_format) {
+    case Gzip:
+        // 15 + 32 lets zlib detect gzip and zlib ("deflate") headers itself.
+        m_state->zlibReady = inflateInit2(&m_state->zlib, 15 + 32) == Z_OK;
+        m_error = !m_state->zlibReady;
+        break;
+    case Zstd:
+#ifdef HAVE_ZSTD
+        m_state->zstd = ZSTD_createDStream();
+        m_error = !m_state->zstd || ZSTD_isError(ZSTD_initDStream(m_state->zstd));
+#else
+        m_error = true;
+#endif
+        break;
+    case Xz:
+#ifdef HAVE_LZMA
+        m_state->lzmaReady = lzma_stream_decoder(&m_state->lzma, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+        m_error = !m_state->lzmaReady;
+#else
+        m_error = true;
+#endif
+        break;
+    case None:
+        break;
+    }
+}
+
+StreamDecoder::~StreamDecoder()
+{
+    if (m_state->zlibReady) inflateEnd(&m_state->zlib);
+#ifdef HAVE_ZSTD
+    if (m_state->zstd) ZSTD_freeDStream(m_state->zstd);
+#endif
+#ifdef HAVE_LZMA
+    if (m_state->lzmaReady) lzma_end(&m_state->lzma);
+#endif
+}
+
+StreamDecoder::Format StreamDecoder::formatForEncoding(const QString &contentEncoding)
+{
+    QString encoding = contentEncoding.trimmed().toLower();
+
+    if (encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate") return Gzip;
+    if (encoding == "zstd") return Zstd;
+    if (encoding == "xz") return Xz;
+    return None;
+}
+
+StreamDecoder::Format StreamDecoder::formatForFileName(const QString &fileName)
+{
+    QString name = fileName.toLower();
+
+    if (name.endsWith(".gz") || name.endsWith(".tgz")) return Gzip;
+    if (name.endsWith(".zst") || name.endsWith(".tzst")) return Zstd;
+    if (name.endsWith(".xz") || name.endsWith(".txz")) return Xz;
+    return None;
+}
+
+bool StreamDecoder::isSupported(Format format)
+{
+    switch (format) {
+    case Gzip:
+        return true;
+    case Zstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    case Xz:
+#ifdef HAVE_LZMA
+        return true;
+#else
+        return false;
+#endif
+    case None:
+        break;
+    }
+    return false;
+}
+
+QByteArray StreamDecoder::acceptEncoding()
+{
+    QByteArray encodings = "gzip, deflate";
+    if (isSupported(Zstd)) encodings += ", zstd";
+    return encodings;
+}
+
+QString StreamDecoder::decodedFileName(const QString &fileName)
+{
+    if (!isSupported(formatForFileName(fileName))) return fileName;
+
+    QString suffix = QString(".") + fileName.section('.', -1);
+    QString base = fileName.left(fileName.size() - suffix.size());
+
+    // .tgz, .tzst and .txz are tarballs.
+    if (suffix.size() > 3 && suffix.at(1).toLower() == 't') return base + ".tar";
+    return base;
+}
+
+bool StreamDecoder::decode(const char *data, qint64 size, QByteArray &out)
+{
+    if (m_error) return false;
+
+    m_compressedHash.addData(QByteArrayView(data, size));
+    m_compressedBytes += size;
+
+    return run(data, size, out, false);
+}
+
+bool StreamDecoder::finish(QByteArray &out)
+{
+    if (m_error) return false;
+
+    // A stream that stops before its end marker is truncated.
+    if (run(nullptr, 0, out, true) && !m_streamEnded) m_error = true;
+    return !m_error;
+}
+
+bool StreamDecoder::run(const char *data, qint64 size, QByteArray &out, bool finishing)
+{
+    qint64 start = out.size();
+    bool full = false;
+
+    switch (m_format) {
+    case Gzip: {
+        if (finishing) break;
+
+        z_stream &zlib = m_state->zlib;
+        zlib.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zlib.avail_in = static_cast<uInt>(size);
+
+        do {
+            qint64 offset = out.size();
+            out.resize(offset + OUTPUT_STEP);
+            zlib.next_out = reinterpret_cast<Bytef*>(out.data() + offset);
+            zlib.avail_out = static_cast<uInt>(OUTPUT_STEP);
+
+            int result = inflate(&zlib, Z_NO_FLUSH);
+            full = zlib.avail_out == 0;
+            out.resize(offset + OUTPUT_STEP - zlib.avail_out);
+
+            if (result == Z_STREAM_END) {
+                m_streamEnded = true;
+                if (zlib.avail_in == 0) break;
+
+                // Concatenated members (pigz, appended logs) continue after the end.
+                inflateReset(&zlib);
+                m_streamEnded = false;
+            } else if (result == Z_BUF_ERROR) {
+                break;
+            } else if (result != Z_OK) {
+                m_error = true;
+            }
+        } while (!m_error && (zlib.avail_in > 0 || full));
+        break;
+    }
+    case Zstd: {
+#ifdef HAVE_ZSTD
+        if (finishing) break;
+
+        ZSTD_inBuffer input{data, static_cast<size_t>(size), 0};
+
+        do {
+            qint64 offset = out.size();
+            out.resize(offset + OUTPUT_STEP);
+            ZSTD_outBuffer output{out.data() + offset, static_cast<size_t>(OUTPUT_STEP), 0};
+
+            size_t result = ZSTD_decompressStream(m_state->zstd, &output, &input);
+            full = output.pos == output.size;
+            out.resize(offset + output.pos);
+
+            if (ZSTD_isError(result)) {
+                m_error = true;
+            } else {
+                m_streamEnded = result == 0;
+            }
+        } while (!m_error && (input.pos < input.size || full));
+#endif
+        break;
+    }
+    case Xz: {
+#ifdef HAVE_LZMA
+        lzma_stream &lzma = m_state->lzma;
+        lzma.next_in = reinterpret_cast<const uint8_t*>(data);
+        lzma.avail_in = static_cast<size_t>(size);
+
+        do {
+            qint64 offset = out.size();
+            out.resize(offset + OUTPUT_STEP);
+            lzma.next_out = reinterpret_cast<uint8_t*>(out.data() + offset);
+            lzma.avail_out = static_cast<size_t>(OUTPUT_STEP);
+
+            lzma_ret result = lzma_code(&lzma, finishing ? LZMA_FINISH : LZMA_RUN);
+            full = lzma.avail_out == 0;
+            out.resize(offset + OUTPUT_STEP - lzma.avail_out);
+
+            if (result == LZMA_STREAM_END) {
+                m_streamEnded = true;
+                break;
+            } else if (result == LZMA_BUF_ERROR) {
+                break;
+            } else if (result != LZMA_OK) {
+                m_error = true;
+            }
+        } while (!m_error && (lzma.avail_in > 0 || full));
+#endif
+        break;
+    }
+    case None:
+        out.append(data, size);
+        m_streamEnded = true;
+        break;
+    }
+
+    m_decodedHash.addData(QByteArrayView(out.constData() + start, out.size() - start));
+    m_decodedBytes += out.size() - start;
+
+    return !m_error;
+}
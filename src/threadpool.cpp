@@ -23,7 +23,7 @@ void ThreadPool::addTask(std::shared_ptr<DownloadTask> task){
         }
     }
 
-    if(!m_idleThreads.isEmpty())
+    if(!m_idleThreads.isEmpty() || findBatchThread(task))
     {
         startNewTask(task);
     }else
@@ -83,12 +83,16 @@ void ThreadPool::addTaskFromDB(std::shared_ptr<DownloadTask> task){
 
 void ThreadPool::startNewTask(std::shared_ptr<DownloadTask> task){
     QMutexLocker locker(&m_mutex);
-    if(m_idleThreads.isEmpty() || !task)
+    if(!task)
     {
         return;
     }
 
-    QThread *workerThread = m_idleThreads.takeFirst();
+    QThread *workerThread = acquireThread(task);
+    if(!workerThread)
+    {
+        return;
+    }
 
     if (task->thread() == QThread::currentThread()) {
         task->moveToThread(workerThread);
@@ -98,7 +102,7 @@ void ThreadPool::startNewTask(std::shared_ptr<DownloadTask> task){
         }, Qt::BlockingQueuedConnection);
     }
 
-    m_busyThreads[workerThread] = task;
+    m_busyThreads.insert(workerThread, task);
 
     QMetaObject::invokeMethod(task.get(), "startDownload", Qt::QueuedConnection);
 }
@@ -112,7 +116,9 @@ void ThreadPool::resumeDownload(std::shared_ptr<DownloadTask> task){
         }, Qt::BlockingQueuedConnection);
     }
 
-    if(m_idleThreads.isEmpty())
+    QThread *workerThread = acquireThread(task);
+
+    if(!workerThread)
     {
         task->setStatus(DownloadTask::Status::ResumedInPending);
         m_pendingQueue.enqueue(task);
@@ -121,8 +127,6 @@ void ThreadPool::resumeDownload(std::shared_ptr<DownloadTask> task){
     {
         task->setStatus(DownloadTask::Status::ResumedInDownloading);
 
-        QThread *workerThread = m_idleThreads.takeFirst();
-
         if (task->thread() == QThread::currentThread()) {
             task->moveToThread(workerThread);
         } else {
@@ -131,7 +135,7 @@ void ThreadPool::resumeDownload(std::shared_ptr<DownloadTask> task){
             }, Qt::BlockingQueuedConnection);
         }
 
-        m_busyThreads[workerThread] = task;
+        m_busyThreads.insert(workerThread, task);
 
         QMetaObject::invokeMethod(task.get(), "resumeDownload", Qt::QueuedConnection);
     }
@@ -172,8 +176,7 @@ void ThreadPool::stopAllDownloads(QVector<std::shared_ptr<DownloadTask>>& tasks)
                         }, Qt::BlockingQueuedConnection);
                     }
 
-                this->returnThreadToPool(thread);
-                this->m_busyThreads.remove(thread);
+                this->releaseTask(thread, taskPtr);
 
                 (*remaining)--;
                 if (*remaining <= 0) {
@@ -221,8 +224,7 @@ void ThreadPool::onTaskPaused(std::shared_ptr<DownloadTask> task){
                         task->moveToThread(workerThread);
                     }, Qt::BlockingQueuedConnection);
                 }
-                this->returnThreadToPool(thread);
-                this->m_busyThreads.remove(thread);
+                this->releaseTask(thread, task);
                 this->startNextTask();
             }
         }, static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::SingleShotConnection));
@@ -245,14 +247,16 @@ void ThreadPool::removeTask(std::shared_ptr<DownloadTask> task){
     }
 
     task->moveToThread(this->thread());
-    this->returnThreadToPool(thread);
-    this->m_busyThreads.remove(thread);
+    if(thread)
+    {
+        this->releaseTask(thread, task);
+    }
     this->startNextTask();
 }
 
-void ThreadPool::chackWhatStatus(DownloadTask::Status status){
-    DownloadTask* rawTask = qobject_cast<DownloadTask*>(sender());
-
+// Statuses arrive through DownloadRegistry, so the task is passed in rather
+// than taken from sender().
+void ThreadPool::chackWhatStatus(DownloadTask *rawTask, DownloadTask::Status status){
     std::shared_ptr<DownloadTask> task;
 
     QMutexLocker locker(&m_mutex);
@@ -321,11 +325,25 @@ void ThreadPool::chackWhatStatus(DownloadTask::Status status){
 void ThreadPool::startNextTask()
 {
     QMutexLocker locker(&m_mutex);
-    if(m_pendingQueue.isEmpty() || m_idleThreads.isEmpty())
+    if(m_pendingQueue.isEmpty())
     {
         return;
     }
-    std::shared_ptr<DownloadTask> task = m_pendingQueue.dequeue();
+
+    // With every thread busy, a small task can still join a running batch.
+    qsizetype next = 0;
+    if(m_idleThreads.isEmpty())
+    {
+        while(next < m_pendingQueue.size() && !findBatchThread(m_pendingQueue.at(next)))
+        {
+            ++next;
+        }
+        if(next == m_pendingQueue.size())
+        {
+            return;
+        }
+    }
+    std::shared_ptr<DownloadTask> task = m_pendingQueue.takeAt(next);
 
     if(task->getStatus() == DownloadTask::Status::Pending || task->getStatus() == DownloadTask::Status::Prepared)
     {
@@ -360,8 +378,7 @@ void ThreadPool::onTaskFinished(std::shared_ptr<DownloadTask> task){
             QCoreApplication::processEvents();
         }
 
-        returnThreadToPool(thread);
-        m_busyThreads.remove(thread);
+        releaseTask(thread, task);
 
     }
 
@@ -382,6 +399,78 @@ void ThreadPool::returnThreadToPool(QThread* thread)
     }
 }
 
+void ThreadPool::releaseTask(QThread* thread, std::shared_ptr<DownloadTask> task)
+{
+    QMutexLocker locker(&m_mutex);
+    m_busyThreads.remove(thread, task);
+
+    if(!m_busyThreads.contains(thread))
+    {
+        returnThreadToPool(thread);
+    }
+}
+
+QThread* ThreadPool::acquireThread(std::shared_ptr<DownloadTask> task)
+{
+    QMutexLocker locker(&m_mutex);
+    if(QThread *batchThread = findBatchThread(task))
+    {
+        return batchThread;
+    }
+
+    if(m_idleThreads.isEmpty())
+    {
+        return nullptr;
+    }
+
+    return m_idleThreads.takeFirst();
+}
+
+// Small files from the same origin share one worker thread, and therefore one
+// NetworkSession manager, so their requests run as concurrent streams over
+// the same HTTP/2 connection instead of occupying a thread each.
+QThread* ThreadPool::findBatchThread(std::shared_ptr<DownloadTask> task) const
+{
+    QMutexLocker locker(&m_mutex);
+    if(!m_batchMode || !isBatchable(task))
+    {
+        return nullptr;
+    }
+
+    const QString origin = task->getOrigin();
+    for(QThread *thread : m_busyThreads.uniqueKeys())
+    {
+        const QList<std::shared_ptr<DownloadTask>> tasks = m_busyThreads.values(thread);
+        if(tasks.size() >= MAX_STREAMS_PER_BATCH)
+        {
+            continue;
+        }
+
+        bool sameBatch = std::all_of(tasks.begin(), tasks.end(), [this, &origin](const std::shared_ptr<DownloadTask> &t){
+            return isBatchable(t) && t->getOrigin() == origin;
+        });
+
+        if(sameBatch)
+        {
+            return thread;
+        }
+    }
+
+    return nullptr;
+}
+
+bool ThreadPool::isBatchable(std::shared_ptr<DownloadTask> task) const
+{
+    qint64 size = task->getFileInfo().totalBytes;
+    return size > 0 && size <= BATCH_FILE_LIMIT;
+}
+
+void ThreadPool::setBatchMode(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_batchMode = enabled;
+}
+
 void ThreadPool::calculateMaxThreads(){
     int cores = QThread::idealThreadCount();
     if (cores <= 0) cores = 2;
@@ -390,11 +479,11 @@ void ThreadPool::calculateMaxThreads(){
 }
 
 ThreadPool::~ThreadPool(){
-    for(auto it = m_busyThreads.begin(); it != m_busyThreads.end(); ++it)
+    for(QThread *thread : m_busyThreads.uniqueKeys())
     {
-        it.key()->quit();
-        it.key()->wait();
-        it.key()->deleteLater();
+        thread->quit();
+        thread->wait();
+        thread->deleteLater();
     }
 
     for(auto it : m_idleThreads)
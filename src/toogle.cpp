@@ -11,25 +11,33 @@ void Toogle::paintEvent(QPaintEvent * event){
     Q_UNUSED(event);
 
     QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing);
+    paintSwitch(&painter, QRect(0, 0, width(), height()), isChecked(), m_bgColor, m_circleColor, m_activeColor);
+    painter.end();
+}
 
-    painter.setPen(Qt::NoPen);
+void Toogle::paintSwitch(QPainter *painter, const QRect &rect, bool checked,
+                         const QColor& bgColor, const QColor& circleColor, const QColor& activeColor){
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
 
-    QRect rect(0, 0, width(), height());
+    painter->setPen(Qt::NoPen);
 
-    if(isChecked()){
-        painter.setBrush(QBrush(m_activeColor));
-        painter.drawRoundedRect(0, 0, rect.width(), height(), height() / 2, height() / 2);
+    int radius = rect.height() / 2;
+    int circle = rect.height() - 2;
 
-        painter.setBrush(QColor(m_circleColor));
-        painter.drawEllipse(width() - 10, 1, 8, 8);
+    if(checked){
+        painter->setBrush(QBrush(activeColor));
+        painter->drawRoundedRect(rect, radius, radius);
+
+        painter->setBrush(QColor(circleColor));
+        painter->drawEllipse(rect.x() + rect.width() - circle - 2, rect.top() + 1, circle, circle);
     }else{
-        painter.setBrush(QBrush(m_bgColor));
-        painter.drawRoundedRect(0, 0, rect.width(), height(), height() / 2, height() / 2);
+        painter->setBrush(QBrush(bgColor));
+        painter->drawRoundedRect(rect, radius, radius);
 
-        painter.setBrush(QColor(m_circleColor));
-        painter.drawEllipse(1, 1, 8, 8);
+        painter->setBrush(QColor(circleColor));
+        painter->drawEllipse(rect.left() + 1, rect.top() + 1, circle, circle);
     }
 
-    painter.end();
+    painter->restore();
 }
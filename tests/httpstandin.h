@@ -0,0 +1,107 @@
+#ifndef HTTPSTANDIN_H
+#define HTTPSTANDIN_H
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QRegularExpression>
+#include <QHash>
+#include <QMap>
+
+// Minimal HTTP/1.1 server with Range and If-Range support, serving fixed
+// bodies by path.
+class HttpStandIn
+{
+public:
+    HttpStandIn() {
+        m_server.listen(QHostAddress::LocalHost);
+        QObject::connect(&m_server, &QTcpServer::newConnection, &m_server, [this](){
+            while(QTcpSocket *socket = m_server.nextPendingConnection()){
+                QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket](){ handle(socket); });
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+    }
+
+    void serve(const QString &path, const QByteArray &body, const QByteArray &etag = QByteArray(),
+               const QByteArray &lastModified = QByteArray()) {
+        m_files[path] = body;
+        m_validators[path] = qMakePair(etag, lastModified);
+    }
+    void redirect(const QString &from, const QString &to) { m_redirects[from] = to; }
+    QString url(const QString &path) const {
+        return QString("http://127.0.0.1:%1%2").arg(m_server.serverPort()).arg(path);
+    }
+    int requests() const { return m_requests; }
+    int lastStatus() const { return m_lastStatus; }
+    void setRangeSupport(bool enabled) { m_rangeSupport = enabled; }
+
+private:
+    QTcpServer m_server;
+    QMap<QString, QByteArray> m_files;
+    QMap<QString, QString> m_redirects;
+    QMap<QString, QPair<QByteArray, QByteArray>> m_validators;
+    QHash<QTcpSocket*, QByteArray> m_pending;
+    int m_requests{0};
+    int m_lastStatus{0};
+    bool m_rangeSupport{true};
+
+    void handle(QTcpSocket *socket) {
+        QByteArray &request = m_pending[socket];
+        request += socket->readAll();
+        if(!request.contains("\r\n\r\n")) return;
+
+        ++m_requests;
+        QString head = QString::fromLatin1(request);
+        m_pending.remove(socket);
+
+        QString path = head.section(' ', 1, 1);
+        if(m_redirects.contains(path)){
+            m_lastStatus = 302;
+            socket->write("HTTP/1.1 302 Found\r\nLocation: " + url(m_redirects.value(path)).toLatin1() +
+                          "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            socket->disconnectFromHost();
+            return;
+        }
+        if(!m_files.contains(path)){
+            m_lastStatus = 404;
+            socket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            socket->disconnectFromHost();
+            return;
+        }
+
+        QByteArray body = m_files.value(path);
+        QByteArray status = "200 OK";
+        QByteArray extra;
+
+        const auto [etag, lastModified] = m_validators.value(path);
+        if(!etag.isEmpty()) extra += "ETag: " + etag + "\r\n";
+        if(!lastModified.isEmpty()) extra += "Last-Modified: " + lastModified + "\r\n";
+
+        // A Range guarded by a validator that no longer matches gets the whole body.
+        bool validatorMatches = true;
+        QRegularExpressionMatch ifRange = QRegularExpression("^If-Range: ([^\\r]*)", QRegularExpression::CaseInsensitiveOption |
+                                                             QRegularExpression::MultilineOption).match(head);
+        if(ifRange.hasMatch()){
+            QByteArray validator = ifRange.captured(1).toLatin1();
+            validatorMatches = !validator.isEmpty() && (validator == etag || validator == lastModified);
+        }
+
+        QRegularExpressionMatch range = QRegularExpression("^Range: bytes=(\\d+)-(\\d*)", QRegularExpression::CaseInsensitiveOption |
+                                                           QRegularExpression::MultilineOption).match(head);
+        if(m_rangeSupport && validatorMatches && range.hasMatch()){
+            qint64 first = range.captured(1).toLongLong();
+            qint64 last = range.captured(2).isEmpty() ? body.size() - 1 : qMin<qint64>(range.captured(2).toLongLong(), body.size() - 1);
+            extra += QString("Content-Range: bytes %1-%2/%3\r\n").arg(first).arg(last).arg(body.size()).toLatin1();
+            status = "206 Partial Content";
+            body = body.mid(first, last - first + 1);
+        }
+
+        m_lastStatus = status.left(3).toInt();
+        socket->write("HTTP/1.1 " + status + "\r\n" + extra +
+                      (m_rangeSupport ? "Accept-Ranges: bytes\r\n" : "") + "Content-Length: " + QByteArray::number(body.size()) +
+                      "\r\nConnection: close\r\n\r\n" + body);
+        socket->disconnectFromHost();
+    }
+};
+
+#endif // HTTPSTANDIN_H
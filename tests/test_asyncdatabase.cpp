@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <QTemporaryDir>
+#include "asyncdatabase.h"
+
+class AsyncDatabaseTest : public ::testing::Test {
+protected:
+    QTemporaryDir dir;
+
+    DownloadRecord makeRecord(const QString &url, qint64 downloadedBytes) {
+        DownloadRecord record;
+        record.m_name = "file.bin";
+        record.m_url = url;
+        record.m_filePath = dir.filePath("file.bin");
+        record.m_status = DownloadRecord::statusCode("downloading");
+        record.m_totalBytes = 10 * 1024 * 1024;
+        record.m_downloadedBytes = downloadedBytes;
+        return record;
+    }
+
+    template <typename T>
+    T await(QFuture<T> future) {
+        future.waitForFinished();
+        return future.result();
+    }
+};
+
+TEST_F(AsyncDatabaseTest, LoadSeesWritesQueuedBeforeIt){
+    AsyncDatabase db(dir.filePath("download.db"));
+
+    db.save({makeRecord("https://example.com/a", 1024), makeRecord("https://example.com/b", 2048)});
+    QVector<DownloadRecord> loaded = await(db.loadDownloads());
+
+    ASSERT_EQ(loaded.size(), 2);
+    EXPECT_EQ(loaded[0].m_downloadedBytes + loaded[1].m_downloadedBytes, 3072);
+    EXPECT_EQ(db.pendingCount(), 0);
+}
+
+TEST_F(AsyncDatabaseTest, RepeatedUpdatesAreCoalesced){
+    AsyncDatabase db(dir.filePath("download.db"));
+
+    for(int i = 1; i <= 100; ++i){
+        db.save(makeRecord("https://example.com/a", i * 1024));
+        EXPECT_LE(db.pendingCount(), 1);
+    }
+
+    QVector<DownloadRecord> loaded = await(db.loadDownloads());
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0].m_downloadedBytes, 100 * 1024);
+}
+
+TEST_F(AsyncDatabaseTest, RemoveCancelsQueuedSave){
+    AsyncDatabase db(dir.filePath("download.db"));
+
+    db.save(makeRecord("https://example.com/a", 1024));
+    await(db.loadDownloads());
+
+    db.save(makeRecord("https://example.com/a", 4096));
+    db.remove("https://example.com/a");
+
+    EXPECT_TRUE(await(db.loadDownloads()).isEmpty());
+}
+
+TEST_F(AsyncDatabaseTest, FlushResolvesAfterCommit){
+    QString path = dir.filePath("download.db");
+    {
+        AsyncDatabase db(path);
+        db.save(makeRecord("https://example.com/a", 1024));
+        EXPECT_TRUE(await(db.flush()));
+
+        DownloadDatabase reader(path, nullptr, "reader");
+        EXPECT_EQ(reader.getDownloads().size(), 1);
+    }
+
+    AsyncDatabase reopened(path);
+    EXPECT_EQ(await(reopened.loadDownloads()).size(), 1);
+}
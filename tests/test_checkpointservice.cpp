@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QtTest/QTest>
+#include "checkpointservice.h"
+
+class CheckpointServiceTest : public ::testing::Test {
+protected:
+    QTemporaryDir dir;
+    AsyncDatabase *database;
+    DownloadRegistry registry;
+    CheckpointService *service;
+
+    void SetUp() override {
+        database = new AsyncDatabase(dir.filePath("download.db"));
+        service = new CheckpointService(database, &registry);
+        // Only the tests decide when a round starts.
+        service->setInterval(60 * 60 * 1000);
+    }
+
+    void TearDown() override {
+        delete service;
+        delete database;
+    }
+
+    // Adds a download to the registry and a task for it on this thread.
+    std::shared_ptr<DownloadTask> addDownload(const QString &name) {
+        DownloadTypes::DownloadRecord fields;
+        fields.id = QUuid::createUuid();
+        fields.name = name;
+        fields.url = "https://example.com/" + name;
+        fields.filePath = dir.filePath(name);
+        fields.totalBytes = 10 * 1024 * 1024;
+        fields.status = DownloadTypes::DownloadStatus::Downloading;
+
+        auto task = std::make_shared<DownloadTask>(fields.url, fields);
+        registry.addRecord(std::move(fields));
+        return task;
+    }
+
+    // Registry signals, task snapshots and the collected batch each take one
+    // trip through the event loop.
+    void settle() {
+        for (int i = 0; i < 5; ++i) QCoreApplication::processEvents();
+    }
+
+    QStringList savedUrls() {
+        QFuture<QVector<DownloadRecord>> future = database->loadDownloads();
+        future.waitForFinished();
+        QStringList urls;
+        for (const auto &record : future.result()) urls << record.m_url;
+        urls.sort();
+        return urls;
+    }
+};
+
+TEST_F(CheckpointServiceTest, OnlyChangedTrackedDownloadsAreSaved){
+    auto changed = addDownload("a.bin");
+    auto idle = addDownload("b.bin");
+    auto untracked = addDownload("c.bin");
+    service->track(changed->getFileInfo().id, changed);
+    service->track(idle->getFileInfo().id, idle);
+
+    registry.updateStatus(changed->getFileInfo().id, DownloadTypes::DownloadStatus::Paused);
+    registry.updateStatus(untracked->getFileInfo().id, DownloadTypes::DownloadStatus::Paused);
+    settle();
+    service->flush();
+    settle();
+
+    EXPECT_EQ(savedUrls(), QStringList{"https://example.com/a.bin"});
+}
+
+TEST_F(CheckpointServiceTest, ByteThresholdStartsRoundWithoutTimer){
+    service->setByteThreshold(1000);
+    auto task = addDownload("a.bin");
+    const QUuid id = task->getFileInfo().id;
+    service->track(id, task);
+
+    registry.updateProgress(id, 400, 10000);
+    settle();
+    EXPECT_TRUE(savedUrls().isEmpty());
+
+    registry.updateProgress(id, 1200, 10000);
+    settle();
+    EXPECT_EQ(savedUrls(), QStringList{"https://example.com/a.bin"});
+}
+
+TEST_F(CheckpointServiceTest, ForgottenDownloadIsNotWrittenBack){
+    auto before = addDownload("a.bin");
+    auto during = addDownload("b.bin");
+    service->track(before->getFileInfo().id, before);
+    service->track(during->getFileInfo().id, during);
+
+    registry.updateStatus(before->getFileInfo().id, DownloadTypes::DownloadStatus::Paused);
+    registry.updateStatus(during->getFileInfo().id, DownloadTypes::DownloadStatus::Paused);
+    settle();
+
+    // One is dropped before the round, the other while its snapshot is on the way.
+    service->forget(before->getFileInfo().id);
+    service->flush();
+    service->forget(during->getFileInfo().id);
+    settle();
+
+    EXPECT_TRUE(savedUrls().isEmpty());
+}
+
+TEST_F(CheckpointServiceTest, RoundIsAbandonedAfterTimeout){
+    service->setRoundTimeout(200);
+
+    // This task's thread never runs, so its snapshot never arrives.
+    QThread stalled;
+    auto stuck = addDownload("a.bin");
+    stuck->moveToThread(&stalled);
+    auto healthy = addDownload("b.bin");
+    service->track(stuck->getFileInfo().id, stuck);
+    service->track(healthy->getFileInfo().id, healthy);
+
+    registry.updateStatus(stuck->getFileInfo().id, DownloadTypes::DownloadStatus::Paused);
+    settle();
+    service->flush();
+    settle();
+
+    registry.updateStatus(healthy->getFileInfo().id, DownloadTypes::DownloadStatus::Paused);
+    settle();
+    service->flush();
+    settle();
+    EXPECT_TRUE(savedUrls().isEmpty());
+
+    // The next round asks the stuck task again alongside the healthy one, and
+    // keeps the healthy snapshot when it is abandoned in turn.
+    QTest::qWait(250);
+    service->flush();
+    settle();
+    EXPECT_TRUE(savedUrls().isEmpty());
+
+    QTest::qWait(250);
+    service->flush();
+    settle();
+    EXPECT_EQ(savedUrls(), QStringList{"https://example.com/b.bin"});
+
+    // Snapshots for the abandoned rounds are dropped; the current one is saved.
+    QMetaObject::invokeMethod(stuck.get(), [&stalled](){ stalled.quit(); }, Qt::QueuedConnection);
+    stalled.start();
+    stalled.wait();
+    settle();
+    EXPECT_EQ(savedUrls(), (QStringList{"https://example.com/a.bin", "https://example.com/b.bin"}));
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include "chunkbitmap.h"
+
+TEST(ChunkBitmapTest, TracksOutOfOrderChunks){
+    ChunkBitmap bitmap(10);
+    bitmap.set(0);
+    bitmap.set(1);
+    bitmap.set(5);
+    bitmap.set(9);
+
+    EXPECT_EQ(bitmap.completedCount(), 4);
+    EXPECT_EQ(bitmap.firstMissing(), 2);
+    EXPECT_EQ(bitmap.firstMissing(5), 6);
+    EXPECT_FALSE(bitmap.isComplete());
+
+    auto runs = bitmap.missingRuns();
+    ASSERT_EQ(runs.size(), 2);
+    EXPECT_EQ(runs[0], qMakePair(2, 4));
+    EXPECT_EQ(runs[1], qMakePair(6, 8));
+}
+
+TEST(ChunkBitmapTest, GrowsWhenSizeIsUnknown){
+    ChunkBitmap bitmap;
+    bitmap.set(3);
+
+    EXPECT_EQ(bitmap.size(), 4);
+    EXPECT_TRUE(bitmap.test(3));
+    EXPECT_FALSE(bitmap.test(7));
+}
+
+TEST(ChunkBitmapTest, CompletedBytesAccountsForShortLastChunk){
+    const qint64 chunkSize = 1024 * 1024;
+    const qint64 totalBytes = 2 * chunkSize + 100;
+
+    ChunkBitmap bitmap(3);
+    bitmap.set(0);
+    EXPECT_EQ(bitmap.completedBytes(chunkSize, totalBytes), chunkSize);
+
+    bitmap.set(2);
+    EXPECT_EQ(bitmap.completedBytes(chunkSize, totalBytes), chunkSize + 100);
+
+    bitmap.set(1);
+    EXPECT_TRUE(bitmap.isComplete());
+    EXPECT_EQ(bitmap.completedBytes(chunkSize, totalBytes), totalBytes);
+}
+
+TEST(ChunkBitmapTest, RleRoundTrip){
+    ChunkBitmap bitmap(100000);
+    for(int i = 0; i < 70000; ++i) bitmap.set(i);
+    for(int i = 80000; i < 80010; ++i) bitmap.set(i);
+    bitmap.set(99999);
+
+    QByteArray encoded = bitmap.toRle();
+    EXPECT_LT(encoded.size(), 20);
+    EXPECT_EQ(ChunkBitmap::fromRle(encoded), bitmap);
+}
+
+TEST(ChunkBitmapTest, RleOfEmptyAndFullBitmaps){
+    EXPECT_TRUE(ChunkBitmap().toRle().isEmpty());
+    EXPECT_TRUE(ChunkBitmap::fromRle(QByteArray()).isEmpty());
+
+    ChunkBitmap none(5);
+    EXPECT_EQ(ChunkBitmap::fromRle(none.toRle()), none);
+
+    ChunkBitmap all(5);
+    for(int i = 0; i < 5; ++i) all.set(i);
+    ChunkBitmap decoded = ChunkBitmap::fromRle(all.toRle());
+    EXPECT_EQ(decoded, all);
+    EXPECT_TRUE(decoded.isComplete());
+}
+
+TEST(ChunkBitmapTest, MalformedRleIsRejected){
+    // Runs add up to more chunks than the header declares.
+    EXPECT_TRUE(ChunkBitmap::fromRle(QByteArray("\x03\x02\x05", 3)).isEmpty());
+    // Runs stop short of the declared count.
+    EXPECT_TRUE(ChunkBitmap::fromRle(QByteArray("\x08\x02\x01", 3)).isEmpty());
+    // Truncated varint.
+    EXPECT_TRUE(ChunkBitmap::fromRle(QByteArray("\x80", 1)).isEmpty());
+}
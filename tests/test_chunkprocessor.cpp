@@ -1,6 +1,38 @@
 #include <gtest/gtest.h>
 #include <QtTest/QSignalSpy>
+#include <QtTest/QTest>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <iostream>
+#include <cstring>
 #include "chunkprocessor.h"
+#include "progressthrottle.h"
+#include "downloadtypes.h"
+#include "downloadtask.h"
+#include "networkmanager.h"
+#include "httpstandin.h"
+
+// Socket stand-in that counts the bytes it copies out to readers.
+class CountingDevice : public QIODevice {
+public:
+    explicit CountingDevice(const QByteArray &data) : m_data(data) { open(QIODevice::ReadOnly | QIODevice::Unbuffered); }
+    qint64 copied() const { return m_copied; }
+    qint64 bytesAvailable() const override { return m_data.size() - m_position + QIODevice::bytesAvailable(); }
+    bool isSequential() const override { return true; }
+protected:
+    qint64 readData(char *data, qint64 maxSize) override {
+        qint64 count = qMin(maxSize, m_data.size() - m_position);
+        std::memcpy(data, m_data.constData() + m_position, count);
+        m_position += count;
+        m_copied += count;
+        return count;
+    }
+    qint64 writeData(const char *, qint64) override { return -1; }
+private:
+    QByteArray m_data;
+    qint64 m_position{0};
+    qint64 m_copied{0};
+};
 
 class ChunkProcessorTest : public ::testing::Test {
 protected:
@@ -124,3 +156,216 @@ TEST_F(ChunkProcessorTest, IgnorEmptyData){
     EXPECT_EQ(spy.count(), 0);
 }
 
+
+TEST_F(ChunkProcessorTest, ReadFromDeviceFillsChunks){
+    QSignalSpy spy(&processor, &ChunkProcessor::chunkReady);
+
+    QByteArray payload("12345678901234567890ABC");
+    QBuffer device(&payload);
+    device.open(QIODevice::ReadOnly);
+
+    EXPECT_EQ(processor.readFrom(&device), payload.size());
+
+    ASSERT_EQ(spy.count(), 2);
+    EXPECT_EQ(spy.at(0).at(1).toByteArray(), "1234567890");
+    EXPECT_EQ(spy.at(1).at(1).toByteArray(), "1234567890");
+
+    processor.finalize();
+    ASSERT_EQ(spy.count(), 3);
+    EXPECT_EQ(spy.at(2).at(1).toByteArray(), "ABC");
+
+    EXPECT_EQ(processor.getBytesReceived(), payload.size());
+}
+
+TEST_F(ChunkProcessorTest, ShortFinalChunkIsNotPooled){
+    QSignalSpy spy(&processor, &ChunkProcessor::chunkReady);
+
+    processor.processData("12345678901234567890ABC");
+    EXPECT_EQ(processor.getPooledBytes(), 20);
+
+    processor.finalize();
+    ASSERT_EQ(spy.count(), 3);
+    EXPECT_EQ(processor.getPooledBytes(), 20);
+}
+
+TEST(ChunkPoolTest, PoolIsCappedInBytes){
+    const qint64 MiB = 1024 * 1024;
+    ChunkProcessor processor;
+    processor.setChunkSize(16 * MiB);
+
+    // Every chunk is still held by the consumer, so none can be reused.
+    QVector<QByteArray> held;
+    QObject::connect(&processor, &ChunkProcessor::chunkReady, [&held](int, const QByteArray &data, const QByteArray &){
+        held.append(data);
+    });
+
+    QByteArray block(MiB, 'p');
+    for (int i = 0; i < 4 * 16; ++i) processor.processData(block);
+
+    EXPECT_EQ(held.size(), 4);
+    EXPECT_EQ(processor.getPooledBytes(), 32 * MiB);
+}
+
+TEST(ChunkSizeTest, GrowsWithFileSize){
+    const qint64 MiB = 1024 * 1024;
+
+    EXPECT_EQ(DownloadTypes::chunkSizeFor(0), DownloadTypes::DEFAULT_CHUNK_SIZE);
+    EXPECT_EQ(DownloadTypes::chunkSizeFor(3 * MiB), 256 * 1024);
+    EXPECT_EQ(DownloadTypes::chunkSizeFor(100 * MiB), MiB);
+    EXPECT_EQ(DownloadTypes::chunkSizeFor(1024 * MiB), 4 * MiB);
+    EXPECT_EQ(DownloadTypes::chunkSizeFor(4096 * MiB), 8 * MiB);
+    EXPECT_EQ(DownloadTypes::chunkSizeFor(50000 * MiB), 16 * MiB);
+}
+
+TEST(ChunkSizeTest, ProcessorUsesConfiguredSize){
+    ChunkProcessor processor;
+    processor.setChunkSize(256 * 1024);
+    QSignalSpy spy(&processor, &ChunkProcessor::chunkReady);
+
+    processor.processData(QByteArray(600 * 1024, 'c'));
+    processor.finalize();
+
+    ASSERT_EQ(spy.count(), 3);
+    EXPECT_EQ(spy[0][1].toByteArray().size(), 256 * 1024);
+    EXPECT_EQ(spy[1][1].toByteArray().size(), 256 * 1024);
+    EXPECT_EQ(spy[2][1].toByteArray().size(), 88 * 1024);
+}
+
+// Counts the queued calls delivered to the objects it is installed on.
+class MetaCallCounter : public QObject {
+public:
+    qint64 count{0};
+    bool eventFilter(QObject *, QEvent *event) override {
+        if (event->type() == QEvent::MetaCall) ++count;
+        return false;
+    }
+};
+
+// Run with --gtest_also_run_disabled_tests to measure the per-task data path:
+// a NetworkManager reading from HttpStandIn, a ChunkProcessor and a
+// DownloadTask receiving the chunks, wired with queued connections as they
+// used to be and with the direct calls DownloadTask uses now. Posted events
+// are the queued calls inside the pipeline plus one write and one published
+// progress report per event that leaves the task's thread.
+TEST(ChunkPipelineTest, DISABLED_BenchmarkEventsPerMiB){
+    const qint64 MiB = 1024 * 1024;
+    const qint64 total = 64 * MiB;
+    const qint64 chunkSize = DownloadTypes::chunkSizeFor(total);
+
+    HttpStandIn server;
+    QByteArray body(total, Qt::Uninitialized);
+    for (qint64 i = 0; i < total; ++i) body[i] = static_cast<char>(i * 31 % 251);
+    server.serve("/pipeline.bin", body);
+
+    auto run = [&](Qt::ConnectionType type) {
+        DownloadTypes::DownloadRecord info;
+        info.id = QUuid::createUuid();
+        info.name = "pipeline.bin";
+        info.totalBytes = total;
+        info.chunkSize = chunkSize;
+        info.expectedHash = QString(64, 'a');
+        DownloadTask task(server.url("/pipeline.bin"), info);
+
+        NetworkManager manager;
+        ChunkProcessor processor;
+        processor.setChunkSize(chunkSize);
+        QObject progressSink;
+        ProgressThrottle throttle;
+
+        MetaCallCounter counter;
+        processor.installEventFilter(&counter);
+        task.installEventFilter(&counter);
+        progressSink.installEventFilter(&counter);
+
+        if (type == Qt::DirectConnection) {
+            manager.setChunkProcessor(&processor);
+        } else {
+            QObject::connect(&manager, &NetworkManager::dataReceived, &processor, &ChunkProcessor::processData, type);
+        }
+        QObject::connect(&processor, &ChunkProcessor::chunkReady, &task, &DownloadTask::saveAndWriteChunckHash, type);
+        QObject::connect(&manager, &NetworkManager::downloadProgress, &progressSink, [&throttle](qint64 received, qint64 bytesTotal){
+            throttle.shouldPublish(received, bytesTotal);
+        }, type);
+        QObject::connect(&manager, &NetworkManager::finished, &processor, &ChunkProcessor::finalize, type);
+
+        // Socket to storage enqueue: from the read that completed a chunk to its write.
+        QElapsedTimer sinceRead;
+        qint64 latencyNs = 0;
+        qint64 writes = 0;
+        QObject::connect(&manager, &NetworkManager::downloadProgress, [&sinceRead](qint64, qint64){ sinceRead.start(); });
+        QObject::connect(&task, &DownloadTask::writeChunk, [&](const DownloadTypes::DownloadRecord &, int, const QByteArray &){
+            ++writes;
+            latencyNs += sinceRead.nsecsElapsed();
+        });
+
+        const qint64 expectedWrites = (total + chunkSize - 1) / chunkSize;
+        QElapsedTimer timer;
+        timer.start();
+        manager.startDownload(QUrl(server.url("/pipeline.bin")));
+        EXPECT_TRUE(QTest::qWaitFor([&](){ return writes == expectedWrites; }, 60000));
+        qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+
+        double mib = double(total) / MiB;
+        std::cout << (type == Qt::DirectConnection ? "direct: " : "queued: ")
+                  << (counter.count + writes + throttle.publishedCount()) / mib << " posted events per MiB ("
+                  << counter.count << " queued calls, " << writes << " writes, "
+                  << throttle.publishedCount() << " progress reports, " << throttle.suppressedCount() << " suppressed)\n"
+                  << "        socket -> write enqueue: " << (writes ? latencyNs / writes / 1000.0 : 0) << " us average, "
+                  << mib * 1000 / elapsedMs << " MiB/s" << std::endl;
+    };
+
+    run(Qt::QueuedConnection);
+    run(Qt::DirectConnection);
+}
+
+// Compares the old onReadyRead path, readAll() into a QByteArray and then
+// processData(), with readFrom() straight into the chunk buffer on the same
+// payload. processData() copies every byte it is given once more.
+TEST(ChunkPipelineTest, DISABLED_BenchmarkReadAllAgainstReadFrom){
+    const qint64 MiB = 1024 * 1024;
+    const qint64 total = 256 * MiB;
+    const qint64 readSize = 64 * 1024;
+
+    QByteArray block(readSize, Qt::Uninitialized);
+    for (qint64 i = 0; i < readSize; ++i) block[i] = static_cast<char>(i * 31 % 251);
+
+    auto run = [&](bool direct, QVector<QByteArray> &hashes) {
+        ChunkProcessor processor;
+        processor.setChunkSize(DownloadTypes::chunkSizeFor(total));
+        QObject::connect(&processor, &ChunkProcessor::chunkReady, [&hashes](int, const QByteArray &, const QByteArray &hash){
+            hashes.append(hash);
+        });
+
+        qint64 copied = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (qint64 received = 0; received < total; received += readSize) {
+            CountingDevice socket(block);
+            if (direct) {
+                processor.readFrom(&socket);
+            } else {
+                QByteArray data = socket.readAll();
+                processor.processData(data);
+                copied += data.size();
+            }
+            copied += socket.copied();
+        }
+        processor.finalize();
+        qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+
+        EXPECT_EQ(processor.getBytesReceived(), total);
+        std::cout << (direct ? "readFrom:            " : "readAll+processData: ")
+                  << double(copied) / total << " bytes copied per byte, "
+                  << double(total) / MiB * 1000 / elapsedMs << " MiB/s" << std::endl;
+        return copied;
+    };
+
+    QVector<QByteArray> viaReadAll;
+    QVector<QByteArray> viaReadFrom;
+    qint64 readAllCopies = run(false, viaReadAll);
+    qint64 readFromCopies = run(true, viaReadFrom);
+
+    EXPECT_EQ(viaReadAll, viaReadFrom);
+    EXPECT_EQ(readAllCopies, 2 * total);
+    EXPECT_EQ(readFromCopies, total);
+}
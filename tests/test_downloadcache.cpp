@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <QTemporaryDir>
+#include <QCryptographicHash>
+#include <QFile>
+#include "downloadcache.h"
+
+class DownloadCacheTest : public ::testing::Test {
+protected:
+    QTemporaryDir dir;
+
+    QString writeFile(const QString &name, const QByteArray &content) {
+        QString path = dir.filePath(name);
+        QFile file(path);
+        file.open(QIODevice::WriteOnly);
+        file.write(content);
+        return path;
+    }
+
+    QByteArray readFile(const QString &path) {
+        QFile file(path);
+        file.open(QIODevice::ReadOnly);
+        return file.readAll();
+    }
+
+    QString sha256(const QByteArray &content) {
+        return QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex();
+    }
+};
+
+TEST_F(DownloadCacheTest, FindsStoredFileByHash){
+    QByteArray content(300000, 'x');
+    DownloadCache cache(dir.filePath("cache"));
+
+    ASSERT_TRUE(cache.store(writeFile("a.bin", content), QString(), "http://example.com/a.bin", "\"v1\""));
+
+    auto entry = cache.lookup(sha256(content), "http://other.example.com/b.bin", QString());
+    ASSERT_FALSE(entry.path.isEmpty());
+    EXPECT_EQ(entry.hash, sha256(content));
+    EXPECT_EQ(entry.size, content.size());
+    EXPECT_EQ(readFile(entry.path), content);
+}
+
+TEST_F(DownloadCacheTest, FindsStoredFileByUrlAndEtag){
+    QByteArray content = "payload";
+    DownloadCache cache(dir.filePath("cache"));
+    ASSERT_TRUE(cache.store(writeFile("a.bin", content), sha256(content), "http://example.com/a.bin", "\"v1\""));
+
+    EXPECT_EQ(cache.lookup(QString(), "http://example.com/a.bin", "\"v1\"").hash, sha256(content));
+    EXPECT_TRUE(cache.lookup(QString(), "http://example.com/a.bin", "\"v2\"").path.isEmpty());
+    EXPECT_TRUE(cache.lookup(QString(), "http://example.com/a.bin", "\"v1\"", content.size() + 1).path.isEmpty());
+}
+
+TEST_F(DownloadCacheTest, WeakEtagsAreNotTrusted){
+    QByteArray content = "payload";
+    DownloadCache cache(dir.filePath("cache"));
+    ASSERT_TRUE(cache.store(writeFile("a.bin", content), QString(), "http://example.com/a.bin", "W/\"v1\""));
+
+    EXPECT_TRUE(cache.lookup(QString(), "http://example.com/a.bin", "W/\"v1\"").path.isEmpty());
+}
+
+TEST_F(DownloadCacheTest, WeakEtagDoesNotMatchOtherUrls){
+    QByteArray content = "payload of a";
+    DownloadCache cache(dir.filePath("cache"));
+    ASSERT_TRUE(cache.store(writeFile("a.bin", content), QString(), "http://example.com/a.bin", "W/\"v1\""));
+
+    EXPECT_TRUE(cache.lookup(QString(), "http://example.com/b.bin", QString()).path.isEmpty());
+    EXPECT_TRUE(cache.lookup(QString(), "http://example.com/b.bin", "W/\"v2\"").path.isEmpty());
+    EXPECT_TRUE(cache.lookup(QString(), "http://example.com/b.bin", QString(), -1).path.isEmpty());
+
+    DownloadCache reopened(dir.filePath("cache"));
+    EXPECT_TRUE(reopened.lookup(QString(), "http://example.com/b.bin", QString()).path.isEmpty());
+}
+
+TEST_F(DownloadCacheTest, IdenticalContentIsStoredOnce){
+    QByteArray content(1000, 'y');
+    DownloadCache cache(dir.filePath("cache"));
+
+    ASSERT_TRUE(cache.store(writeFile("a.bin", content), QString(), "http://a.example.com/f", "\"1\""));
+    ASSERT_TRUE(cache.store(writeFile("b.bin", content), QString(), "http://b.example.com/f", "\"2\""));
+
+    EXPECT_EQ(cache.size(), content.size());
+    EXPECT_EQ(cache.lookup(QString(), "http://b.example.com/f", "\"2\"").hash, sha256(content));
+}
+
+TEST_F(DownloadCacheTest, IndexSurvivesRestart){
+    QByteArray content = "kept across sessions";
+    {
+        DownloadCache cache(dir.filePath("cache"));
+        ASSERT_TRUE(cache.store(writeFile("a.bin", content), QString(), "http://example.com/a", "\"v1\""));
+    }
+
+    DownloadCache cache(dir.filePath("cache"));
+    EXPECT_EQ(cache.size(), content.size());
+    EXPECT_EQ(readFile(cache.lookup(QString(), "http://example.com/a", "\"v1\"").path), content);
+}
+
+TEST_F(DownloadCacheTest, EvictsLeastRecentlyUsedPastBudget){
+    QByteArray first(400, '1'), second(400, '2'), third(400, '3');
+    DownloadCache cache(dir.filePath("cache"), 1000);
+
+    ASSERT_TRUE(cache.store(writeFile("1", first), QString(), "http://example.com/1", "\"1\""));
+    ASSERT_TRUE(cache.store(writeFile("2", second), QString(), "http://example.com/2", "\"2\""));
+    ASSERT_FALSE(cache.lookup(sha256(first), QString(), QString()).path.isEmpty());
+    ASSERT_TRUE(cache.store(writeFile("3", third), QString(), "http://example.com/3", "\"3\""));
+
+    EXPECT_LE(cache.size(), 1000);
+    EXPECT_FALSE(cache.lookup(sha256(first), QString(), QString()).path.isEmpty());
+    EXPECT_TRUE(cache.lookup(sha256(second), QString(), QString()).path.isEmpty());
+    EXPECT_FALSE(cache.lookup(sha256(third), QString(), QString()).path.isEmpty());
+}
+
+TEST_F(DownloadCacheTest, MissingObjectIsForgotten){
+    QByteArray content = "gone";
+    DownloadCache cache(dir.filePath("cache"));
+    ASSERT_TRUE(cache.store(writeFile("a.bin", content), QString(), "http://example.com/a", "\"v1\""));
+
+    QString path = cache.lookup(sha256(content), QString(), QString()).path;
+    ASSERT_TRUE(QFile::remove(path));
+
+    EXPECT_TRUE(cache.lookup(sha256(content), QString(), QString()).path.isEmpty());
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST_F(DownloadCacheTest, MaterializeReplacesTargetContents){
+    QByteArray content(2 * 1024 * 1024 + 17, 'm');
+    QString source = writeFile("source.bin", content);
+    QString target = writeFile("target.bin", QByteArray(5 * 1024 * 1024, '\0'));
+
+    ASSERT_TRUE(DownloadCache::materialize(source, target));
+    EXPECT_EQ(readFile(target), content);
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include <QtTest/QSignalSpy>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <iostream>
 #include "downloaddatabase.h"
 
 class DownloadDatabaseTest : public ::testing::Test {
@@ -52,7 +55,18 @@ TEST_F(DownloadDatabaseTest, DatabaseSchemaIsCorrect)
     EXPECT_TRUE(columns.contains("chunkHashes"));
     EXPECT_TRUE(columns.contains("createdAt"));
     EXPECT_TRUE(columns.contains("updatedAt"));
-    EXPECT_EQ(columns.size(), 13);
+    EXPECT_TRUE(columns.contains("etag"));
+    EXPECT_TRUE(columns.contains("lastModified"));
+    EXPECT_TRUE(columns.contains("mirrors"));
+    EXPECT_TRUE(columns.contains("decompress"));
+    EXPECT_TRUE(columns.contains("chunkBitmap"));
+    EXPECT_TRUE(columns.contains("chunkSize"));
+    EXPECT_TRUE(columns.contains("queuePosition"));
+    EXPECT_TRUE(columns.contains("uuid"));
+    EXPECT_TRUE(columns.contains("quantityOfChunks"));
+    EXPECT_TRUE(columns.contains("pieceHashes"));
+    EXPECT_TRUE(columns.contains("decodeFormat"));
+    EXPECT_EQ(columns.size(), 24);
 }
 
 TEST_F(DownloadDatabaseTest, SaveAndLoadFullRecord)
@@ -63,13 +77,21 @@ TEST_F(DownloadDatabaseTest, SaveAndLoadFullRecord)
     record.m_name = "file.zip";
     record.m_url = "https://test.com/file.zip";
     record.m_filePath = "/home/user/downloads/file.zip";
-    record.m_status = "downloading";
+    record.m_status = DownloadRecord::statusCode("downloading");
     record.m_totalBytes = 1024 * 1024;
     record.m_downloadedBytes = 512;
     record.m_expectedHash = "5d41402abc4b2a76b9719d911017c592";
     record.m_actualHash = "5d41402abc4b2a76b9719d911017c592";
     record.m_hashAlgorithm = "MD5";
     record.m_chunkHashes = QByteArray("\x01\x02\x03\x04", 4);
+    record.m_pieceHashes = QByteArray("\x0a\x0b\x0c", 3);
+    record.m_etag = "\"33a64df551425fcc55e4d42a148795d9f25f89d4\"";
+    record.m_lastModified = "Wed, 21 Oct 2015 07:28:00 GMT";
+    record.m_mirrors = QStringList{"https://mirror1.test.com/file.zip", "https://mirror2.test.com/file.zip"};
+    record.m_decompress = true;
+    record.m_decodeFormat = 1;
+    record.m_chunkBitmap = QByteArray("\x05\x00\x02\x01\x02", 5);
+    record.m_chunkSize = 256 * 1024;
 
     QVector<DownloadRecord> toSave = { record };
     db->saveDownloads(toSave);
@@ -89,6 +111,14 @@ TEST_F(DownloadDatabaseTest, SaveAndLoadFullRecord)
     EXPECT_EQ(loaded[0].m_actualHash, record.m_actualHash);
     EXPECT_EQ(loaded[0].m_hashAlgorithm, record.m_hashAlgorithm);
     EXPECT_EQ(loaded[0].m_chunkHashes, record.m_chunkHashes);
+    EXPECT_EQ(loaded[0].m_pieceHashes, record.m_pieceHashes);
+    EXPECT_EQ(loaded[0].m_etag, record.m_etag);
+    EXPECT_EQ(loaded[0].m_lastModified, record.m_lastModified);
+    EXPECT_EQ(loaded[0].m_mirrors, record.m_mirrors);
+    EXPECT_TRUE(loaded[0].m_decompress);
+    EXPECT_EQ(loaded[0].m_decodeFormat, record.m_decodeFormat);
+    EXPECT_EQ(loaded[0].m_chunkBitmap, record.m_chunkBitmap);
+    EXPECT_EQ(loaded[0].m_chunkSize, record.m_chunkSize);
 }
 
 TEST_F(DownloadDatabaseTest, UpsertPreventsDuplicates)
@@ -97,7 +127,7 @@ TEST_F(DownloadDatabaseTest, UpsertPreventsDuplicates)
     record.m_url = "https://test.com/file.zip";
     record.m_name = "file.zip";
     record.m_filePath = "/home/user/downloads/file.zip";
-    record.m_status = "pending";
+    record.m_status = DownloadRecord::statusCode("pending");
     record.m_totalBytes = 1048576;
     record.m_downloadedBytes = 0;
     record.m_expectedHash = "HASH_EXPECTED";
@@ -110,7 +140,7 @@ TEST_F(DownloadDatabaseTest, UpsertPreventsDuplicates)
     DownloadRecord updated = record;
     updated.m_name = "new_name.zip";
     updated.m_filePath = "/new/path/file.zip";
-    updated.m_status = "completed";
+    updated.m_status = DownloadRecord::statusCode("completed");
     updated.m_totalBytes = 2000000;
     updated.m_downloadedBytes = 2000000;
     updated.m_expectedHash = "5d41402abc4b2a76b9719d911017c592";
@@ -151,7 +181,7 @@ TEST_F(DownloadDatabaseTest, CorrectSortingByStatus)
         record.m_url = QString("https://example.com/%1").arg(i);
         record.m_name = QString("File_%1").arg(i);
         record.m_filePath = QString("/downloads/test_file_%1").arg(i);
-        record.m_status = expectedOrder.at(i);
+        record.m_status = DownloadRecord::statusCode(expectedOrder.at(i));
         recordsToSave.append(record);
     }
 
@@ -162,7 +192,7 @@ TEST_F(DownloadDatabaseTest, CorrectSortingByStatus)
     ASSERT_EQ(loaded.size(), expectedOrder.size());
 
     for (int i = 0; i < expectedOrder.size(); ++i) {
-        EXPECT_EQ(loaded.at(i).m_status, expectedOrder.at(i))
+        EXPECT_EQ(DownloadRecord::statusName(loaded.at(i).m_status), expectedOrder.at(i))
         << "Status mismatch at index " << i;
     }
 }
@@ -187,7 +217,7 @@ TEST_F(DownloadDatabaseTest, TimestampsAreAutoGenerated)
     record.m_url = "https://time.test";
     record.m_name = "time_file";
     record.m_filePath = "/downloads/test_file.zip";
-    record.m_status = "downloading";
+    record.m_status = DownloadRecord::statusCode("downloading");
 
     db->saveDownloads({record});
 
@@ -198,6 +228,276 @@ TEST_F(DownloadDatabaseTest, TimestampsAreAutoGenerated)
     EXPECT_FALSE(query.value(1).toString().isEmpty()) << "updatedAt should not be empty";
 }
 
+TEST_F(DownloadDatabaseTest, QueueIndexExistsOnFreshDatabase)
+{
+    QSqlQuery query("SELECT name FROM sqlite_master WHERE type = 'index' AND name = 'idx_queue'", QSqlDatabase::database());
+    EXPECT_TRUE(query.next());
+
+    QSqlQuery plan("EXPLAIN QUERY PLAN SELECT url FROM downloads ORDER BY status, queuePosition", QSqlDatabase::database());
+    QString details;
+    while (plan.next()) details += plan.value(3).toString();
+    EXPECT_TRUE(details.contains("idx_queue")) << details.toStdString();
+    EXPECT_FALSE(details.contains("TEMP B-TREE")) << details.toStdString();
+}
+
+TEST_F(DownloadDatabaseTest, StatusIsStoredAsCode)
+{
+    DownloadRecord record;
+    record.m_url = "https://code.test/file.iso";
+    record.m_name = "file.iso";
+    record.m_filePath = "/downloads/file.iso";
+    record.m_status = DownloadRecord::statusCode("paused");
+    db->saveDownloads({record});
+
+    QSqlQuery query("SELECT status, typeof(status) FROM downloads", QSqlDatabase::database());
+    ASSERT_TRUE(query.next());
+    EXPECT_EQ(query.value(1).toString(), "integer");
+    EXPECT_EQ(query.value(0).toInt(), DownloadRecord::statusCode("paused"));
+    EXPECT_EQ(DownloadRecord::statusName(query.value(0).toInt()), "paused");
+}
+
+TEST_F(DownloadDatabaseTest, QueuePositionOrdersWithinStatus)
+{
+    QVector<DownloadRecord> records;
+    for (int position : {3, 1, 2}) {
+        DownloadRecord record;
+        record.m_url = QString("https://queue.test/%1").arg(position);
+        record.m_name = QString("file%1").arg(position);
+        record.m_filePath = QString("/downloads/file%1").arg(position);
+        record.m_status = DownloadRecord::statusCode("pending");
+        record.m_queuePosition = position;
+        records.append(record);
+    }
+    DownloadRecord active = records[0];
+    active.m_url = "https://queue.test/active";
+    active.m_status = DownloadRecord::statusCode("downloading");
+    active.m_queuePosition = 10;
+    records.append(active);
+
+    db->saveDownloads(records);
+    QVector<DownloadRecord> loaded = db->getDownloads();
+
+    ASSERT_EQ(loaded.size(), 4);
+    EXPECT_EQ(loaded[0].m_url, "https://queue.test/active");
+    EXPECT_EQ(loaded[1].m_queuePosition, 1);
+    EXPECT_EQ(loaded[2].m_queuePosition, 2);
+    EXPECT_EQ(loaded[3].m_queuePosition, 3);
+}
+
+TEST_F(DownloadDatabaseTest, ArchiveMovesDownloadToHistory)
+{
+    QVector<DownloadRecord> records;
+    for (int i = 0; i < 6; ++i) {
+        DownloadRecord record;
+        record.m_url = QString("https://history.test/%1").arg(i);
+        record.m_name = QString("file%1").arg(i);
+        record.m_filePath = QString("/downloads/file%1").arg(i);
+        record.m_status = DownloadRecord::statusCode("downloading");
+        record.m_uuid = QUuid::createUuid();
+        records.append(record);
+    }
+    db->saveDownloads(records);
+
+    QVector<DownloadTypes::HistoryEntry> archived;
+    for (int i = 1; i < 6; ++i) {
+        DownloadTypes::HistoryEntry entry;
+        entry.id = records[i].m_uuid;
+        entry.url = records[i].m_url;
+        entry.name = records[i].m_name;
+        entry.filePath = records[i].m_filePath;
+        entry.hash = "abc";
+        entry.totalBytes = i;
+        entry.status = i == 5 ? DownloadTypes::DownloadStatus::Cancelled : DownloadTypes::DownloadStatus::Completed;
+        archived.append(entry);
+    }
+    ASSERT_TRUE(db->writeBatch({}, {}, archived));
+
+    QVector<DownloadRecord> active = db->getActiveDownloads();
+    ASSERT_EQ(active.size(), 1);
+    EXPECT_EQ(active[0].m_url, "https://history.test/0");
+
+    QVector<DownloadTypes::HistoryEntry> first = db->getHistory(0, 3);
+    QVector<DownloadTypes::HistoryEntry> second = db->getHistory(3, 3);
+
+    ASSERT_EQ(first.size(), 3);
+    ASSERT_EQ(second.size(), 2);
+    EXPECT_EQ(first[0].url, "https://history.test/5");
+    EXPECT_EQ(first[0].status, DownloadTypes::DownloadStatus::Cancelled);
+    EXPECT_EQ(first[0].id, records[5].m_uuid);
+    EXPECT_EQ(second[1].url, "https://history.test/1");
+    EXPECT_EQ(second[1].totalBytes, 1);
+    EXPECT_EQ(second[1].hash, "abc");
+    EXPECT_TRUE(second[1].finishedAt.isValid());
+
+    db->deleteHistoryEntry(records[5].m_uuid);
+    EXPECT_EQ(db->getHistory(0, 10).size(), 4);
+}
+
+TEST_F(DownloadDatabaseTest, FinishedRowsLeftInQueueAreArchivedOnOpen)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QStringList statuses = {"downloading", "completed", "error", "deleted"};
+    {
+        DownloadDatabase fileDb(dir.filePath("leftover.db"), nullptr, "leftover_writer");
+        QVector<DownloadRecord> records;
+        for (int i = 0; i < statuses.size(); ++i) {
+            DownloadRecord record;
+            record.m_url = QString("https://leftover.test/%1").arg(i);
+            record.m_name = QString("file%1").arg(i);
+            record.m_filePath = QString("/downloads/file%1").arg(i);
+            record.m_status = DownloadRecord::statusCode(statuses[i]);
+            record.m_uuid = QUuid::createUuid();
+            records.append(record);
+        }
+        ASSERT_TRUE(fileDb.writeBatch(records, {}));
+        EXPECT_EQ(fileDb.getHistory(0, 10).size(), 0);
+    }
+
+    DownloadDatabase reopened(dir.filePath("leftover.db"), nullptr, "leftover_reader");
+    QVector<DownloadRecord> active = reopened.getDownloads();
+    ASSERT_EQ(active.size(), 1);
+    EXPECT_EQ(active[0].m_url, "https://leftover.test/0");
+
+    QVector<DownloadTypes::HistoryEntry> history = reopened.getHistory(0, 10);
+    ASSERT_EQ(history.size(), 2);
+    QStringList urls;
+    for (const auto &entry : history) urls << entry.url;
+    EXPECT_TRUE(urls.contains("https://leftover.test/1"));
+    EXPECT_TRUE(urls.contains("https://leftover.test/2"));
+}
+
+TEST_F(DownloadDatabaseTest, TextStatusIsMigrated)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QString path = dir.filePath("legacy.db");
+    {
+        QSqlDatabase legacy = QSqlDatabase::addDatabase("QSQLITE", "legacy_writer");
+        legacy.setDatabaseName(path);
+        ASSERT_TRUE(legacy.open());
+        QSqlQuery query(legacy);
+        ASSERT_TRUE(query.exec("CREATE TABLE downloads (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL, "
+                               "url TEXT NOT NULL UNIQUE, filePath TEXT, status TEXT NOT NULL DEFAULT 'pending', "
+                               "totalBytes INTEGER DEFAULT 0, downloadedBytes INTEGER DEFAULT 0, expectedHash TEXT, "
+                               "actualHash TEXT, hashAlgorithm TEXT, chunkHashes BLOB, "
+                               "createdAt DATETIME DEFAULT CURRENT_TIMESTAMP, updatedAt DATETIME DEFAULT CURRENT_TIMESTAMP)"));
+        ASSERT_TRUE(query.exec("INSERT INTO downloads (name, url, filePath, status, totalBytes) "
+                               "VALUES ('a', 'https://legacy.test/a', '/a', 'completed', 10)"));
+        ASSERT_TRUE(query.exec("INSERT INTO downloads (name, url, filePath, status, totalBytes) "
+                               "VALUES ('b', 'https://legacy.test/b', '/b', 'resumed_in_downloading', 20)"));
+        legacy.close();
+    }
+    QSqlDatabase::removeDatabase("legacy_writer");
+
+    DownloadDatabase migrated(path, nullptr, "legacy_reader");
+    QVector<DownloadRecord> loaded = migrated.getDownloads();
+
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0].m_url, "https://legacy.test/b");
+    EXPECT_EQ(DownloadRecord::statusName(loaded[0].m_status), "resumed_in_downloading");
+    EXPECT_EQ(loaded[0].m_totalBytes, 20);
+
+    QVector<DownloadTypes::HistoryEntry> history = migrated.getHistory(0, 10);
+    ASSERT_EQ(history.size(), 1);
+    EXPECT_EQ(history[0].url, "https://legacy.test/a");
+    EXPECT_EQ(history[0].status, DownloadTypes::DownloadStatus::Completed);
+}
+
+TEST_F(DownloadDatabaseTest, UpsertKeepsRowIdentity)
+{
+    DownloadRecord record;
+    record.m_url = "https://upsert.test/file.iso";
+    record.m_name = "file.iso";
+    record.m_filePath = "/downloads/file.iso";
+    record.m_status = DownloadRecord::statusCode("downloading");
+    db->saveDownloads({record});
+
+    QSqlQuery before("SELECT id, createdAt FROM downloads", QSqlDatabase::database());
+    ASSERT_TRUE(before.next());
+    qint64 id = before.value(0).toLongLong();
+    QString createdAt = before.value(1).toString();
+
+    record.m_status = DownloadRecord::statusCode("completed");
+    record.m_downloadedBytes = 4096;
+    db->saveDownloads({record});
+
+    QSqlQuery after("SELECT id, createdAt, status, downloadedBytes FROM downloads", QSqlDatabase::database());
+    ASSERT_TRUE(after.next());
+    EXPECT_EQ(after.value(0).toLongLong(), id);
+    EXPECT_EQ(after.value(1).toString(), createdAt);
+    EXPECT_EQ(after.value(2).toString(), "completed");
+    EXPECT_EQ(after.value(3).toLongLong(), 4096);
+    EXPECT_FALSE(after.next());
+}
+
+TEST_F(DownloadDatabaseTest, FileDatabaseUsesWal)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    {
+        DownloadDatabase fileDb(dir.filePath("wal.db"), nullptr, "wal_test");
+        QSqlQuery query("PRAGMA journal_mode", QSqlDatabase::database("wal_test"));
+        ASSERT_TRUE(query.next());
+        EXPECT_EQ(query.value(0).toString().toLower(), "wal");
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests to compare timings between builds.
+// The same workload also runs with the rollback journal and synchronous=FULL
+// the connection had before WAL, so one run shows both sides.
+TEST_F(DownloadDatabaseTest, DISABLED_BenchmarkUpsertsAndLoads)
+{
+    const int count = 10000;
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    QVector<DownloadRecord> records;
+    records.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        DownloadRecord record;
+        record.m_url = QString("https://bench.example.com/file%1.bin").arg(i);
+        record.m_name = QString("file%1.bin").arg(i);
+        record.m_filePath = QString("/downloads/file%1.bin").arg(i);
+        record.m_status = DownloadRecord::statusCode("downloading");
+        record.m_totalBytes = 1024LL * 1024 * 1024;
+        record.m_chunkHashes = QByteArray(32 * 64, 'h');
+        records.append(record);
+    }
+
+    auto run = [&](const QString &name, const QStringList &pragmas) {
+        QString connection = "bench_" + name;
+        DownloadDatabase fileDb(dir.filePath(name + ".db"), nullptr, connection);
+        QSqlQuery query(QSqlDatabase::database(connection));
+        for (const QString &pragma : pragmas) {
+            ASSERT_TRUE(query.exec(pragma)) << query.lastError().text().toStdString();
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        fileDb.saveDownloads(records);
+        qint64 batchMs = timer.restart();
+
+        for (int i = 0; i < count; ++i) {
+            DownloadRecord record = records[i];
+            record.m_downloadedBytes = i;
+            fileDb.writeBatch({record}, {});
+        }
+        qint64 singleMs = timer.restart();
+
+        QVector<DownloadRecord> loaded = fileDb.getDownloads();
+        qint64 loadMs = timer.elapsed();
+
+        EXPECT_EQ(loaded.size(), count);
+        std::cout << name.toStdString() << ": " << count << " upserts in one batch: " << batchMs << " ms, "
+                  << count << " single-row transactions: " << singleMs << " ms, "
+                  << "full load: " << loadMs << " ms" << std::endl;
+    };
+
+    run("rollback", {"PRAGMA journal_mode = DELETE", "PRAGMA synchronous = FULL"});
+    run("wal", {});
+}
+
 TEST_F(DownloadDatabaseTest, SaveMixedValidAndInvalidRecords) {
     DownloadDatabase db(":memory:");
     QVector<DownloadRecord> records;
@@ -207,7 +507,7 @@ TEST_F(DownloadDatabaseTest, SaveMixedValidAndInvalidRecords) {
         record.m_url = QString("https://example.com/file%1").arg(i);
         record.m_name = QString("File %1").arg(i);
         record.m_filePath = QString("/downloads/file%1.zip").arg(i);
-        record.m_status = "pending";
+        record.m_status = DownloadRecord::statusCode("pending");
         record.m_totalBytes = 1000;
         record.m_downloadedBytes = 0;
         records.append(record);
@@ -0,0 +1,288 @@
+#include <gtest/gtest.h>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QTest>
+#include <QListView>
+#include <QScrollBar>
+#include <QElapsedTimer>
+#include <iostream>
+#include "downloadlistmodel.h"
+#include "downloaditemdelegate.h"
+
+class DownloadListModelTest : public ::testing::Test {
+protected:
+    DownloadListModel model;
+    QVector<DownloadItem*> items;
+
+    void TearDown() override {
+        qDeleteAll(items);
+    }
+
+    DownloadItem* createItem(const QString &name) {
+        DownloadItem *item = new DownloadItem("https://example.com/" + name, "/downloads/" + name, name);
+        items.append(item);
+        return item;
+    }
+
+    DownloadTypes::HistoryEntry createEntry(const QString &name, DownloadTypes::DownloadStatus status) {
+        DownloadTypes::HistoryEntry entry;
+        entry.id = QUuid::createUuid();
+        entry.name = name;
+        entry.url = "https://example.com/" + name;
+        entry.filePath = "/downloads/" + name;
+        entry.status = status;
+        entry.totalBytes = 1024 * 1024;
+        return entry;
+    }
+};
+
+TEST_F(DownloadListModelTest, RowsFollowInsertionsAndRemovals){
+    DownloadItem *first = createItem("a.iso");
+    DownloadItem *second = createItem("b.iso");
+    DownloadItem *third = createItem("c.iso");
+    model.addItem(first);
+    model.addItems({second, third, first});
+
+    ASSERT_EQ(model.rowCount(), 3);
+    EXPECT_EQ(model.data(model.index(1)).toString(), "b.iso");
+
+    model.removeItem(second);
+    ASSERT_EQ(model.rowCount(), 2);
+    EXPECT_EQ(model.rowOf(second), -1);
+    EXPECT_EQ(model.rowOf(third), 1);
+    EXPECT_EQ(model.itemAt(1), third);
+    EXPECT_EQ(model.data(model.index(1), DownloadListModel::ItemRole).value<DownloadItem*>(), third);
+}
+
+TEST_F(DownloadListModelTest, ProgressIsPublishedOnRefreshTick){
+    DownloadItem *first = createItem("a.iso");
+    DownloadItem *second = createItem("b.iso");
+    DownloadItem *third = createItem("c.iso");
+    model.addItems({first, second, third});
+
+    QSignalSpy spy(&model, &DownloadListModel::dataChanged);
+    for(int i = 1; i <= 100; ++i){
+        second->onProgressChanged(i * 5 * 1024, 1024 * 1024);
+    }
+    third->onProgressChanged(1, 2);
+    EXPECT_EQ(spy.count(), 0);
+
+    model.refresh();
+
+    ASSERT_EQ(spy.count(), 1);
+    EXPECT_EQ(spy[0][0].value<QModelIndex>().row(), 1);
+    EXPECT_EQ(spy[0][1].value<QModelIndex>().row(), 2);
+
+    QModelIndex row = model.index(1);
+    EXPECT_EQ(model.data(row, DownloadListModel::ProgressRole).toInt(), 48);
+    EXPECT_EQ(model.data(row, DownloadListModel::SizeRole).toString(), "0.5/1.0 MB");
+
+    model.refresh();
+    EXPECT_EQ(spy.count(), 1);
+}
+
+TEST_F(DownloadListModelTest, RefreshTickSamplesSpeedOfTransferringRows){
+    DownloadItem *item = createItem("a.iso");
+    model.addItem(item);
+    model.setRefreshInterval(20);
+
+    item->onProgressChanged(0, 100 * 1024 * 1024);
+    model.refresh();
+    EXPECT_EQ(model.data(model.index(0), DownloadListModel::SpeedRole).toString(), "0B/s");
+
+    item->onProgressChanged(10 * 1024 * 1024, 100 * 1024 * 1024);
+    QTest::qWait(1100);
+    model.refresh();
+
+    QString speed = model.data(model.index(0), DownloadListModel::SpeedRole).toString();
+    EXPECT_TRUE(speed.endsWith("MB/s")) << speed.toStdString();
+    EXPECT_FALSE(model.data(model.index(0), DownloadListModel::TimeToCompleteRole).toString().isEmpty());
+
+    item->chackWhatStatus(DownloadTask::Completed);
+    EXPECT_FALSE(item->isTransferring());
+}
+
+TEST_F(DownloadListModelTest, CheckingRowReportsSelection){
+    DownloadItem *item = createItem("a.iso");
+    model.addItem(item);
+
+    QSignalSpy spy(item, &DownloadItem::ChangedBt);
+    EXPECT_TRUE(model.setData(model.index(0), Qt::Checked, Qt::CheckStateRole));
+
+    ASSERT_EQ(spy.count(), 1);
+    EXPECT_TRUE(spy[0][1].toBool());
+    EXPECT_EQ(model.data(model.index(0), Qt::CheckStateRole).toInt(), Qt::Checked);
+}
+
+TEST_F(DownloadListModelTest, SwitchPausesOnlyRunningDownloads){
+    DownloadItem *item = createItem("a.iso");
+    model.addItem(item);
+
+    EXPECT_FALSE(model.setData(model.index(0), false, DownloadListModel::RunningRole));
+
+    item->chackWhatStatus(DownloadTask::Downloading);
+    QSignalSpy spy(item, &DownloadItem::statusChanged);
+    EXPECT_TRUE(model.setData(model.index(0), false, DownloadListModel::RunningRole));
+
+    ASSERT_EQ(spy.count(), 1);
+    EXPECT_EQ(spy[0][0].value<DownloadTask::Status>(), DownloadTask::Paused);
+    EXPECT_FALSE(model.data(model.index(0), DownloadListModel::RunningRole).toBool());
+}
+
+TEST_F(DownloadListModelTest, FinishedRowHidesSwitchAndCancel){
+    DownloadItem *item = createItem("a.iso");
+    model.addItem(item);
+
+    QSignalSpy finished(item, &DownloadItem::finishedDownload);
+    item->chackWhatStatus(DownloadTask::Completed);
+
+    EXPECT_EQ(finished.count(), 1);
+    QModelIndex row = model.index(0);
+    EXPECT_EQ(model.data(row, DownloadListModel::StatusRole).toString(), "Completed");
+    EXPECT_FALSE(model.data(row, DownloadListModel::PausableRole).toBool());
+    EXPECT_FALSE(model.data(row, DownloadListModel::CancellableRole).toBool());
+}
+
+TEST_F(DownloadListModelTest, ClickOnPaintedCheckBoxChecksRow){
+    DownloadItem *item = createItem("a.iso");
+    model.addItem(item);
+
+    QListView view;
+    view.setModel(&model);
+    view.setItemDelegate(new DownloadItemDelegate(&view));
+    view.resize(800, 300);
+    view.show();
+    ASSERT_TRUE(QTest::qWaitForWindowExposed(&view));
+
+    QRect row = view.visualRect(model.index(0));
+    EXPECT_EQ(row.height(), 72);
+
+    QSignalSpy spy(item, &DownloadItem::ChangedBt);
+    QTest::mouseClick(view.viewport(), Qt::LeftButton, {}, QPoint(row.left() + 14, row.center().y()));
+
+    ASSERT_EQ(spy.count(), 1);
+    EXPECT_TRUE(item->isChecked());
+}
+
+TEST_F(DownloadListModelTest, HistoryRowsAreValuesWithoutItems){
+    model.addItem(createItem("active.iso"));
+    auto completed = createEntry("done.iso", DownloadTypes::DownloadStatus::Completed);
+    auto failed = createEntry("failed.iso", DownloadTypes::DownloadStatus::Error);
+    model.addHistory({completed, failed, completed});
+
+    ASSERT_EQ(model.rowCount(), 3);
+    EXPECT_EQ(model.itemAt(1), nullptr);
+    EXPECT_EQ(model.data(model.index(1), DownloadListModel::ItemRole).value<DownloadItem*>(), nullptr);
+    EXPECT_EQ(model.rowOfHistory(failed.id), 2);
+
+    QModelIndex done = model.index(1);
+    EXPECT_EQ(model.data(done).toString(), "done.iso");
+    EXPECT_EQ(model.data(done, DownloadListModel::StatusRole).toString(), "Completed");
+    EXPECT_EQ(model.data(done, DownloadListModel::ProgressRole).toInt(), 100);
+    EXPECT_EQ(model.data(done, DownloadListModel::SizeRole).toString(), "1.0/1.0 MB");
+    EXPECT_FALSE(model.data(done, DownloadListModel::PausableRole).toBool());
+
+    QModelIndex error = model.index(2);
+    EXPECT_EQ(model.data(error, DownloadListModel::StatusRole).toString(), "Error");
+    EXPECT_EQ(model.data(error, DownloadListModel::ProgressRole).toInt(), 0);
+    EXPECT_FALSE(model.data(error, DownloadListModel::CancellableRole).toBool());
+}
+
+TEST_F(DownloadListModelTest, CheckingHistoryRowReportsItsId){
+    auto entry = createEntry("done.iso", DownloadTypes::DownloadStatus::Completed);
+    model.addHistory({entry});
+
+    QSignalSpy spy(&model, &DownloadListModel::historyCheckChanged);
+    EXPECT_TRUE(model.setData(model.index(0), Qt::Checked, Qt::CheckStateRole));
+    EXPECT_FALSE(model.setData(model.index(0), false, DownloadListModel::RunningRole));
+
+    ASSERT_EQ(spy.count(), 1);
+    EXPECT_EQ(spy[0][0].value<QUuid>(), entry.id);
+    EXPECT_TRUE(spy[0][1].toBool());
+    EXPECT_EQ(model.data(model.index(0), Qt::CheckStateRole).toInt(), Qt::Checked);
+
+    model.setHistoryChecked(entry.id, false);
+    EXPECT_EQ(spy.count(), 1);
+    EXPECT_EQ(model.data(model.index(0), Qt::CheckStateRole).toInt(), Qt::Unchecked);
+}
+
+TEST_F(DownloadListModelTest, FinishedItemTurnsIntoHistoryRowInPlace){
+    DownloadItem *first = createItem("a.iso");
+    DownloadItem *second = createItem("b.iso");
+    DownloadItem *third = createItem("c.iso");
+    model.addItems({first, second, third});
+    second->setChecked(true);
+
+    auto entry = createEntry("b.iso", DownloadTypes::DownloadStatus::Completed);
+    QSignalSpy changed(&model, &DownloadListModel::dataChanged);
+    model.replaceWithHistory(second, entry);
+
+    EXPECT_EQ(changed.count(), 1);
+    EXPECT_EQ(model.rowOf(second), -1);
+    EXPECT_EQ(model.rowOfHistory(entry.id), 1);
+    EXPECT_EQ(model.itemAt(1), nullptr);
+    EXPECT_EQ(model.data(model.index(1), Qt::CheckStateRole).toInt(), Qt::Checked);
+
+    // The item is no longer followed.
+    second->onProgressChanged(1, 2);
+    model.refresh();
+    EXPECT_EQ(changed.count(), 1);
+
+    model.removeHistory(entry.id);
+    ASSERT_EQ(model.rowCount(), 2);
+    EXPECT_EQ(model.rowOf(third), 1);
+    EXPECT_EQ(model.rowOfHistory(entry.id), -1);
+}
+
+// Run with --gtest_also_run_disabled_tests to time loading and scrolling a
+// large list: a few hundred active downloads above a long history.
+TEST_F(DownloadListModelTest, DISABLED_BenchmarkScroll100kRows){
+    const int count = 100000;
+    const int active = 200;
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<DownloadItem*> rows;
+    rows.reserve(active);
+    for(int i = 0; i < active; ++i){
+        DownloadItem *item = createItem(QString("active-%1.bin").arg(i));
+        item->onProgressChanged(qint64(i % 100) * 1024 * 1024, 100LL * 1024 * 1024);
+        rows.append(item);
+    }
+    model.addItems(rows);
+
+    QVector<DownloadTypes::HistoryEntry> history;
+    history.reserve(count - active);
+    for(int i = active; i < count; ++i){
+        history.append(createEntry(QString("file-%1.bin").arg(i), i % 10 ? DownloadTypes::DownloadStatus::Completed
+                                                                          : DownloadTypes::DownloadStatus::Error));
+    }
+    model.addHistory(history);
+    qint64 loadMs = timer.restart();
+
+    QListView view;
+    view.setModel(&model);
+    view.setItemDelegate(new DownloadItemDelegate(&view));
+    view.setUniformItemSizes(true);
+    view.setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    view.resize(900, 700);
+    view.show();
+    ASSERT_TRUE(QTest::qWaitForWindowExposed(&view));
+    qint64 showMs = timer.restart();
+
+    const int frames = 300;
+    QScrollBar *bar = view.verticalScrollBar();
+    qint64 worstNs = 0;
+    QElapsedTimer frame;
+    for(int i = 0; i < frames; ++i){
+        frame.start();
+        bar->setValue(qint64(bar->maximum()) * i / frames);
+        view.viewport()->repaint();
+        worstNs = qMax(worstNs, frame.nsecsElapsed());
+    }
+    qint64 scrollMs = timer.elapsed();
+
+    EXPECT_EQ(model.rowCount(), count);
+    std::cout << count << " rows loaded in " << loadMs << " ms, first paint " << showMs << " ms\n"
+              << "scroll frame: " << double(scrollMs) / frames << " ms average, "
+              << worstNs / 1000000.0 << " ms worst" << std::endl;
+}
@@ -2,6 +2,10 @@
 #include <QtTest/QSignalSpy>
 #include <QThread>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <atomic>
+#include <iostream>
 #include "downloadregistry.h"
 
 class DownloadRegistryTest : public ::testing::Test {
@@ -162,3 +166,176 @@ TEST_F(DownloadRegistryTest, ThreadSafetyWithRealThreads) {
     auto finalRec = registry->getRecord(id);
     EXPECT_EQ(finalRec.downloadedBytes, updatesPerThread * 10);
 }
+
+TEST_F(DownloadRegistryTest, SnapshotCarriesCountersOfEveryRecord) {
+    QVector<QUuid> ids;
+    for (int i = 0; i < 40; ++i) {
+        ids.append(registry->addRecord(createFullRecord()));
+    }
+    registry->updateProgress(ids[7], 4096, 8192);
+    registry->updateStatus(ids[7], DownloadTypes::DownloadStatus::Downloading);
+
+    auto snapshot = registry->snapshot();
+    ASSERT_EQ(snapshot.size(), 40);
+
+    int matches = 0;
+    for (const auto& progress : snapshot) {
+        if (progress.id != ids[7]) continue;
+        ++matches;
+        EXPECT_EQ(progress.received, qint64(4096));
+        EXPECT_EQ(progress.total, qint64(8192));
+        EXPECT_EQ(progress.status, DownloadTypes::DownloadStatus::Downloading);
+    }
+    EXPECT_EQ(matches, 1);
+}
+
+TEST_F(DownloadRegistryTest, SlotsMayCallBackIntoRegistry) {
+    QUuid id = registry->addRecord(createFullRecord());
+
+    qint64 seen = -1;
+    QObject::connect(registry, &DownloadRegistry::progressChanged, registry, [this, &seen](QUuid changed, qint64, qint64) {
+        seen = registry->getRecord(changed).downloadedBytes;
+        registry->updateStatus(changed, DownloadTypes::DownloadStatus::Downloading);
+    }, Qt::DirectConnection);
+
+    registry->updateProgress(id, 100, 1000);
+
+    EXPECT_EQ(seen, qint64(100));
+    EXPECT_EQ(registry->getRecord(id).status, DownloadTypes::DownloadStatus::Downloading);
+}
+
+TEST_F(DownloadRegistryTest, AddRecordKeepsGivenId) {
+    auto record = createFullRecord();
+    QUuid given = record.id;
+
+    EXPECT_EQ(registry->addRecord(std::move(record)), given);
+    EXPECT_EQ(registry->getRecord(given).id, given);
+
+    QUuid generated = registry->addRecord(DownloadTypes::DownloadRecord());
+    EXPECT_FALSE(generated.isNull());
+    EXPECT_EQ(registry->getRecord(generated).id, generated);
+}
+
+TEST_F(DownloadRegistryTest, RemovedRecordIgnoresLateUpdates) {
+    QUuid id = registry->addRecord(createFullRecord());
+    QSignalSpy spy(registry, &DownloadRegistry::progressChanged);
+
+    EXPECT_TRUE(registry->removeRecord(id));
+    EXPECT_FALSE(registry->removeRecord(id));
+
+    registry->updateProgress(id, 10, 20);
+    EXPECT_EQ(spy.count(), 0);
+    EXPECT_TRUE(registry->getRecord(id).id.isNull());
+    EXPECT_TRUE(registry->snapshot().isEmpty());
+}
+
+TEST_F(DownloadRegistryTest, FindByUrlFollowsRegisteredDownloads) {
+    QUuid id = registry->addRecord(createFullRecord());
+    registry->addRecord(DownloadTypes::DownloadRecord{QUuid::createUuid(), "", "https://example.com/other.zip", "path"});
+
+    EXPECT_EQ(registry->findByUrl("https://example.com/test.zip"), id);
+    EXPECT_TRUE(registry->findByUrl("https://example.com/missing.zip").isNull());
+
+    registry->removeRecord(id);
+    EXPECT_TRUE(registry->findByUrl("https://example.com/test.zip").isNull());
+}
+
+// The registry as it was before sharding: one mutex around one hash, held
+// while updating and while copying every record out. Kept here only as the
+// baseline of the benchmark below.
+class SingleLockRegistry {
+public:
+    void addRecord(const DownloadTypes::DownloadRecord &record) {
+        QMutexLocker locker(&m_mutex);
+        m_records[record.id] = record;
+    }
+    void updateProgress(QUuid id, qint64 received, qint64 total) {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_records.find(id);
+        if (it == m_records.end()) return;
+        it->downloadedBytes = received;
+        it->totalBytes = total;
+    }
+    QList<DownloadTypes::DownloadRecord> getAllRecords() const {
+        QMutexLocker locker(&m_mutex);
+        return m_records.values();
+    }
+private:
+    mutable QMutex m_mutex;
+    QHash<QUuid, DownloadTypes::DownloadRecord> m_records;
+};
+
+// Runs 64 writer threads against one reader that keeps taking snapshots and
+// returns the updates per second.
+template <typename Update, typename Snapshot>
+static qint64 runContention(const QVector<QUuid> &ids, int updatesPerWriter, Update update, Snapshot snapshot,
+                            qint64 *snapshotsTaken) {
+    std::atomic<bool> done{false};
+    std::atomic<qint64> snapshots{0};
+    QThread* reader = QThread::create([&done, &snapshots, snapshot]() {
+        while (!done.load()) {
+            if (snapshot()) snapshots.fetch_add(1);
+        }
+    });
+
+    QVector<QThread*> threads;
+    for (const QUuid &id : ids) {
+        threads.append(QThread::create([id, updatesPerWriter, update]() {
+            for (int i = 1; i <= updatesPerWriter; ++i) {
+                update(id, i, updatesPerWriter);
+            }
+        }));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    reader->start();
+    for (QThread* thread : threads) thread->start();
+    for (QThread* thread : threads) thread->wait();
+    qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+    done.store(true);
+    reader->wait();
+
+    qDeleteAll(threads);
+    delete reader;
+
+    *snapshotsTaken = snapshots.load();
+    return ids.size() * qint64(updatesPerWriter) * 1000 / elapsedMs;
+}
+
+// Run with --gtest_also_run_disabled_tests to measure update throughput with
+// 64 writer threads while a reader keeps taking snapshots, for the sharded
+// registry and for the single-lock baseline in the same run.
+TEST_F(DownloadRegistryTest, DISABLED_BenchmarkContention64Writers) {
+    constexpr int writers = 64;
+    constexpr int updatesPerWriter = 100000;
+
+    SingleLockRegistry baseline;
+    QVector<QUuid> ids;
+    for (int i = 0; i < writers; ++i) {
+        auto record = createFullRecord();
+        record.id = QUuid::createUuid();
+        baseline.addRecord(record);
+        ids.append(registry->addRecord(std::move(record)));
+    }
+
+    qint64 baselineSnapshots = 0;
+    qint64 baselineRate = runContention(ids, updatesPerWriter,
+        [&baseline](QUuid id, qint64 received, qint64 total) { baseline.updateProgress(id, received, total); },
+        [&baseline]() { return !baseline.getAllRecords().isEmpty(); },
+        &baselineSnapshots);
+
+    qint64 shardedSnapshots = 0;
+    qint64 shardedRate = runContention(ids, updatesPerWriter,
+        [this](QUuid id, qint64 received, qint64 total) { registry->updateProgress(id, received, total); },
+        [this]() { return !registry->snapshot().isEmpty(); },
+        &shardedSnapshots);
+
+    for (const auto& progress : registry->snapshot()) {
+        EXPECT_EQ(progress.received, qint64(updatesPerWriter));
+    }
+    std::cout << "single lock: " << baselineRate << " updates per second, "
+              << baselineSnapshots << " snapshots taken meanwhile\n"
+              << "sharded:     " << shardedRate << " updates per second, "
+              << shardedSnapshots << " snapshots taken meanwhile" << std::endl;
+}
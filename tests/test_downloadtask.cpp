@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <QTemporaryDir>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QtTest/QSignalSpy>
+#include "downloadtask.h"
+#include "downloaditemadapter.h"
+#include "httpstandin.h"
+
+class DownloadTaskResumeTest : public ::testing::Test {
+protected:
+    static constexpr qint64 CHUNK = 256 * 1024;
+    QTemporaryDir dir;
+    QVector<QByteArray> chunks;
+
+    void SetUp() override {
+        for(int i = 0; i < 4; ++i){
+            QByteArray chunk;
+            while(chunk.size() < CHUNK) chunk += "chunk " + QByteArray::number(i) + " of the resumed file\n";
+            chunks.append(chunk.left(CHUNK));
+        }
+    }
+
+    QByteArray hashOf(const QByteArray &data) {
+        return QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+    }
+
+    // Chunks 0, 2 and 3 were saved by a multi-source download; chunk 1 never arrived.
+    QString writePartialFile(const QByteArray &thirdChunk) {
+        QString path = dir.filePath("resumed.bin");
+        QFile file(path);
+        file.open(QIODevice::WriteOnly);
+        file.write(chunks[0]);
+        file.write(QByteArray(CHUNK, '\0'));
+        file.write(thirdChunk);
+        file.write(chunks[3]);
+        return path;
+    }
+
+    DownloadTypes::DownloadRecord fileInfo(const QString &path) {
+        DownloadTypes::DownloadRecord info;
+        info.id = QUuid::createUuid();
+        info.name = "resumed.bin";
+        info.filePath = path;
+        info.totalBytes = 4 * CHUNK;
+        info.chunkSize = CHUNK;
+        info.expectedHash = QString(64, 'a');
+        return info;
+    }
+
+    DownloadRecord savedRow() {
+        QVector<QByteArray> hashes = {hashOf(chunks[0]), QByteArray(), hashOf(chunks[2]), hashOf(chunks[3])};
+        QByteArray serialized;
+        QDataStream out(&serialized, QIODevice::WriteOnly);
+        out << hashes;
+
+        ChunkBitmap saved(4);
+        saved.set(0);
+        saved.set(2);
+        saved.set(3);
+
+        DownloadRecord record;
+        record.m_status = DownloadRecord::statusCode("paused");
+        record.m_hashAlgorithm = "Sha256";
+        record.m_expectedHash = QString(64, 'a');
+        record.m_chunkHashes = serialized;
+        record.m_chunkBitmap = saved.toRle();
+        record.m_downloadedBytes = saved.completedBytes(CHUNK, 4 * CHUNK);
+        return record;
+    }
+
+    void resume(const QString &path, int *cleared, qint64 *openedAt) {
+        DownloadTask task("http://127.0.0.1:9/resumed.bin", fileInfo(path));
+        task.updateFromDb(savedRow());
+
+        QObject::connect(&task, &DownloadTask::clearFile, [cleared](){ ++*cleared; });
+        QObject::connect(&task, &DownloadTask::openFile, [openedAt](const DownloadTypes::DownloadRecord &, qint64 position){
+            *openedAt = position;
+        });
+
+        task.resumeDownload();
+    }
+
+    // Resumes the partial file from a server whose copy carries `currentEtag`
+    // while the saved row remembers `savedEtag`; returns the first chunk index
+    // the transfer hands to storage.
+    int resumeFromServer(HttpStandIn &server, const QByteArray &currentEtag, const QString &savedEtag,
+                         int *cleared, qint64 *openedAt) {
+        server.serve("/resumed.bin", chunks[0] + chunks[1] + chunks[2] + chunks[3], currentEtag);
+
+        DownloadRecord row = savedRow();
+        row.m_etag = savedEtag;
+        DownloadTask task(server.url("/resumed.bin"), fileInfo(writePartialFile(chunks[2])));
+        task.updateFromDb(row);
+
+        QObject::connect(&task, &DownloadTask::clearFile, [cleared](){ ++*cleared; });
+        QObject::connect(&task, &DownloadTask::openFile, [openedAt](const DownloadTypes::DownloadRecord &, qint64 position){
+            *openedAt = position;
+        });
+        QSignalSpy written(&task, &DownloadTask::writeChunk);
+
+        task.resumeDownload();
+        if(!written.wait(5000)) return -1;
+        return written[0][1].toInt();
+    }
+};
+
+TEST_F(DownloadTaskResumeTest, ChunksSavedPastAGapSurviveResume){
+    int cleared = 0;
+    qint64 openedAt = -1;
+    resume(writePartialFile(chunks[2]), &cleared, &openedAt);
+
+    EXPECT_EQ(cleared, 0);
+    EXPECT_EQ(openedAt, CHUNK);
+}
+
+TEST_F(DownloadTaskResumeTest, CorruptSavedChunkRestartsDownload){
+    QByteArray damaged = chunks[2];
+    damaged[100] = '#';
+
+    int cleared = 0;
+    qint64 openedAt = -1;
+    resume(writePartialFile(damaged), &cleared, &openedAt);
+
+    EXPECT_EQ(cleared, 1);
+    EXPECT_EQ(openedAt, 0);
+}
+
+TEST_F(DownloadTaskResumeTest, StaleValidatorRestartsFromZero){
+    HttpStandIn server;
+    int cleared = 0;
+    qint64 openedAt = -1;
+    int firstChunk = resumeFromServer(server, "\"v2\"", "\"v1\"", &cleared, &openedAt);
+
+    EXPECT_EQ(server.lastStatus(), 200);
+    EXPECT_EQ(firstChunk, 0);
+    EXPECT_EQ(cleared, 1);
+    EXPECT_EQ(openedAt, 0);
+}
+
+TEST_F(DownloadTaskResumeTest, MatchingValidatorContinuesWithPartialContent){
+    HttpStandIn server;
+    int cleared = 0;
+    qint64 openedAt = -1;
+    int firstChunk = resumeFromServer(server, "\"v1\"", "\"v1\"", &cleared, &openedAt);
+
+    EXPECT_EQ(server.lastStatus(), 206);
+    EXPECT_EQ(firstChunk, 1);
+    EXPECT_EQ(cleared, 0);
+    EXPECT_EQ(openedAt, CHUNK);
+}
+
+TEST_F(DownloadTaskResumeTest, PieceHashesSurviveSaveAndRestore){
+    QVector<QByteArray> pieces = {hashOf(chunks[0]), hashOf(chunks[1]), hashOf(chunks[2]), hashOf(chunks[3])};
+    DownloadTypes::DownloadRecord info = fileInfo(dir.filePath("pieces.bin"));
+
+    auto task = std::make_shared<DownloadTask>("http://127.0.0.1:9/pieces.bin", info);
+    task->setExpectedChunkHashes(pieces);
+    DownloadRecord saved;
+    DownloadAdapter::fillFromTask(saved, task);
+    ASSERT_FALSE(saved.m_pieceHashes.isEmpty());
+
+    auto restored = std::make_shared<DownloadTask>("http://127.0.0.1:9/pieces.bin", info);
+    restored->updateFromDb(saved);
+    DownloadRecord resaved;
+    DownloadAdapter::fillFromTask(resaved, restored);
+    EXPECT_EQ(resaved.m_pieceHashes, saved.m_pieceHashes);
+}
+
+TEST(DownloadTaskStatusTest, StatusCodesRoundTrip){
+    for(int status = DownloadTask::Preparing; status <= DownloadTask::Deleted; ++status){
+        int code = DownloadTask::statusCode(DownloadTask::Status(status));
+        EXPECT_EQ(DownloadTask::statusFromCode(code), DownloadTask::Status(status));
+    }
+
+    EXPECT_EQ(DownloadTask::statusCode(DownloadTask::FileIntegrityCheck), DownloadRecord::statusCode("pending"));
+    EXPECT_EQ(DownloadTask::statusFromCode(DownloadRecord::statusCode("paused_new")), DownloadTask::PausedNew);
+    EXPECT_EQ(DownloadTask::statusFromCode(-1, DownloadTask::Paused), DownloadTask::Paused);
+    EXPECT_EQ(DownloadTask::statusFromCode(DownloadRecord::statusCount(), DownloadTask::Error), DownloadTask::Error);
+}
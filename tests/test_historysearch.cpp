@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <iostream>
+#include "downloaddatabase.h"
+
+class HistorySearchTest : public ::testing::Test {
+protected:
+    QTemporaryDir dir;
+    DownloadDatabase *db = nullptr;
+
+    void SetUp() override {
+        ASSERT_TRUE(dir.isValid());
+        db = new DownloadDatabase(dir.filePath("history.db"), nullptr, "history_search");
+    }
+
+    void TearDown() override {
+        delete db;
+    }
+
+    DownloadTypes::HistoryEntry entry(const QString &name, const QString &url, qint64 size,
+                                      DownloadTypes::DownloadStatus status = DownloadTypes::DownloadStatus::Completed) {
+        DownloadTypes::HistoryEntry entry;
+        entry.id = QUuid::createUuid();
+        entry.name = name;
+        entry.url = url;
+        entry.filePath = "/home/user/Downloads/" + name;
+        entry.hash = QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha256).toHex();
+        entry.totalBytes = size;
+        entry.status = status;
+        return entry;
+    }
+
+    void setFinishedAt(const QString &url, const QString &timestamp) {
+        QSqlQuery query(QSqlDatabase::database("history_search"));
+        query.prepare("UPDATE download_history SET finishedAt = ? WHERE url = ?");
+        query.addBindValue(timestamp);
+        query.addBindValue(url);
+        ASSERT_TRUE(query.exec());
+    }
+
+    QStringList names(const QVector<DownloadTypes::HistoryEntry> &entries) {
+        QStringList result;
+        for (const auto &entry : entries) result << entry.name;
+        return result;
+    }
+
+    void seed() {
+        ASSERT_TRUE(db->writeBatch({}, {}, {
+            entry("ubuntu-24.04-desktop-amd64.iso", "https://releases.ubuntu.com/24.04/ubuntu-24.04-desktop-amd64.iso", 6000000000LL),
+            entry("debian-12.5.0-amd64-netinst.iso", "https://cdimage.debian.org/debian-cd/debian-12.5.0-amd64-netinst.iso", 650000000LL),
+            entry("report_2023.pdf", "https://example.com/files/report_2023.pdf", 120000, DownloadTypes::DownloadStatus::Error),
+            entry("photo.jpg", "https://cdn.example.com/u/photo.jpg", 3000000, DownloadTypes::DownloadStatus::Cancelled)
+        }));
+    }
+};
+
+TEST_F(HistorySearchTest, MatchesWordPrefixesAcrossColumns){
+    seed();
+
+    DownloadTypes::HistoryQuery query;
+    query.text = "ubu";
+    EXPECT_EQ(names(db->searchHistory(query)), QStringList({"ubuntu-24.04-desktop-amd64.iso"}));
+
+    query.text = "cdimage";
+    EXPECT_EQ(names(db->searchHistory(query)), QStringList({"debian-12.5.0-amd64-netinst.iso"}));
+
+    query.text = "amd64 iso";
+    EXPECT_EQ(db->searchHistory(query).size(), 2);
+
+    query.text = "Downloads report";
+    EXPECT_EQ(names(db->searchHistory(query)), QStringList({"report_2023.pdf"}));
+}
+
+TEST_F(HistorySearchTest, MatchesHashPrefix){
+    seed();
+
+    QString hash = QCryptographicHash::hash("https://cdn.example.com/u/photo.jpg", QCryptographicHash::Sha256).toHex();
+    DownloadTypes::HistoryQuery query;
+    query.text = hash.left(12);
+    EXPECT_EQ(names(db->searchHistory(query)), QStringList({"photo.jpg"}));
+}
+
+TEST_F(HistorySearchTest, QuotesInQueryDoNotBreakSearch){
+    seed();
+
+    DownloadTypes::HistoryQuery query;
+    query.text = "report\" AND";
+    EXPECT_TRUE(db->searchHistory(query).isEmpty());
+
+    query.text = "report\"";
+    EXPECT_EQ(names(db->searchHistory(query)), QStringList({"report_2023.pdf"}));
+}
+
+TEST_F(HistorySearchTest, FiltersByStatusSizeAndDate){
+    seed();
+    setFinishedAt("https://releases.ubuntu.com/24.04/ubuntu-24.04-desktop-amd64.iso", "2024-04-25 10:00:00");
+    setFinishedAt("https://cdimage.debian.org/debian-cd/debian-12.5.0-amd64-netinst.iso", "2024-02-10 08:30:00");
+
+    DownloadTypes::HistoryQuery query;
+    query.statuses = {DownloadTypes::DownloadStatus::Error, DownloadTypes::DownloadStatus::Cancelled};
+    EXPECT_EQ(names(db->searchHistory(query)), QStringList({"photo.jpg", "report_2023.pdf"}));
+
+    query = {};
+    query.minBytes = 1000000;
+    query.maxBytes = 1000000000LL;
+    EXPECT_EQ(names(db->searchHistory(query)), QStringList({"photo.jpg", "debian-12.5.0-amd64-netinst.iso"}));
+
+    query = {};
+    query.finishedFrom = QDateTime(QDate(2024, 1, 1), QTime(0, 0), QTimeZone::UTC);
+    query.finishedTo = QDateTime(QDate(2024, 3, 1), QTime(0, 0), QTimeZone::UTC);
+    QVector<DownloadTypes::HistoryEntry> february = db->searchHistory(query);
+    ASSERT_EQ(february.size(), 1);
+    EXPECT_EQ(february[0].name, "debian-12.5.0-amd64-netinst.iso");
+    EXPECT_EQ(february[0].finishedAt, QDateTime(QDate(2024, 2, 10), QTime(8, 30), QTimeZone::UTC));
+
+    query.text = "ubuntu";
+    EXPECT_TRUE(db->searchHistory(query).isEmpty());
+}
+
+TEST_F(HistorySearchTest, ResultsArePaged){
+    QVector<DownloadTypes::HistoryEntry> entries;
+    for (int i = 0; i < 25; ++i) {
+        entries.append(entry(QString("backup-%1.tar").arg(i), QString("https://backup.test/%1.tar").arg(i), i));
+    }
+    ASSERT_TRUE(db->writeBatch({}, {}, entries));
+
+    DownloadTypes::HistoryQuery query;
+    query.text = "backup";
+    query.limit = 10;
+    EXPECT_EQ(db->searchHistory(query).size(), 10);
+
+    query.offset = 20;
+    QVector<DownloadTypes::HistoryEntry> last = db->searchHistory(query);
+    ASSERT_EQ(last.size(), 5);
+    EXPECT_EQ(last.last().name, "backup-0.tar");
+}
+
+TEST_F(HistorySearchTest, DeletedEntriesLeaveTheIndex){
+    seed();
+
+    DownloadTypes::HistoryQuery query;
+    query.text = "debian";
+    QVector<DownloadTypes::HistoryEntry> found = db->searchHistory(query);
+    ASSERT_EQ(found.size(), 1);
+
+    db->deleteHistoryEntry(found[0].id);
+    EXPECT_TRUE(db->searchHistory(query).isEmpty());
+}
+
+// Run with --gtest_also_run_disabled_tests to time searches over a large history.
+TEST_F(HistorySearchTest, DISABLED_BenchmarkSearchOver100kEntries){
+    const int count = 100000;
+    QVector<DownloadTypes::HistoryEntry> entries;
+    entries.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        entries.append(entry(QString("file-%1-%2.bin").arg(i).arg(i % 97),
+                             QString("https://mirror%1.example.com/pool/%2/file-%2.bin").arg(i % 13).arg(i),
+                             qint64(i) * 4096,
+                             i % 10 == 0 ? DownloadTypes::DownloadStatus::Error : DownloadTypes::DownloadStatus::Completed));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ASSERT_TRUE(db->writeBatch({}, {}, entries));
+    qint64 insertMs = timer.restart();
+
+    DownloadTypes::HistoryQuery query;
+    query.text = "file-4242";
+    QVector<DownloadTypes::HistoryEntry> byName = db->searchHistory(query);
+    qint64 nameMs = timer.restart();
+
+    query.text = "mirror7";
+    query.statuses = {DownloadTypes::DownloadStatus::Error};
+    query.offset = 500;
+    QVector<DownloadTypes::HistoryEntry> filtered = db->searchHistory(query);
+    qint64 filteredMs = timer.elapsed();
+
+    EXPECT_FALSE(byName.isEmpty());
+    EXPECT_FALSE(filtered.isEmpty());
+    std::cout << count << " archived entries: " << insertMs << " ms\n"
+              << "prefix search: " << nameMs << " ms\n"
+              << "filtered page: " << filteredMs << " ms" << std::endl;
+}
@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
-#include <QCoreApplication>
+#include <QApplication>
 
 int main(int argc, char **argv) {
-    QCoreApplication app(argc, argv);
+    // The download list tests paint through the widget style; no display is needed.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
     
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QTest>
+#include <QTemporaryDir>
+#include <QCryptographicHash>
+#include "metalinkparser.h"
+#include "segmentdownloader.h"
+#include "httpstandin.h"
+
+class MetalinkParserTest : public ::testing::Test {
+protected:
+    QByteArray document(const QStringList &urls, qint64 size, const QString &hash, const QVector<QByteArray> &pieces = {}) {
+        QByteArray xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                         "<metalink xmlns=\"urn:ietf:params:xml:ns:metalink\">\n"
+                         "  <generator>test</generator>\n"
+                         "  <file name=\"data/image.iso\">\n";
+        xml += "    <size>" + QByteArray::number(size) + "</size>\n";
+        xml += "    <hash type=\"sha-256\">" + hash.toUtf8() + "</hash>\n";
+        if(!pieces.isEmpty()){
+            xml += "    <pieces length=\"1048576\" type=\"sha-256\">\n";
+            for(const QByteArray &piece : pieces) xml += "      <hash>" + piece + "</hash>\n";
+            xml += "    </pieces>\n";
+        }
+        for(int i = 0; i < urls.size(); ++i){
+            xml += "    <url priority=\"" + QByteArray::number(urls.size() - i) + "\">" + urls[i].toUtf8() + "</url>\n";
+        }
+        xml += "    <metaurl mediatype=\"torrent\">http://example.com/image.torrent</metaurl>\n"
+               "  </file>\n"
+               "</metalink>\n";
+        return xml;
+    }
+};
+
+TEST_F(MetalinkParserTest, ParsesSizeHashesAndMirrorsByPriority){
+    QString hash(64, 'a');
+    auto files = MetalinkParser::parse(document({"http://low.example.com/image.iso",
+                                                 "ftp://ftp.example.com/image.iso",
+                                                 "https://high.example.com/image.iso"}, 4096, hash));
+
+    ASSERT_EQ(files.size(), 1);
+    EXPECT_EQ(files[0].name, "image.iso");
+    EXPECT_EQ(files[0].size, 4096);
+    EXPECT_EQ(files[0].hashes.value("sha-256"), hash);
+    EXPECT_EQ(files[0].urls, QStringList({"https://high.example.com/image.iso", "http://low.example.com/image.iso"}));
+}
+
+TEST_F(MetalinkParserTest, ParsesPieceHashes){
+    QVector<QByteArray> pieces = {QByteArray(64, 'b'), QByteArray(64, 'c')};
+    auto files = MetalinkParser::parse(document({"http://example.com/image.iso"}, 2 * 1024 * 1024, QString(64, 'a'), pieces));
+
+    ASSERT_EQ(files.size(), 1);
+    EXPECT_EQ(files[0].pieceType, "sha-256");
+    EXPECT_EQ(files[0].pieceLength, 1024 * 1024);
+    EXPECT_EQ(files[0].pieceHashes, pieces);
+}
+
+TEST_F(MetalinkParserTest, RejectsOtherDocuments){
+    QString error;
+    EXPECT_TRUE(MetalinkParser::parse("<html><body/></html>", &error).isEmpty());
+    EXPECT_FALSE(error.isEmpty());
+
+    error.clear();
+    EXPECT_TRUE(MetalinkParser::parse("<metalink><file name=\"a\">", &error).isEmpty());
+    EXPECT_FALSE(error.isEmpty());
+}
+
+TEST_F(MetalinkParserTest, SkipsEntriesWithoutHttpUrls){
+    auto files = MetalinkParser::parse(document({"ftp://example.com/image.iso"}, 10, QString(64, 'a')));
+    EXPECT_TRUE(files.isEmpty());
+}
+
+TEST_F(MetalinkParserTest, PiecesMatchFileServedByMirror){
+    const qint64 chunkSize = 1024 * 1024;
+    QByteArray body;
+    for(int i = 0; body.size() < 2 * chunkSize + 1000; ++i){
+        body += QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Sha256);
+    }
+
+    QVector<QByteArray> pieces;
+    for(qint64 offset = 0; offset < body.size(); offset += chunkSize){
+        pieces.append(QCryptographicHash::hash(body.mid(offset, chunkSize), QCryptographicHash::Sha256).toHex());
+    }
+
+    HttpStandIn server;
+    server.serve("/a/image.iso", body);
+    server.serve("/b/image.iso", body);
+
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QString path = dir.filePath("image.meta4");
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(document({server.url("/a/image.iso"), server.url("/b/image.iso")}, body.size(),
+                        QCryptographicHash::hash(body, QCryptographicHash::Sha256).toHex(), pieces));
+    file.close();
+
+    auto files = MetalinkParser::parseFile(path);
+    ASSERT_EQ(files.size(), 1);
+    ASSERT_EQ(files[0].urls.size(), 2);
+    EXPECT_EQ(files[0].size, body.size());
+
+    SegmentDownloader segment(1, QUrl(files[0].urls[1]), 1, 2, chunkSize, files[0].size, QCryptographicHash::Sha256);
+    QSignalSpy chunks(&segment, &SegmentDownloader::chunkReady);
+    QSignalSpy finished(&segment, &SegmentDownloader::finished);
+
+    segment.start();
+    ASSERT_TRUE(finished.wait(5000));
+
+    ASSERT_EQ(chunks.size(), 2);
+    EXPECT_EQ(chunks[0][0].toInt(), 1);
+    EXPECT_EQ(chunks[0][2].toByteArray(), files[0].pieceHashes[1]);
+    EXPECT_EQ(chunks[1][0].toInt(), 2);
+    EXPECT_EQ(chunks[1][2].toByteArray(), files[0].pieceHashes[2]);
+    EXPECT_EQ(server.requests(), 1);
+}
+
+TEST_F(MetalinkParserTest, MirrorIgnoringRangeYieldsNoChunks){
+    const qint64 chunkSize = 256 * 1024;
+    QByteArray body(4 * chunkSize, Qt::Uninitialized);
+    for(qint64 i = 0; i < body.size(); ++i) body[i] = static_cast<char>(i * 31 % 251);
+
+    HttpStandIn server;
+    server.setRangeSupport(false);
+    server.serve("/image.iso", body);
+
+    // The 200 carries chunk 0 onwards; none of it may be reported as chunks 2 and 3.
+    SegmentDownloader segment(0, QUrl(server.url("/image.iso")), 2, 3, chunkSize, body.size(), QCryptographicHash::Sha256);
+    QSignalSpy chunks(&segment, &SegmentDownloader::chunkReady);
+    QSignalSpy failed(&segment, &SegmentDownloader::failed);
+
+    segment.start();
+    ASSERT_TRUE(failed.wait(5000));
+    QTest::qWait(100);
+
+    EXPECT_EQ(chunks.size(), 0);
+    EXPECT_EQ(failed.size(), 1);
+    EXPECT_TRUE(segment.isFinished());
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "mirrorscheduler.h"
+
+class MirrorSchedulerTest : public ::testing::Test {
+protected:
+    MirrorScheduler scheduler;
+
+    void SetUp() override {
+        scheduler.setMirrors({"https://a.example.com/file.iso",
+                              "https://b.example.com/file.iso",
+                              "https://a.example.com/file.iso"});
+    }
+
+    int chunksOf(const QVector<MirrorScheduler::Segment> &segments, int mirror) {
+        int chunks = 0;
+        for(const auto &segment : segments){
+            if(segment.mirror == mirror) chunks += segment.lastChunk - segment.firstChunk + 1;
+        }
+        return chunks;
+    }
+};
+
+TEST_F(MirrorSchedulerTest, DuplicateMirrorsAreDropped){
+    EXPECT_EQ(scheduler.count(), 2);
+    EXPECT_EQ(scheduler.activeCount(), 2);
+}
+
+TEST_F(MirrorSchedulerTest, AssignCoversRangeWithoutGaps){
+    auto segments = scheduler.assign(3, 102);
+
+    ASSERT_EQ(segments.size(), 2);
+    int next = 3;
+    for(const auto &segment : segments){
+        EXPECT_EQ(segment.firstChunk, next);
+        EXPECT_GE(segment.lastChunk, segment.firstChunk);
+        next = segment.lastChunk + 1;
+    }
+    EXPECT_EQ(next, 103);
+}
+
+TEST_F(MirrorSchedulerTest, FasterMirrorGetsLargerShare){
+    scheduler.reportThroughput(0, 1000);
+    scheduler.reportThroughput(1, 3000);
+
+    auto segments = scheduler.assign(0, 99);
+
+    EXPECT_EQ(chunksOf(segments, 1), 75);
+    EXPECT_EQ(chunksOf(segments, 0), 25);
+    EXPECT_EQ(scheduler.bestMirror(), 1);
+}
+
+TEST_F(MirrorSchedulerTest, RepeatedFailuresDisableMirror){
+    scheduler.reportFailure(1);
+    scheduler.reportFailure(1);
+    EXPECT_EQ(scheduler.activeCount(), 2);
+
+    scheduler.reportFailure(1);
+    EXPECT_EQ(scheduler.activeCount(), 1);
+
+    auto segments = scheduler.assign(0, 9);
+    ASSERT_EQ(segments.size(), 1);
+    EXPECT_EQ(segments[0].mirror, 0);
+    EXPECT_EQ(scheduler.bestMirror(0), 0);
+}
+
+TEST_F(MirrorSchedulerTest, EveryMirrorGetsAtLeastOneChunk){
+    scheduler.reportThroughput(0, 1);
+    scheduler.reportThroughput(1, 1000000);
+
+    auto segments = scheduler.assign(0, 1);
+
+    EXPECT_EQ(chunksOf(segments, 0), 1);
+    EXPECT_EQ(chunksOf(segments, 1), 1);
+}
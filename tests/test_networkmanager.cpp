@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <QtTest/QSignalSpy>
+#include "networkmanager.h"
+#include "httpstandin.h"
+
+class NetworkManagerTest : public ::testing::Test {
+protected:
+    HttpStandIn server;
+    NetworkManager manager;
+
+    QByteArray makeBody(qint64 size) {
+        QByteArray body(size, Qt::Uninitialized);
+        for(qint64 i = 0; i < size; ++i) body[i] = static_cast<char>(i * 31 % 251);
+        return body;
+    }
+
+    RemoteFileInfo probe(const QString &path) {
+        QSignalSpy spy(&manager, &NetworkManager::fileInfoReady);
+        manager.probeRemoteFile(QUrl(server.url(path)));
+        if(!spy.wait(5000)) return RemoteFileInfo();
+        return spy[0][0].value<RemoteFileInfo>();
+    }
+};
+
+TEST_F(NetworkManagerTest, ProbeOfSmallFileNeedsNoSecondRequest){
+    QByteArray body = makeBody(1000);
+    server.serve("/small.bin", body);
+
+    RemoteFileInfo info = probe("/small.bin");
+
+    EXPECT_TRUE(info.isValid);
+    EXPECT_TRUE(info.complete);
+    EXPECT_TRUE(info.supportsRange);
+    EXPECT_EQ(info.fileSize, body.size());
+    EXPECT_EQ(info.fileName, "small.bin");
+    EXPECT_EQ(info.prefetched, body);
+    EXPECT_EQ(server.requests(), 1);
+}
+
+TEST_F(NetworkManagerTest, ProbeOfLargeFileKeepsFirstChunk){
+    QByteArray body = makeBody(3 * 1024 * 1024 + 17);
+    server.serve("/large.bin", body);
+
+    RemoteFileInfo info = probe("/large.bin");
+
+    EXPECT_TRUE(info.isValid);
+    EXPECT_FALSE(info.complete);
+    EXPECT_TRUE(info.supportsRange);
+    EXPECT_EQ(info.fileSize, body.size());
+    EXPECT_EQ(info.prefetched, body.left(1024 * 1024));
+}
+
+TEST_F(NetworkManagerTest, ProbeDetectsServerWithoutRanges){
+    server.setRangeSupport(false);
+    QByteArray body = makeBody(2 * 1024 * 1024);
+    server.serve("/norange.bin", body);
+
+    RemoteFileInfo info = probe("/norange.bin");
+
+    EXPECT_TRUE(info.isValid);
+    EXPECT_FALSE(info.supportsRange);
+    EXPECT_EQ(info.fileSize, body.size());
+}
+
+TEST_F(NetworkManagerTest, ProbeReportsMissingFile){
+    RemoteFileInfo info = probe("/missing.bin");
+
+    EXPECT_FALSE(info.isValid);
+    EXPECT_TRUE(info.prefetched.isEmpty());
+}
+
+TEST_F(NetworkManagerTest, ProbeReportsUrlAfterRedirect){
+    QByteArray body = makeBody(1000);
+    server.serve("/files/final.bin", body);
+    server.redirect("/latest", "/files/final.bin");
+
+    RemoteFileInfo info = probe("/latest");
+
+    EXPECT_TRUE(info.isValid);
+    EXPECT_EQ(info.url, QUrl(server.url("/files/final.bin")));
+    EXPECT_EQ(info.prefetched, body);
+    EXPECT_EQ(server.requests(), 2);
+}
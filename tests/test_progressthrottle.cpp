@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <QThread>
+#include "progressthrottle.h"
+
+class ProgressThrottleTest : public ::testing::Test {
+protected:
+    ProgressThrottle throttle{20, 1000};
+};
+
+TEST_F(ProgressThrottleTest, BurstPublishesFirstAndFinalReports){
+    const qint64 total = 1000 * 1024;
+
+    int published = 0;
+    for(qint64 received = 1024; received <= total; received += 1024){
+        if(throttle.shouldPublish(received, total)) ++published;
+    }
+
+    EXPECT_EQ(published, 2);
+    EXPECT_EQ(throttle.publishedCount(), 2);
+    EXPECT_EQ(throttle.suppressedCount(), 998);
+}
+
+TEST_F(ProgressThrottleTest, NeedsBothIntervalAndByteStep){
+    ASSERT_TRUE(throttle.shouldPublish(0, 100000));
+
+    EXPECT_FALSE(throttle.shouldPublish(5000, 100000));
+
+    QThread::msleep(30);
+    EXPECT_FALSE(throttle.shouldPublish(900, 100000));
+    EXPECT_TRUE(throttle.shouldPublish(6000, 100000));
+
+    QThread::msleep(30);
+    EXPECT_FALSE(throttle.shouldPublish(6500, 100000));
+}
+
+TEST_F(ProgressThrottleTest, StepBackwardsIsPublishedAtOnce){
+    ASSERT_TRUE(throttle.shouldPublish(50000, 100000));
+    EXPECT_TRUE(throttle.shouldPublish(8192, 100000));
+    EXPECT_FALSE(throttle.shouldPublish(9000, 100000));
+}
+
+TEST_F(ProgressThrottleTest, SuppressedReportIsFlushedOnce){
+    ASSERT_TRUE(throttle.shouldPublish(100, -1));
+    EXPECT_FALSE(throttle.shouldPublish(200, -1));
+    EXPECT_FALSE(throttle.shouldPublish(300, -1));
+
+    qint64 received = 0;
+    qint64 total = 0;
+    ASSERT_TRUE(throttle.takePending(received, total));
+    EXPECT_EQ(received, 300);
+    EXPECT_EQ(total, -1);
+
+    EXPECT_FALSE(throttle.takePending(received, total));
+    EXPECT_FALSE(throttle.shouldPublish(300, -1));
+    EXPECT_FALSE(throttle.takePending(received, total));
+}
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+#include <QTemporaryDir>
+#include <QSet>
+#include "downloaddatabase.h"
+
+// Builds databases the way earlier releases left them and opens them with
+// the current code.
+class SchemaMigrationTest : public ::testing::Test {
+protected:
+    QTemporaryDir dir;
+    QString path;
+
+    void SetUp() override {
+        ASSERT_TRUE(dir.isValid());
+        path = dir.filePath("snapshot.db");
+    }
+
+    void writeSnapshot(const QStringList &statements, int userVersion = 0) {
+        {
+            QSqlDatabase snapshot = QSqlDatabase::addDatabase("QSQLITE", "snapshot_writer");
+            snapshot.setDatabaseName(path);
+            ASSERT_TRUE(snapshot.open());
+            QSqlQuery query(snapshot);
+            for (const QString &statement : statements) {
+                ASSERT_TRUE(query.exec(statement)) << query.lastError().text().toStdString();
+            }
+            ASSERT_TRUE(query.exec(QString("PRAGMA user_version = %1").arg(userVersion)));
+            snapshot.close();
+        }
+        QSqlDatabase::removeDatabase("snapshot_writer");
+    }
+
+    QStringList columns(const QString &connection) {
+        QSqlQuery query("PRAGMA table_info(downloads)", QSqlDatabase::database(connection));
+        QStringList names;
+        while (query.next()) names << query.value(1).toString();
+        return names;
+    }
+
+    bool hasIndex(const QString &connection, const QString &name) {
+        QSqlQuery query(QSqlDatabase::database(connection));
+        query.prepare("SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = ?");
+        query.addBindValue(name);
+        return query.exec() && query.next();
+    }
+
+    static QString baselineTable() {
+        return "CREATE TABLE downloads (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL, "
+               "url TEXT NOT NULL UNIQUE, filePath TEXT, status TEXT NOT NULL DEFAULT 'pending', "
+               "totalBytes INTEGER DEFAULT 0, downloadedBytes INTEGER DEFAULT 0, expectedHash TEXT, "
+               "actualHash TEXT, hashAlgorithm TEXT, chunkHashes BLOB, "
+               "createdAt DATETIME DEFAULT CURRENT_TIMESTAMP, updatedAt DATETIME DEFAULT CURRENT_TIMESTAMP)";
+    }
+
+    static QString version7Table() {
+        return "CREATE TABLE downloads (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL, "
+               "url TEXT NOT NULL UNIQUE, filePath TEXT, status INTEGER NOT NULL DEFAULT 5, "
+               "totalBytes INTEGER DEFAULT 0, downloadedBytes INTEGER DEFAULT 0, expectedHash TEXT, "
+               "actualHash TEXT, hashAlgorithm TEXT, chunkHashes BLOB, "
+               "createdAt DATETIME DEFAULT CURRENT_TIMESTAMP, updatedAt DATETIME DEFAULT CURRENT_TIMESTAMP, "
+               "etag TEXT, lastModified TEXT, mirrors TEXT, decompress INTEGER DEFAULT 0, chunkBitmap BLOB, "
+               "chunkSize INTEGER DEFAULT 1048576, queuePosition INTEGER DEFAULT 0)";
+    }
+};
+
+TEST_F(SchemaMigrationTest, FreshDatabaseIsAtLatestVersion){
+    DownloadDatabase db(path, nullptr, "fresh");
+
+    EXPECT_EQ(db.schemaVersion(), DownloadDatabase::SCHEMA_VERSION);
+    EXPECT_TRUE(columns("fresh").contains("uuid"));
+    EXPECT_TRUE(hasIndex("fresh", "idx_queue"));
+    EXPECT_TRUE(hasIndex("fresh", "idx_uuid"));
+    EXPECT_TRUE(QSqlDatabase::database("fresh").tables().contains("download_history"));
+}
+
+TEST_F(SchemaMigrationTest, UnversionedBaselineIsUpgraded){
+    writeSnapshot({
+        baselineTable(),
+        "CREATE INDEX idx_status ON downloads(status)",
+        "INSERT INTO downloads (name, url, filePath, status, totalBytes, downloadedBytes) "
+        "VALUES ('a', 'https://old.test/a', '/a', 'paused', 100, 40)",
+        "INSERT INTO downloads (name, url, filePath, status, totalBytes, downloadedBytes) "
+        "VALUES ('b', 'https://old.test/b', '/b', 'completed', 200, 200)"
+    });
+
+    DownloadDatabase db(path, nullptr, "baseline");
+    EXPECT_EQ(db.schemaVersion(), DownloadDatabase::SCHEMA_VERSION);
+    EXPECT_EQ(columns("baseline").size(), 24);
+    EXPECT_FALSE(hasIndex("baseline", "idx_status"));
+    EXPECT_TRUE(hasIndex("baseline", "idx_queue"));
+
+    QVector<DownloadRecord> loaded = db.getDownloads();
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0].m_url, "https://old.test/a");
+    EXPECT_EQ(DownloadRecord::statusName(loaded[0].m_status), "paused");
+    EXPECT_EQ(loaded[0].m_downloadedBytes, 40);
+    EXPECT_EQ(loaded[0].m_chunkSize, 1024 * 1024);
+    EXPECT_EQ(loaded[0].m_quantityOfChunks, 8);
+
+    QVector<DownloadTypes::HistoryEntry> history = db.getHistory(0, 10);
+    ASSERT_EQ(history.size(), 1);
+    EXPECT_EQ(history[0].url, "https://old.test/b");
+    EXPECT_EQ(history[0].totalBytes, 200);
+
+    EXPECT_FALSE(loaded[0].m_uuid.isNull());
+    EXPECT_FALSE(history[0].id.isNull());
+    EXPECT_NE(loaded[0].m_uuid, history[0].id);
+}
+
+TEST_F(SchemaMigrationTest, Version8FinishedRowsMoveToHistory){
+    writeSnapshot({
+        version7Table(),
+        "ALTER TABLE downloads ADD COLUMN uuid TEXT",
+        "ALTER TABLE downloads ADD COLUMN quantityOfChunks INTEGER DEFAULT 8",
+        QString("INSERT INTO downloads (name, url, filePath, status, uuid, actualHash) VALUES "
+                "('g', 'https://v8.test/g', '/g', %1, 'u-g', 'ff00'), "
+                "('h', 'https://v8.test/h', '/h', %2, 'u-h', NULL), "
+                "('i', 'https://v8.test/i', '/i', %3, 'u-i', NULL)")
+            .arg(DownloadRecord::statusCode("completed"))
+            .arg(DownloadRecord::statusCode("error"))
+            .arg(DownloadRecord::statusCode("pending"))
+    }, 8);
+
+    DownloadDatabase db(path, nullptr, "v8");
+    EXPECT_EQ(db.schemaVersion(), DownloadDatabase::SCHEMA_VERSION);
+
+    QVector<DownloadRecord> active = db.getDownloads();
+    ASSERT_EQ(active.size(), 1);
+    EXPECT_EQ(active[0].m_url, "https://v8.test/i");
+
+    QVector<DownloadTypes::HistoryEntry> history = db.getHistory(0, 10);
+    ASSERT_EQ(history.size(), 2);
+    EXPECT_EQ(history[0].url, "https://v8.test/h");
+    EXPECT_EQ(history[0].status, DownloadTypes::DownloadStatus::Error);
+    EXPECT_EQ(history[1].status, DownloadTypes::DownloadStatus::Completed);
+    EXPECT_EQ(history[1].hash, "ff00");
+}
+
+TEST_F(SchemaMigrationTest, UnversionedLateLayoutKeepsData){
+    QByteArray bitmap("\x03\x02\x05", 3);
+    writeSnapshot({
+        baselineTable(),
+        "ALTER TABLE downloads ADD COLUMN etag TEXT",
+        "ALTER TABLE downloads ADD COLUMN lastModified TEXT",
+        "ALTER TABLE downloads ADD COLUMN mirrors TEXT",
+        "ALTER TABLE downloads ADD COLUMN decompress INTEGER DEFAULT 0",
+        "ALTER TABLE downloads ADD COLUMN chunkBitmap BLOB",
+        "CREATE INDEX idx_url ON downloads(url)",
+        "INSERT INTO downloads (name, url, filePath, status, etag, mirrors, decompress, chunkBitmap) "
+        "VALUES ('c', 'https://old.test/c', '/c', 'downloading', '\"v1\"', 'https://m.test/c', 1, X'030205')"
+    });
+
+    DownloadDatabase db(path, nullptr, "late");
+    EXPECT_FALSE(hasIndex("late", "idx_url"));
+
+    QVector<DownloadRecord> loaded = db.getDownloads();
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(DownloadRecord::statusName(loaded[0].m_status), "downloading");
+    EXPECT_EQ(loaded[0].m_etag, "\"v1\"");
+    EXPECT_EQ(loaded[0].m_mirrors, QStringList({"https://m.test/c"}));
+    EXPECT_TRUE(loaded[0].m_decompress);
+    EXPECT_EQ(loaded[0].m_chunkBitmap, bitmap);
+}
+
+TEST_F(SchemaMigrationTest, Version7GainsIdentityColumns){
+    writeSnapshot({
+        version7Table(),
+        "CREATE INDEX idx_queue ON downloads(status, queuePosition)",
+        "INSERT INTO downloads (name, url, filePath, status, queuePosition) VALUES ('d', 'https://v7.test/d', '/d', 8, 3)"
+    }, 7);
+
+    DownloadDatabase db(path, nullptr, "v7");
+    EXPECT_EQ(db.schemaVersion(), DownloadDatabase::SCHEMA_VERSION);
+
+    QVector<DownloadRecord> loaded = db.getDownloads();
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(DownloadRecord::statusName(loaded[0].m_status), "paused");
+    EXPECT_EQ(loaded[0].m_queuePosition, 3);
+    EXPECT_FALSE(loaded[0].m_uuid.isNull());
+    EXPECT_EQ(loaded[0].m_quantityOfChunks, 8);
+}
+
+TEST_F(SchemaMigrationTest, DecompressingDownloadKeepsFormatOfItsUrl){
+    writeSnapshot({
+        version7Table(),
+        "INSERT INTO downloads (name, url, filePath, decompress) VALUES ('dump.sql', 'https://v7.test/dump.sql.gz?x=1', '/dump.sql', 1)",
+        "INSERT INTO downloads (name, url, filePath, decompress) VALUES ('plain.gz', 'https://v7.test/plain.gz', '/plain.gz', 0)"
+    }, 7);
+
+    DownloadDatabase db(path, nullptr, "formats");
+    EXPECT_EQ(db.schemaVersion(), DownloadDatabase::SCHEMA_VERSION);
+
+    QVector<DownloadRecord> loaded = db.getDownloads();
+    ASSERT_EQ(loaded.size(), 2);
+    for (const auto &record : loaded) {
+        EXPECT_EQ(record.m_decodeFormat, record.m_decompress ? int(StreamDecoder::Gzip) : int(StreamDecoder::None))
+            << record.m_url.toStdString();
+    }
+}
+
+TEST_F(SchemaMigrationTest, FailedUpgradeIsRolledBack){
+    // Duplicate uuids make the unique index of step 8 fail after its columns were added.
+    writeSnapshot({
+        version7Table(),
+        "ALTER TABLE downloads ADD COLUMN uuid TEXT",
+        "INSERT INTO downloads (name, url, filePath, uuid) VALUES ('e', 'https://v7.test/e', '/e', 'same')",
+        "INSERT INTO downloads (name, url, filePath, uuid) VALUES ('f', 'https://v7.test/f', '/f', 'same')"
+    }, 7);
+
+    DownloadDatabase db(path, nullptr, "rollback");
+    EXPECT_EQ(db.schemaVersion(), 7);
+    EXPECT_FALSE(columns("rollback").contains("quantityOfChunks"));
+}
+
+TEST_F(SchemaMigrationTest, NewerSchemaIsNotTouched){
+    writeSnapshot({version7Table()}, DownloadDatabase::SCHEMA_VERSION + 1);
+
+    DownloadDatabase db(path, nullptr, "newer");
+    EXPECT_EQ(db.schemaVersion(), DownloadDatabase::SCHEMA_VERSION + 1);
+    EXPECT_FALSE(columns("newer").contains("uuid"));
+}
+
+TEST_F(SchemaMigrationTest, UuidSurvivesUpsertWithoutOne){
+    DownloadDatabase db(path, nullptr, "upsert");
+
+    DownloadRecord record;
+    record.m_url = "https://upsert.test/file";
+    record.m_name = "file";
+    record.m_filePath = "/file";
+    record.m_uuid = QUuid::createUuid();
+    db.saveDownloads({record});
+
+    DownloadRecord withoutUuid = record;
+    withoutUuid.m_uuid = QUuid();
+    withoutUuid.m_status = DownloadRecord::statusCode("completed");
+    db.saveDownloads({withoutUuid});
+
+    QVector<DownloadRecord> loaded = db.getDownloads();
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0].m_uuid, record.m_uuid);
+    EXPECT_EQ(DownloadRecord::statusName(loaded[0].m_status), "completed");
+}
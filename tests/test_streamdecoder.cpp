@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <QtTest/QSignalSpy>
+#include <QBuffer>
+#include <zlib.h>
+#include "streamdecoder.h"
+#include "chunkprocessor.h"
+
+class StreamDecoderTest : public ::testing::Test {
+protected:
+    QByteArray makeText(int size) {
+        QByteArray text;
+        for(int i = 0; text.size() < size; ++i){
+            text += "line " + QByteArray::number(i) + " of a fairly compressible log file\n";
+        }
+        return text.left(size);
+    }
+
+    QByteArray gzip(const QByteArray &data) {
+        z_stream stream{};
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+
+        QByteArray out(deflateBound(&stream, data.size()) + 32, Qt::Uninitialized);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+        stream.avail_in = data.size();
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = out.size();
+        deflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        return out;
+    }
+
+    QByteArray decodeInPieces(StreamDecoder &decoder, const QByteArray &compressed, int pieceSize, bool *ok) {
+        QByteArray out;
+        *ok = true;
+        for(int offset = 0; offset < compressed.size() && *ok; offset += pieceSize){
+            *ok = decoder.decode(compressed.constData() + offset, qMin(pieceSize, int(compressed.size() - offset)), out);
+        }
+        if(*ok) *ok = decoder.finish(out);
+        return out;
+    }
+};
+
+TEST_F(StreamDecoderTest, GzipDecodesAcrossArbitrarySplits){
+    QByteArray text = makeText(3 * 1024 * 1024 + 123);
+    QByteArray compressed = gzip(text);
+
+    StreamDecoder decoder(StreamDecoder::Gzip);
+    bool ok = false;
+    QByteArray out = decodeInPieces(decoder, compressed, 1000, &ok);
+
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(out, text);
+    EXPECT_EQ(decoder.compressedBytes(), compressed.size());
+    EXPECT_EQ(decoder.decodedBytes(), text.size());
+    EXPECT_EQ(decoder.compressedHash(), QCryptographicHash::hash(compressed, QCryptographicHash::Sha256).toHex());
+    EXPECT_EQ(decoder.decodedHash(), QCryptographicHash::hash(text, QCryptographicHash::Sha256).toHex());
+}
+
+TEST_F(StreamDecoderTest, GzipHandlesConcatenatedMembers){
+    QByteArray first = makeText(5000);
+    QByteArray second = "second member";
+
+    StreamDecoder decoder(StreamDecoder::Gzip);
+    bool ok = false;
+    QByteArray out = decodeInPieces(decoder, gzip(first) + gzip(second), 64, &ok);
+
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(out, first + second);
+}
+
+TEST_F(StreamDecoderTest, TruncatedStreamFailsOnFinish){
+    QByteArray compressed = gzip(makeText(100000));
+
+    StreamDecoder decoder(StreamDecoder::Gzip);
+    QByteArray out;
+    EXPECT_TRUE(decoder.decode(compressed.constData(), compressed.size() / 2, out));
+    EXPECT_FALSE(decoder.finish(out));
+    EXPECT_TRUE(decoder.hasError());
+}
+
+TEST_F(StreamDecoderTest, CorruptStreamFails){
+    QByteArray compressed = gzip(makeText(100000));
+    for(int i = 20; i < 200; ++i) compressed[i] = char(0xff);
+
+    StreamDecoder decoder(StreamDecoder::Gzip);
+    bool ok = true;
+    decodeInPieces(decoder, compressed, 4096, &ok);
+
+    EXPECT_FALSE(ok);
+    EXPECT_TRUE(decoder.hasError());
+}
+
+TEST_F(StreamDecoderTest, FormatDetection){
+    EXPECT_EQ(StreamDecoder::formatForEncoding("gzip"), StreamDecoder::Gzip);
+    EXPECT_EQ(StreamDecoder::formatForEncoding(" Deflate "), StreamDecoder::Gzip);
+    EXPECT_EQ(StreamDecoder::formatForEncoding("zstd"), StreamDecoder::Zstd);
+    EXPECT_EQ(StreamDecoder::formatForEncoding("identity"), StreamDecoder::None);
+
+    EXPECT_EQ(StreamDecoder::formatForFileName("dump.sql.GZ"), StreamDecoder::Gzip);
+    EXPECT_EQ(StreamDecoder::formatForFileName("src.tar.zst"), StreamDecoder::Zstd);
+    EXPECT_EQ(StreamDecoder::formatForFileName("src.txz"), StreamDecoder::Xz);
+    EXPECT_EQ(StreamDecoder::formatForFileName("image.iso"), StreamDecoder::None);
+
+    EXPECT_EQ(StreamDecoder::decodedFileName("dump.sql.gz"), "dump.sql");
+    EXPECT_EQ(StreamDecoder::decodedFileName("release.tgz"), "release.tar");
+    EXPECT_EQ(StreamDecoder::decodedFileName("image.iso"), "image.iso");
+}
+
+TEST_F(StreamDecoderTest, ChunkProcessorChunksDecodedStream){
+    QByteArray text = makeText(2 * 1024 * 1024 + 500);
+    QByteArray compressed = gzip(text);
+
+    ChunkProcessor processor;
+    processor.setDecoder(std::make_unique<StreamDecoder>(StreamDecoder::Gzip));
+    QSignalSpy spy(&processor, &ChunkProcessor::chunkReady);
+    QSignalSpy failed(&processor, &ChunkProcessor::decodeFailed);
+
+    QBuffer buffer(&compressed);
+    buffer.open(QIODevice::ReadOnly);
+    processor.readFrom(&buffer);
+    processor.finalize();
+
+    EXPECT_EQ(failed.count(), 0);
+    ASSERT_EQ(spy.count(), 3);
+
+    QByteArray joined;
+    for(int i = 0; i < spy.count(); ++i){
+        EXPECT_EQ(spy[i][0].toInt(), i);
+        joined += spy[i][1].toByteArray();
+    }
+    EXPECT_EQ(joined, text);
+}